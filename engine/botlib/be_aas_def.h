@@ -191,12 +191,21 @@ typedef struct aas_reachabilityareas_s
 	int firstarea, numareas;
 } aas_reachabilityareas_t;
 
+//bsp node with its split plane inlined for point area lookups
+typedef struct aas_pointnode_s
+{
+	vec3_t normal;
+	float dist;
+	int children[2];
+} aas_pointnode_t;
+
 typedef struct aas_s
 {
 	int loaded;									//qtrue when an AAS file is loaded
 	int initialized;							//qtrue when AAS has been initialized
 	int savefile;								//set qtrue when file should be saved
 	int bspchecksum;
+	int sharedlumps;							//bits of the lumps living in read-only shared memory
 	//current time
 	float time;
 	int numframes;
@@ -236,6 +245,7 @@ typedef struct aas_s
 	//nodes of the bsp tree
 	int numnodes;
 	aas_node_t *nodes;
+	aas_pointnode_t *pointnodes;
 	//cluster portals
 	int numportals;
 	aas_portal_t *portals;
@@ -264,6 +274,15 @@ typedef struct aas_s
 	int travelflagfortype[MAX_TRAVELTYPES];
 	//travel flags for each area based on contents
 	int *areacontentstravelflags;
+	//hot routing fields of the area settings and reachabilities kept in
+	//separate arrays so the routing update only touches what it reads
+	int *areacluster;
+	int *areaclusterareanum;
+	int *areafirstreachablearea;
+	int *areaflags;
+	int *reachareanum;
+	int *reachtravelflags;					//travel type flag | contents flags of the end area
+	int *reachtraveltime;
 	//routing update
 	aas_routingupdate_t *areaupdate;
 	aas_routingupdate_t *portalupdate;
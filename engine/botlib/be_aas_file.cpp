@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "l_precomp.h"
 #include "l_struct.h"
 #include "l_libvar.h"
+#include "l_crc.h"
 #include "aasfile.h"
 #include "botlib.h"
 #include "be_aas.h"
@@ -53,6 +54,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 void AAS_SwapAASData(void)
 {
 	int i, j;
+	//shared lumps are read-only and only used on little endian machines
+	if (aasworld.sharedlumps) return;
 	//bounding boxes
 	for (i = 0; i < aasworld.numbboxes; i++)
 	{
@@ -173,6 +176,19 @@ void AAS_SwapAASData(void)
 	} //end for
 } //end of the function AAS_SwapAASData
 //===========================================================================
+// frees a lump unless it lives in shared memory
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_FreeLump(void *ptr, int lumpnum)
+{
+	if (!ptr) return;
+	if (aasworld.sharedlumps & (1 << lumpnum)) return;
+	FreeMemory(ptr);
+} //end of the function AAS_FreeLump
+//===========================================================================
 // dump the current loaded aas file
 //
 // Parameter:				-
@@ -185,35 +201,37 @@ void AAS_DumpAASData(void)
 	if (aasworld.bboxes) FreeMemory(aasworld.bboxes);
 	aasworld.bboxes = NULL;
 	aasworld.numvertexes = 0;
-	if (aasworld.vertexes) FreeMemory(aasworld.vertexes);
+	AAS_FreeLump(aasworld.vertexes, AASLUMP_VERTEXES);
 	aasworld.vertexes = NULL;
 	aasworld.numplanes = 0;
-	if (aasworld.planes) FreeMemory(aasworld.planes);
+	AAS_FreeLump(aasworld.planes, AASLUMP_PLANES);
 	aasworld.planes = NULL;
 	aasworld.numedges = 0;
-	if (aasworld.edges) FreeMemory(aasworld.edges);
+	AAS_FreeLump(aasworld.edges, AASLUMP_EDGES);
 	aasworld.edges = NULL;
 	aasworld.edgeindexsize = 0;
-	if (aasworld.edgeindex) FreeMemory(aasworld.edgeindex);
+	AAS_FreeLump(aasworld.edgeindex, AASLUMP_EDGEINDEX);
 	aasworld.edgeindex = NULL;
 	aasworld.numfaces = 0;
-	if (aasworld.faces) FreeMemory(aasworld.faces);
+	AAS_FreeLump(aasworld.faces, AASLUMP_FACES);
 	aasworld.faces = NULL;
 	aasworld.faceindexsize = 0;
-	if (aasworld.faceindex) FreeMemory(aasworld.faceindex);
+	AAS_FreeLump(aasworld.faceindex, AASLUMP_FACEINDEX);
 	aasworld.faceindex = NULL;
 	aasworld.numareas = 0;
-	if (aasworld.areas) FreeMemory(aasworld.areas);
+	AAS_FreeLump(aasworld.areas, AASLUMP_AREAS);
 	aasworld.areas = NULL;
 	aasworld.numareasettings = 0;
 	if (aasworld.areasettings) FreeMemory(aasworld.areasettings);
 	aasworld.areasettings = NULL;
 	aasworld.reachabilitysize = 0;
-	if (aasworld.reachability) FreeMemory(aasworld.reachability);
+	AAS_FreeLump(aasworld.reachability, AASLUMP_REACHABILITY);
 	aasworld.reachability = NULL;
 	aasworld.numnodes = 0;
-	if (aasworld.nodes) FreeMemory(aasworld.nodes);
+	AAS_FreeLump(aasworld.nodes, AASLUMP_NODES);
 	aasworld.nodes = NULL;
+	if (aasworld.pointnodes) FreeMemory(aasworld.pointnodes);
+	aasworld.pointnodes = NULL;
 	aasworld.numportals = 0;
 	if (aasworld.portals) FreeMemory(aasworld.portals);
 	aasworld.portals = NULL;
@@ -224,12 +242,45 @@ void AAS_DumpAASData(void)
 	if (aasworld.clusters) FreeMemory(aasworld.clusters);
 	aasworld.clusters = NULL;
 	aasworld.numclusters = 0;
+	aasworld.sharedlumps = 0;
 	//
 	aasworld.loaded = qfalse;
 	aasworld.initialized = qfalse;
 	aasworld.savefile = qfalse;
 } //end of the function AAS_DumpAASData
 //===========================================================================
+// copies the split plane of every node next to its children so point
+// area lookups walk a single array
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_InitPointNodes(void)
+{
+	if (aasworld.pointnodes) FreeMemory(aasworld.pointnodes);
+	aasworld.pointnodes = NULL;
+	if (!aasworld.numnodes) return;
+	//
+	aas_pointnode_t *pointnodes = (aas_pointnode_t *) GetClearedMemory(aasworld.numnodes * sizeof(aas_pointnode_t));
+	for (int i = 0; i < aasworld.numnodes; i++)
+	{
+		const aas_node_t& node = aasworld.nodes[i];
+		if (node.planenum < 0 || node.planenum >= aasworld.numplanes)
+		{
+			//leave the lookups on the file data
+			FreeMemory(pointnodes);
+			return;
+		} //end if
+		const aas_plane_t& plane = aasworld.planes[node.planenum];
+		VectorCopy(plane.normal, pointnodes[i].normal);
+		pointnodes[i].dist = plane.dist;
+		pointnodes[i].children[0] = node.children[0];
+		pointnodes[i].children[1] = node.children[1];
+	} //end for
+	aasworld.pointnodes = pointnodes;
+} //end of the function AAS_InitPointNodes
+//===========================================================================
 //
 // Parameter:				-
 // Returns:					-
@@ -318,6 +369,70 @@ char *AAS_LoadAASLump(fileHandle_t fp, int offset, int length, int *lastoffset,
 	return buf;
 } //end of the function AAS_LoadAASLump
 //===========================================================================
+// lumps that are never written after loading can be shared with the other
+// server processes running the same map, the key is empty when not sharing
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static char aas_sharekey[32];
+
+typedef struct aas_sharedlump_s
+{
+	fileHandle_t fp;
+	int offset;
+	int length;
+	int *lastoffset;
+	int built;
+} aas_sharedlump_t;
+
+static void AAS_BuildSharedLump(void *data, void *context)
+{
+	aas_sharedlump_t *lump = (aas_sharedlump_t *) context;
+
+	if (lump->offset != *lump->lastoffset)
+	{
+		botimport.FS_Seek(lump->fp, lump->offset, FS_SEEK_SET);
+		*lump->lastoffset = lump->offset;
+	} //end if
+	botimport.FS_Read(data, lump->length, lump->fp);
+	*lump->lastoffset += lump->length;
+	lump->built = qtrue;
+} //end of the function AAS_BuildSharedLump
+
+static char *AAS_LoadSharedAASLump(fileHandle_t fp, int lumpnum, int offset, int length, int *lastoffset, int size)
+{
+	char name[64];
+	aas_sharedlump_t lump;
+	char *buf;
+
+	if (!aas_sharekey[0] || !length)
+	{
+		return AAS_LoadAASLump(fp, offset, length, lastoffset, size);
+	} //end if
+	Com_sprintf(name, sizeof(name), "aas-%s-%d", aas_sharekey, lumpnum);
+	lump.fp = fp;
+	lump.offset = offset;
+	lump.length = length;
+	lump.lastoffset = lastoffset;
+	lump.built = qfalse;
+	buf = (char *) botimport.SharedData(name, length, AAS_BuildSharedLump, &lump);
+	if (!buf)
+	{
+		return AAS_LoadAASLump(fp, offset, length, lastoffset, size);
+	} //end if
+	//another process loaded it, skip the data
+	if (!lump.built)
+	{
+		if (offset == *lastoffset) botimport.FS_Seek(fp, length, FS_SEEK_CUR);
+		else botimport.FS_Seek(fp, offset + length, FS_SEEK_SET);
+		*lastoffset = offset + length;
+	} //end if
+	aasworld.sharedlumps |= 1 << lumpnum;
+	return buf;
+} //end of the function AAS_LoadSharedAASLump
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -388,6 +503,20 @@ int AAS_LoadAASFile(char *filename)
 		botimport.FS_FCloseFile(fp);
 		return BLERR_WRONGAASFILEVERSION;
 	} //end if
+	//the lump layout and the bsp checksum identify the file contents,
+	//nothing can be shared when the data is going to be recomputed
+	aas_sharekey[0] = '\0';
+#ifdef Q3_LITTLE_ENDIAN
+	if (botimport.SharedData &&
+		!((int)LibVarGetValue("forcereachability")) &&
+		!((int)LibVarGetValue("forceclustering")) &&
+		!((int)LibVarGetValue("forcewrite")) &&
+		!((int)LibVarGetValue("aasoptimize")))
+	{
+		Com_sprintf(aas_sharekey, sizeof(aas_sharekey), "%08x-%08x", aasworld.bspchecksum,
+					CRC_ProcessString32((const unsigned char *) &header, sizeof(aas_header_t)));
+	} //end if
+#endif
 	//load the lumps:
 	//bounding boxes
 	offset = LittleLong(header.lumps[AASLUMP_BBOXES].fileofs);
@@ -398,43 +527,43 @@ int AAS_LoadAASFile(char *filename)
 	//vertexes
 	offset = LittleLong(header.lumps[AASLUMP_VERTEXES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_VERTEXES].filelen);
-	aasworld.vertexes = (aas_vertex_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_vertex_t));
+	aasworld.vertexes = (aas_vertex_t *) AAS_LoadSharedAASLump(fp, AASLUMP_VERTEXES, offset, length, &lastoffset, sizeof(aas_vertex_t));
 	aasworld.numvertexes = length / sizeof(aas_vertex_t);
 	if (aasworld.numvertexes && !aasworld.vertexes) return BLERR_CANNOTREADAASLUMP;
 	//planes
 	offset = LittleLong(header.lumps[AASLUMP_PLANES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_PLANES].filelen);
-	aasworld.planes = (aas_plane_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_plane_t));
+	aasworld.planes = (aas_plane_t *) AAS_LoadSharedAASLump(fp, AASLUMP_PLANES, offset, length, &lastoffset, sizeof(aas_plane_t));
 	aasworld.numplanes = length / sizeof(aas_plane_t);
 	if (aasworld.numplanes && !aasworld.planes) return BLERR_CANNOTREADAASLUMP;
 	//edges
 	offset = LittleLong(header.lumps[AASLUMP_EDGES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_EDGES].filelen);
-	aasworld.edges = (aas_edge_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_edge_t));
+	aasworld.edges = (aas_edge_t *) AAS_LoadSharedAASLump(fp, AASLUMP_EDGES, offset, length, &lastoffset, sizeof(aas_edge_t));
 	aasworld.numedges = length / sizeof(aas_edge_t);
 	if (aasworld.numedges && !aasworld.edges) return BLERR_CANNOTREADAASLUMP;
 	//edgeindex
 	offset = LittleLong(header.lumps[AASLUMP_EDGEINDEX].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_EDGEINDEX].filelen);
-	aasworld.edgeindex = (aas_edgeindex_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_edgeindex_t));
+	aasworld.edgeindex = (aas_edgeindex_t *) AAS_LoadSharedAASLump(fp, AASLUMP_EDGEINDEX, offset, length, &lastoffset, sizeof(aas_edgeindex_t));
 	aasworld.edgeindexsize = length / sizeof(aas_edgeindex_t);
 	if (aasworld.edgeindexsize && !aasworld.edgeindex) return BLERR_CANNOTREADAASLUMP;
 	//faces
 	offset = LittleLong(header.lumps[AASLUMP_FACES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_FACES].filelen);
-	aasworld.faces = (aas_face_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_face_t));
+	aasworld.faces = (aas_face_t *) AAS_LoadSharedAASLump(fp, AASLUMP_FACES, offset, length, &lastoffset, sizeof(aas_face_t));
 	aasworld.numfaces = length / sizeof(aas_face_t);
 	if (aasworld.numfaces && !aasworld.faces) return BLERR_CANNOTREADAASLUMP;
 	//faceindex
 	offset = LittleLong(header.lumps[AASLUMP_FACEINDEX].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_FACEINDEX].filelen);
-	aasworld.faceindex = (aas_faceindex_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_faceindex_t));
+	aasworld.faceindex = (aas_faceindex_t *) AAS_LoadSharedAASLump(fp, AASLUMP_FACEINDEX, offset, length, &lastoffset, sizeof(aas_faceindex_t));
 	aasworld.faceindexsize = length / sizeof(aas_faceindex_t);
 	if (aasworld.faceindexsize && !aasworld.faceindex) return BLERR_CANNOTREADAASLUMP;
 	//convex areas
 	offset = LittleLong(header.lumps[AASLUMP_AREAS].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_AREAS].filelen);
-	aasworld.areas = (aas_area_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_area_t));
+	aasworld.areas = (aas_area_t *) AAS_LoadSharedAASLump(fp, AASLUMP_AREAS, offset, length, &lastoffset, sizeof(aas_area_t));
 	aasworld.numareas = length / sizeof(aas_area_t);
 	if (aasworld.numareas && !aasworld.areas) return BLERR_CANNOTREADAASLUMP;
 	//area settings
@@ -446,13 +575,13 @@ int AAS_LoadAASFile(char *filename)
 	//reachability list
 	offset = LittleLong(header.lumps[AASLUMP_REACHABILITY].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_REACHABILITY].filelen);
-	aasworld.reachability = (aas_reachability_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_reachability_t));
+	aasworld.reachability = (aas_reachability_t *) AAS_LoadSharedAASLump(fp, AASLUMP_REACHABILITY, offset, length, &lastoffset, sizeof(aas_reachability_t));
 	aasworld.reachabilitysize = length / sizeof(aas_reachability_t);
 	if (aasworld.reachabilitysize && !aasworld.reachability) return BLERR_CANNOTREADAASLUMP;
 	//nodes
 	offset = LittleLong(header.lumps[AASLUMP_NODES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_NODES].filelen);
-	aasworld.nodes = (aas_node_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_node_t));
+	aasworld.nodes = (aas_node_t *) AAS_LoadSharedAASLump(fp, AASLUMP_NODES, offset, length, &lastoffset, sizeof(aas_node_t));
 	aasworld.numnodes = length / sizeof(aas_node_t);
 	if (aasworld.numnodes && !aasworld.nodes) return BLERR_CANNOTREADAASLUMP;
 	//cluster portals
@@ -475,6 +604,8 @@ int AAS_LoadAASFile(char *filename)
 	if (aasworld.numclusters && !aasworld.clusters) return BLERR_CANNOTREADAASLUMP;
 	//swap everything
 	AAS_SwapAASData();
+	//node array used for point area lookups
+	AAS_InitPointNodes();
 	//aas file is loaded
 	aasworld.loaded = qtrue;
 	//close the file
@@ -2215,55 +2215,44 @@ int AAS_Reachability_Jump(int area1num, int area2num)
 		//
 		VectorSubtract(bestend, beststart, dir);
 		VectorNormalize(dir);
-		VectorMA(beststart, 1, dir, teststart);
 		//
-		vec3_t testend;
-		VectorCopy(teststart, testend);
-		testend[2] -= 100;
-		trace = AAS_TraceClientBBox(teststart, testend, PRESENCE_NORMAL, -1);
-		//
-		if (trace.startsolid)
-			return qfalse;
-		if (trace.fraction < 1)
+		//the ground right after the start and right before the end must
+		//not be a barrier, the two traces are independent
+		vec3_t teststarts[2], testends[2];
+		aas_trace_t testtraces[2];
+		VectorMA(beststart, 1, dir, teststarts[0]);
+		VectorMA(bestend, -1, dir, teststarts[1]);
+		for (int t = 0; t < 2; t++)
 		{
-			plane = &aasworld.planes[trace.planenum];
-			// if the bot can stand on the surface
-			if (DotProduct(plane->normal, up) >= 0.7)
-			{
-				// if no lava or slime below
-				if (!(AAS_PointContents(trace.endpos) & (CONTENTS_LAVA|CONTENTS_SLIME)))
-				{
-					if (teststart[2] - trace.endpos[2] <= aassettings.phys_maxbarrier)
-						return qfalse;
-				} //end if
-			} //end if
-		} //end if
-		//
-		VectorMA(bestend, -1, dir, teststart);
-		//
-		VectorCopy(teststart, testend);
-		testend[2] -= 100;
-		trace = AAS_TraceClientBBox(teststart, testend, PRESENCE_NORMAL, -1);
+			VectorCopy(teststarts[t], testends[t]);
+			testends[t][2] -= 100;
+		} //end for
+		AAS_TraceClientBBoxBatch(teststarts, testends, 2, PRESENCE_NORMAL, -1, testtraces);
 		//
-		if (trace.startsolid)
-			return qfalse;
-		if (trace.fraction < 1)
+		for (int t = 0; t < 2; t++)
 		{
-			plane = &aasworld.planes[trace.planenum];
-			// if the bot can stand on the surface
-			if (DotProduct(plane->normal, up) >= 0.7)
+			trace = testtraces[t];
+			//
+			if (trace.startsolid)
+				return qfalse;
+			if (trace.fraction < 1)
 			{
-				// if no lava or slime below
-				if (!(AAS_PointContents(trace.endpos) & (CONTENTS_LAVA|CONTENTS_SLIME)))
+				plane = &aasworld.planes[trace.planenum];
+				// if the bot can stand on the surface
+				if (DotProduct(plane->normal, up) >= 0.7)
 				{
-					if (teststart[2] - trace.endpos[2] <= aassettings.phys_maxbarrier)
-						return qfalse;
+					// if no lava or slime below
+					if (!(AAS_PointContents(trace.endpos) & (CONTENTS_LAVA|CONTENTS_SLIME)))
+					{
+						if (teststarts[t][2] - trace.endpos[2] <= aassettings.phys_maxbarrier)
+							return qfalse;
+					} //end if
 				} //end if
 			} //end if
-		} //end if
+		} //end for
 		//
 		// get command movement
-		vec3_t cmdmove, sidewards;
+		vec3_t cmdmove, sidewards, testend;
 		VectorClear(cmdmove);
 		if ((traveltype & TRAVELTYPE_MASK) == TRAVEL_JUMP)
 			cmdmove[2] = aassettings.phys_jumpvel;
@@ -109,8 +109,8 @@ ID_INLINE int AAS_ClusterAreaNum(int cluster, int areanum)
 {
 	int areacluster;
 
-	areacluster = aasworld.areasettings[areanum].cluster;
-	if (areacluster > 0) return aasworld.areasettings[areanum].clusterareanum;
+	areacluster = aasworld.areacluster[areanum];
+	if (areacluster > 0) return aasworld.areaclusterareanum[areanum];
 	else
 	{
 /*#ifdef ROUTING_DEBUG
@@ -313,6 +313,8 @@ int AAS_EnableRoutingArea(int areanum, int enable)
 		aasworld.areasettings[areanum].areaflags &= ~AREA_DISABLED;
 	else
 		aasworld.areasettings[areanum].areaflags |= AREA_DISABLED;
+	if (aasworld.areaflags)
+		aasworld.areaflags[areanum] = aasworld.areasettings[areanum].areaflags;
 	// if the status of the area changed
 	if ( (flags & AREA_DISABLED) != (aasworld.areasettings[areanum].areaflags & AREA_DISABLED) )
 	{
@@ -395,6 +397,67 @@ void AAS_InitAreaContentsTravelFlags(void)
 	}
 } //end of the function AAS_InitAreaContentsTravelFlags
 //===========================================================================
+// mirrors the area settings and reachability fields read by the routing
+// update into flat arrays, must be called after the area contents travel
+// flags are initialized
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_InitRoutingAreaData(void)
+{
+	AAS_FreeRoutingAreaData();
+	//
+	aasworld.areacluster = (int *) GetClearedMemory(aasworld.numareas * sizeof(int));
+	aasworld.areaclusterareanum = (int *) GetClearedMemory(aasworld.numareas * sizeof(int));
+	aasworld.areafirstreachablearea = (int *) GetClearedMemory(aasworld.numareas * sizeof(int));
+	aasworld.areaflags = (int *) GetClearedMemory(aasworld.numareas * sizeof(int));
+	for (int i = 0; i < aasworld.numareas; i++)
+	{
+		const aas_areasettings_t& settings = aasworld.areasettings[i];
+		aasworld.areacluster[i] = settings.cluster;
+		aasworld.areaclusterareanum[i] = settings.clusterareanum;
+		aasworld.areafirstreachablearea[i] = settings.firstreachablearea;
+		aasworld.areaflags[i] = settings.areaflags;
+	} //end for
+	//
+	aasworld.reachareanum = (int *) GetClearedMemory(aasworld.reachabilitysize * sizeof(int));
+	aasworld.reachtravelflags = (int *) GetClearedMemory(aasworld.reachabilitysize * sizeof(int));
+	aasworld.reachtraveltime = (int *) GetClearedMemory(aasworld.reachabilitysize * sizeof(int));
+	for (int i = 0; i < aasworld.reachabilitysize; i++)
+	{
+		const aas_reachability_t& reach = aasworld.reachability[i];
+		aasworld.reachareanum[i] = reach.areanum;
+		aasworld.reachtravelflags[i] = AAS_TravelFlagForType_inline(reach.traveltype) |
+										AAS_AreaContentsTravelFlags_inline(reach.areanum);
+		aasworld.reachtraveltime[i] = reach.traveltime;
+	} //end for
+} //end of the function AAS_InitRoutingAreaData
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_FreeRoutingAreaData(void)
+{
+	if (aasworld.areacluster) FreeMemory(aasworld.areacluster);
+	aasworld.areacluster = NULL;
+	if (aasworld.areaclusterareanum) FreeMemory(aasworld.areaclusterareanum);
+	aasworld.areaclusterareanum = NULL;
+	if (aasworld.areafirstreachablearea) FreeMemory(aasworld.areafirstreachablearea);
+	aasworld.areafirstreachablearea = NULL;
+	if (aasworld.areaflags) FreeMemory(aasworld.areaflags);
+	aasworld.areaflags = NULL;
+	if (aasworld.reachareanum) FreeMemory(aasworld.reachareanum);
+	aasworld.reachareanum = NULL;
+	if (aasworld.reachtravelflags) FreeMemory(aasworld.reachtravelflags);
+	aasworld.reachtravelflags = NULL;
+	if (aasworld.reachtraveltime) FreeMemory(aasworld.reachtraveltime);
+	aasworld.reachtraveltime = NULL;
+} //end of the function AAS_FreeRoutingAreaData
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -1166,6 +1229,8 @@ void AAS_InitRouting()
 	AAS_InitTravelFlagFromType();
 	//
 	AAS_InitAreaContentsTravelFlags();
+	//mirror the fields used by the routing update
+	AAS_InitRoutingAreaData();
 	//initialize the routing update fields
 	AAS_InitRoutingUpdate();
 	//create reversed reachability links used by the routing update algorithm
@@ -1226,6 +1291,8 @@ void AAS_FreeRoutingCaches()
 	// free area contents travel flags look up table
 	if (aasworld.areacontentstravelflags) FreeMemory(aasworld.areacontentstravelflags);
 	aasworld.areacontentstravelflags = NULL;
+	// free the routing area and reachability mirrors
+	AAS_FreeRoutingAreaData();
 } //end of the function AAS_FreeRoutingCaches
 //===========================================================================
 // update the given routing cache
@@ -1284,17 +1351,15 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t* const areacache)
 		for (aas_reversedlink_t *revlink = revreach.first; revlink; revlink = revlink->next, i++)
 		{
 			int linknum = revlink->linknum;
-			const aas_reachability_t& reach = aasworld.reachability[linknum];
-			//if there is used an undesired travel type
-			if (AAS_TravelFlagForType_inline(reach.traveltype) & badtravelflags) continue;
+			//if there is used an undesired travel type or the next area
+			//has a not allowed travel flag
+			if (aasworld.reachtravelflags[linknum] & badtravelflags) continue;
 			//if not allowed to enter the next area
-			if (aasworld.areasettings[reach.areanum].areaflags & AREA_DISABLED) continue;
-			//if the next area has a not allowed travel flag
-			if (AAS_AreaContentsTravelFlags_inline(reach.areanum) & badtravelflags) continue;
+			if (aasworld.areaflags[aasworld.reachareanum[linknum]] & AREA_DISABLED) continue;
 			//number of the area the reversed reachability leads to
 			int nextareanum = revlink->areanum;
 			//get the cluster number of the area
-			int cluster = aasworld.areasettings[nextareanum].cluster;
+			int cluster = aasworld.areacluster[nextareanum];
 			//don't leave the cluster
 			if (cluster > 0 && cluster != areacache->cluster) continue;
 			//get the number of the area in the cluster
@@ -1305,19 +1370,19 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t* const areacache)
 			unsigned short int t = curupdate->tmptraveltime +
 						//AAS_AreaTravelTime(curupdate->areanum, curupdate->start, reach->end) +
 						curupdate->areatraveltimes[i] +
-							reach.traveltime;
+							aasworld.reachtraveltime[linknum];
 			//
 			if (!areacache->traveltimes[clusterareanum] ||
 					areacache->traveltimes[clusterareanum] > t)
 			{
 				areacache->traveltimes[clusterareanum] = t;
-				areacache->reachabilities[clusterareanum] = linknum - aasworld.areasettings[nextareanum].firstreachablearea;
+				int firstreachablearea = aasworld.areafirstreachablearea[nextareanum];
+				areacache->reachabilities[clusterareanum] = linknum - firstreachablearea;
 				aas_routingupdate_t& nextupdate = aasworld.areaupdate[clusterareanum];
 				nextupdate.areanum = nextareanum;
 				nextupdate.tmptraveltime = t;
 				//VectorCopy(reach->start, nextupdate->start);
-				nextupdate.areatraveltimes = aasworld.areatraveltimes[nextareanum][linknum -
-													aasworld.areasettings[nextareanum].firstreachablearea];
+				nextupdate.areatraveltimes = aasworld.areatraveltimes[nextareanum][linknum - firstreachablearea];
 				if (!nextupdate.inlist)
 				{
 					// we add the update to the end of the list
@@ -1567,8 +1632,8 @@ int AAS_AreaRouteToGoalArea(int areanum, const vec3_t origin, int goalareanum, i
 	*/
 
 	//
-	int clusternum = aasworld.areasettings[areanum].cluster;
-	int goalclusternum = aasworld.areasettings[goalareanum].cluster;
+	int clusternum = aasworld.areacluster[areanum];
+	int goalclusternum = aasworld.areacluster[goalareanum];
 	//check if the area is a portal of the goal area cluster
 	if (clusternum < 0 && goalclusternum > 0)
 	{
@@ -1604,7 +1669,7 @@ int AAS_AreaRouteToGoalArea(int areanum, const vec3_t origin, int goalareanum, i
 		//if it is possible to travel to the goal area through this cluster
 		if (areacache.traveltimes[clusterareanum] != 0)
 		{
-			reachnum = aasworld.areasettings[areanum].firstreachablearea +
+			reachnum = aasworld.areafirstreachablearea[areanum] +
 							areacache.reachabilities[clusterareanum];
 			if (!origin) {
 				traveltime = areacache.traveltimes[clusterareanum];
@@ -1633,7 +1698,7 @@ int AAS_AreaRouteToGoalArea(int areanum, const vec3_t origin, int goalareanum, i
 	if (clusternum < 0)
 	{
 		traveltime = portalcache.traveltimes[-clusternum];
-		reachnum = aasworld.areasettings[areanum].firstreachablearea +
+		reachnum = aasworld.areafirstreachablearea[areanum] +
 						portalcache.reachabilities[-clusternum];
 		return qtrue;
 	} //end if
@@ -1670,7 +1735,7 @@ int AAS_AreaRouteToGoalArea(int areanum, const vec3_t origin, int goalareanum, i
 		//
 		if (origin)
 		{
-			reachnum = aasworld.areasettings[areanum].firstreachablearea +
+			reachnum = aasworld.areafirstreachablearea[areanum] +
 							areacache.reachabilities[clusterareanum];
 			const aas_reachability_t& reach = aasworld.reachability[ reachnum ];
 			t += AAS_AreaTravelTime(areanum, origin, reach.start);
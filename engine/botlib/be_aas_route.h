@@ -34,6 +34,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 void AAS_InitRouting(void);
 //free the AAS routing caches
 void AAS_FreeRoutingCaches(void);
+//mirrors the hot area settings and reachability fields into flat arrays
+void AAS_InitRoutingAreaData(void);
+//frees the mirrored routing fields
+void AAS_FreeRoutingAreaData(void);
 //returns the travel time from start to end in the given area
 unsigned short int AAS_AreaTravelTime(int areanum, const vec3_t start, const vec3_t end);
 //
@@ -44,6 +44,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "be_aas_funcs.h"
 #include "be_aas_def.h"
 
+#if idSSE2
+#include <xmmintrin.h>
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(disable : 4065) // empty switch()s
 #endif
@@ -58,6 +62,9 @@ extern botlib_import_t botimport;
 
 #define TRACEPLANE_EPSILON			0.125
 
+//number of traces tested against a node plane at once
+#define AAS_TRACEPACKET				4
+
 typedef struct aas_tracestack_s
 {
 	vec3_t start;		//start point of the piece of line to trace
@@ -229,6 +236,16 @@ int AAS_PointAreaNum(vec3_t point)
 
 	//start with node 1 because node zero is a dummy used for solid leafs
 	nodenum = 1;
+	if (aasworld.pointnodes)
+	{
+		const aas_pointnode_t *pointnodes = aasworld.pointnodes;
+		while (nodenum > 0)
+		{
+			const aas_pointnode_t& pointnode = pointnodes[nodenum];
+			dist = DotProduct(point, pointnode.normal) - pointnode.dist;
+			nodenum = pointnode.children[dist <= 0];
+		} //end while
+	} //end if
 	while (nodenum > 0)
 	{
 //		botimport.Print(PRT_MESSAGE, "[%d]", nodenum);
@@ -444,14 +461,15 @@ qbool AAS_AreaEntityCollision(int areanum, vec3_t start, vec3_t end,
 	return qfalse;
 } //end of the function AAS_AreaEntityCollision
 //===========================================================================
-// recursive subdivision of the line by the BSP tree.
+// recursive subdivision of the line by the BSP tree starting at the given
+// node, the line must be entirely at one side of all the nodes above it
 //
 // Parameter:				-
 // Returns:					-
 // Changes Globals:		-
 //===========================================================================
-aas_trace_t AAS_TraceClientBBox(vec3_t start, vec3_t end, int presencetype,
-																				int passent)
+static aas_trace_t AAS_TraceClientBBoxFromNode(const vec3_t start, const vec3_t end,
+												int presencetype, int passent, int firstnode)
 {
 	int side, nodenum, tmpplanenum;
 	float front, back, frac;
@@ -472,8 +490,7 @@ aas_trace_t AAS_TraceClientBBox(vec3_t start, vec3_t end, int presencetype,
 	VectorCopy(start, tstack_p->start);
 	VectorCopy(end, tstack_p->end);
 	tstack_p->planenum = 0;
-	//start with node 1 because node zero is a dummy for a solid leaf
-	tstack_p->nodenum = 1;		//starting at the root of the tree
+	tstack_p->nodenum = firstnode;
 	tstack_p++;
 	
 	while (1)
@@ -719,7 +736,7 @@ aas_trace_t AAS_TraceClientBBox(vec3_t start, vec3_t end, int presencetype,
 		} //end else
 	} //end while
 //	return trace;
-} //end of the function AAS_TraceClientBBox
+} //end of the function AAS_TraceClientBBoxFromNode
 //===========================================================================
 // recursive subdivision of the line by the BSP tree.
 //
@@ -727,7 +744,22 @@ aas_trace_t AAS_TraceClientBBox(vec3_t start, vec3_t end, int presencetype,
 // Returns:					-
 // Changes Globals:		-
 //===========================================================================
-int AAS_TraceAreas( const vec3_t start, const vec3_t end, int *areas, vec3_t *points, int maxareas)
+aas_trace_t AAS_TraceClientBBox(vec3_t start, vec3_t end, int presencetype,
+																				int passent)
+{
+	//start with node 1 because node zero is a dummy for a solid leaf
+	return AAS_TraceClientBBoxFromNode(start, end, presencetype, passent, 1);
+} //end of the function AAS_TraceClientBBox
+//===========================================================================
+// recursive subdivision of the line by the BSP tree starting at the given
+// node, the line must be entirely at one side of all the nodes above it
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static int AAS_TraceAreasFromNode(const vec3_t start, const vec3_t end, int *areas, vec3_t *points,
+									int maxareas, int firstnode)
 {
 	int side, nodenum, tmpplanenum;
 	int numareas;
@@ -747,8 +779,7 @@ int AAS_TraceAreas( const vec3_t start, const vec3_t end, int *areas, vec3_t *po
 	VectorCopy(start, tstack_p->start);
 	VectorCopy(end, tstack_p->end);
 	tstack_p->planenum = 0;
-	//start with node 1 because node zero is a dummy for a solid leaf
-	tstack_p->nodenum = 1;		//starting at the root of the tree
+	tstack_p->nodenum = firstnode;
 	tstack_p++;
 
 	while (1)
@@ -905,8 +936,214 @@ int AAS_TraceAreas( const vec3_t start, const vec3_t end, int *areas, vec3_t *po
 		} //end else
 	} //end while
 //	return numareas;
+} //end of the function AAS_TraceAreasFromNode
+//===========================================================================
+// recursive subdivision of the line by the BSP tree.
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+int AAS_TraceAreas( const vec3_t start, const vec3_t end, int *areas, vec3_t *points, int maxareas)
+{
+	//start with node 1 because node zero is a dummy for a solid leaf
+	return AAS_TraceAreasFromNode(start, end, areas, points, maxareas, 1);
 } //end of the function AAS_TraceAreas
 //===========================================================================
+// walks a packet of traces down the BSP tree together for as long as each
+// trace is entirely at one side of the node planes, the node planes are
+// tested against all traces of the packet at once. Stores for every trace
+// the first node that splits it or the leaf it ends up in. Since a trace
+// is never split above that node the scalar trace continuing from there
+// gives the same result as a trace from the root.
+//
+// Parameter:				start, end		: AAS_TRACEPACKET trace lines
+//								numtraces		: number of valid lines
+//								areatrace		: qtrue to classify like AAS_TraceAreas
+//								firstnodes		: node to continue each trace from
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_TracePacketNodes(const vec3_t *start, const vec3_t *end, int numtraces,
+									int areatrace, int *firstnodes)
+{
+	int i, nodenum, mask, frontmask, backmask, numstack;
+	float startx[AAS_TRACEPACKET], starty[AAS_TRACEPACKET], startz[AAS_TRACEPACKET];
+	float endx[AAS_TRACEPACKET], endy[AAS_TRACEPACKET], endz[AAS_TRACEPACKET];
+	int stacknodes[AAS_TRACEPACKET], stackmasks[AAS_TRACEPACKET];
+	const float *normal;
+	float dist;
+
+	for (i = 0; i < AAS_TRACEPACKET; i++)
+	{
+		//unused lanes repeat the last trace and are masked off
+		const int t = i < numtraces ? i : numtraces - 1;
+		startx[i] = start[t][0]; starty[i] = start[t][1]; startz[i] = start[t][2];
+		endx[i] = end[t][0]; endy[i] = end[t][1]; endz[i] = end[t][2];
+		firstnodes[i] = 1;
+	} //end for
+	//start with node 1 because node zero is a dummy for a solid leaf
+	stacknodes[0] = 1;
+	stackmasks[0] = (1 << numtraces) - 1;
+	numstack = 1;
+	//the masks on the stack never overlap so there are never more
+	//entries than traces in the packet
+	while (numstack > 0)
+	{
+		numstack--;
+		nodenum = stacknodes[numstack];
+		mask = stackmasks[numstack];
+		//leafs are handled by the scalar trace
+		if (nodenum <= 0)
+		{
+			frontmask = backmask = 0;
+		} //end if
+		else
+		{
+			const aas_node_t& aasnode = aasworld.nodes[nodenum];
+			if (aasworld.pointnodes)
+			{
+				normal = aasworld.pointnodes[nodenum].normal;
+				dist = aasworld.pointnodes[nodenum].dist;
+			} //end if
+			else
+			{
+				normal = aasworld.planes[aasnode.planenum].normal;
+				dist = aasworld.planes[aasnode.planenum].dist;
+			} //end else
+#if idSSE2
+			const __m128 nx = _mm_set1_ps(normal[0]);
+			const __m128 ny = _mm_set1_ps(normal[1]);
+			const __m128 nz = _mm_set1_ps(normal[2]);
+			const __m128 d = _mm_set1_ps(dist);
+			const __m128 zero = _mm_setzero_ps();
+			//same evaluation order as DotProduct so the results match the scalar trace
+			const __m128 front = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+										_mm_mul_ps(_mm_loadu_ps(startx), nx),
+										_mm_mul_ps(_mm_loadu_ps(starty), ny)),
+										_mm_mul_ps(_mm_loadu_ps(startz), nz)), d);
+			const __m128 back = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+										_mm_mul_ps(_mm_loadu_ps(endx), nx),
+										_mm_mul_ps(_mm_loadu_ps(endy), ny)),
+										_mm_mul_ps(_mm_loadu_ps(endz), nz)), d);
+			if (areatrace)
+			{
+				frontmask = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(front, zero), _mm_cmpgt_ps(back, zero)));
+				backmask = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(front, zero), _mm_cmple_ps(back, zero)));
+			} //end if
+			else
+			{
+				frontmask = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(front, zero), _mm_cmpge_ps(back, zero)));
+				backmask = _mm_movemask_ps(_mm_and_ps(_mm_cmplt_ps(front, zero), _mm_cmplt_ps(back, zero)));
+			} //end else
+#else
+			frontmask = backmask = 0;
+			for (i = 0; i < AAS_TRACEPACKET; i++)
+			{
+				const float front = startx[i] * normal[0] + starty[i] * normal[1] + startz[i] * normal[2] - dist;
+				const float back = endx[i] * normal[0] + endy[i] * normal[1] + endz[i] * normal[2] - dist;
+				if (areatrace)
+				{
+					if (front > 0 && back > 0) frontmask |= 1 << i;
+					else if (front <= 0 && back <= 0) backmask |= 1 << i;
+				} //end if
+				else
+				{
+					if (front >= 0 && back >= 0) frontmask |= 1 << i;
+					else if (front < 0 && back < 0) backmask |= 1 << i;
+				} //end else
+			} //end for
+#endif
+			frontmask &= mask;
+			backmask &= mask & ~frontmask;
+			if (frontmask)
+			{
+				stacknodes[numstack] = aasnode.children[0];
+				stackmasks[numstack] = frontmask;
+				numstack++;
+			} //end if
+			if (backmask)
+			{
+				stacknodes[numstack] = aasnode.children[1];
+				stackmasks[numstack] = backmask;
+				numstack++;
+			} //end if
+		} //end else
+		//traces split by this node continue from here
+		mask &= ~(frontmask | backmask);
+		for (i = 0; mask; i++, mask >>= 1)
+		{
+			if (mask & 1) firstnodes[i] = nodenum;
+		} //end for
+	} //end while
+} //end of the function AAS_TracePacketNodes
+//===========================================================================
+// traces several client bounding boxes at once, the results are the same
+// as those of AAS_TraceClientBBox for every line
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void AAS_TraceClientBBoxBatch(const vec3_t *start, const vec3_t *end, int numtraces,
+								int presencetype, int passent, aas_trace_t *traces)
+{
+	int i, j, n, firstnodes[AAS_TRACEPACKET];
+
+	if (!aasworld.loaded)
+	{
+		Com_Memset(traces, 0, numtraces * sizeof(aas_trace_t));
+		return;
+	} //end if
+	for (i = 0; i < numtraces; i += AAS_TRACEPACKET)
+	{
+		n = numtraces - i;
+		if (n > AAS_TRACEPACKET) n = AAS_TRACEPACKET;
+		AAS_TracePacketNodes(start + i, end + i, n, qfalse, firstnodes);
+		for (j = 0; j < n; j++)
+		{
+			traces[i + j] = AAS_TraceClientBBoxFromNode(start[i + j], end[i + j],
+											presencetype, passent, firstnodes[j]);
+		} //end for
+	} //end for
+} //end of the function AAS_TraceClientBBoxBatch
+//===========================================================================
+// stores the areas several traces went through, the areas and points of
+// trace i start at index i * maxareas
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void AAS_TraceAreasBatch(const vec3_t *start, const vec3_t *end, int numtraces,
+							int *areas, vec3_t *points, int maxareas, int *numareas)
+{
+	int i, j, n, firstnodes[AAS_TRACEPACKET];
+
+	if (!aasworld.loaded)
+	{
+		for (i = 0; i < numtraces; i++)
+		{
+			areas[i * maxareas] = 0;
+			numareas[i] = 0;
+		} //end for
+		return;
+	} //end if
+	for (i = 0; i < numtraces; i += AAS_TRACEPACKET)
+	{
+		n = numtraces - i;
+		if (n > AAS_TRACEPACKET) n = AAS_TRACEPACKET;
+		AAS_TracePacketNodes(start + i, end + i, n, qtrue, firstnodes);
+		for (j = 0; j < n; j++)
+		{
+			numareas[i + j] = AAS_TraceAreasFromNode(start[i + j], end[i + j],
+										areas + (i + j) * maxareas,
+										points ? points + (i + j) * maxareas : NULL,
+										maxareas, firstnodes[j]);
+		} //end for
+	} //end for
+} //end of the function AAS_TraceAreasBatch
+//===========================================================================
 // a simple cross product
 //
 // Parameter:				-
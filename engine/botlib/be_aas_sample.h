@@ -56,6 +56,12 @@ int AAS_PointPresenceType(vec3_t point);
 aas_trace_t AAS_TraceClientBBox(vec3_t start, vec3_t end, int presencetype, int passent);
 //stores the areas the trace went through and returns the number of passed areas
 int AAS_TraceAreas( const vec3_t start, const vec3_t end, int *areas, vec3_t *points, int maxareas);
+//traces several client bboxes at once, same results as AAS_TraceClientBBox
+void AAS_TraceClientBBoxBatch(const vec3_t *start, const vec3_t *end, int numtraces,
+								int presencetype, int passent, aas_trace_t *traces);
+//stores the areas several traces went through, the areas and points of trace i start at i * maxareas
+void AAS_TraceAreasBatch(const vec3_t *start, const vec3_t *end, int numtraces,
+							int *areas, vec3_t *points, int maxareas, int *numareas);
 //returns the areas the bounding box is in
 int AAS_BBoxAreas( const vec3_t absmins, const vec3_t absmaxs, int *areas, int maxareas);
 //return area information
@@ -194,6 +194,28 @@ typedef struct {
 	char		chatname[MAX_QPATH];
 } bot_ichatdata_t;
 
+//index over the literal match strings of all the match templates
+//an Aho-Corasick automaton finds all the literals present in a message in
+//a single pass, templates with a string piece none of whose strings is
+//present can't match and are skipped without calling StringsMatch
+typedef struct bot_matchindex_s
+{
+	int numliterals;					//number of distinct literal match strings
+	int numnodes;						//number of automaton states
+	int numsymbols;						//size of the automaton alphabet
+	byte symbols[256];					//character to alphabet symbol, 0 = not in any literal
+	int *transitions;					//numnodes * numsymbols next states
+	int *literal;						//literal ending at each state, -1 if none
+	int *outlink;						//next state on the fail chain with a literal, -1 if none
+	int numtemplates;					//number of match templates
+	int *firstgroup;					//first required group of each template
+	int *numgroups;						//number of required groups of each template
+	int *firstalternative;				//first literal of each group in the alternatives
+	int *numalternatives;				//number of literals of each group
+	int *alternatives;					//literals of the groups, at least one must be present
+	unsigned int *present;				//bit set with the literals found by the last scan
+} bot_matchindex_t;
+
 bot_ichatdata_t	*ichatdata[MAX_CLIENTS];
 
 bot_chatstate_t *botchatstates[MAX_CLIENTS+1];
@@ -202,6 +224,8 @@ bot_consolemessage_t *consolemessageheap = NULL;
 bot_consolemessage_t *freeconsolemessages = NULL;
 //list with match strings
 bot_matchtemplate_t *matchtemplates = NULL;
+//literal index over the match strings
+bot_matchindex_t *matchindex = NULL;
 //list with synonyms
 bot_synonymlist_t *synonyms = NULL;
 //list with random strings
@@ -1438,9 +1462,248 @@ int StringsMatch(bot_matchpiece_t *pieces, bot_match_t *match)
 // Returns:					-
 // Changes Globals:		-
 //===========================================================================
-int BotFindMatch(char *str, bot_match_t *match, unsigned long int context)
+static int BotMatchIndexSymbol(int c)
+{
+	c &= 0xff;
+	if (c < 128) c = toupper(c);
+	return c;
+} //end of the function BotMatchIndexSymbol
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static int BotMatchIndexLiteral(char **literals, int *numliterals, char *string)
 {
 	int i;
+
+	for (i = 0; i < *numliterals; i++)
+	{
+		if (!Q_stricmp(literals[i], string)) return i;
+	} //end for
+	literals[(*numliterals)++] = string;
+	return i;
+} //end of the function BotMatchIndexLiteral
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void BotFreeMatchIndex(bot_matchindex_t *index)
+{
+	if (!index) return;
+	if (index->transitions) FreeMemory(index->transitions);
+	if (index->literal) FreeMemory(index->literal);
+	if (index->outlink) FreeMemory(index->outlink);
+	if (index->firstgroup) FreeMemory(index->firstgroup);
+	if (index->numgroups) FreeMemory(index->numgroups);
+	if (index->firstalternative) FreeMemory(index->firstalternative);
+	if (index->numalternatives) FreeMemory(index->numalternatives);
+	if (index->alternatives) FreeMemory(index->alternatives);
+	if (index->present) FreeMemory(index->present);
+	FreeMemory(index);
+} //end of the function BotFreeMatchIndex
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+bot_matchindex_t *BotBuildMatchIndex(bot_matchtemplate_t *matches)
+{
+	int i, n, c, sym, node, child, fail, numgroups, numalternatives, totallength;
+	int numliterals, *depthqueue, head, tail;
+	char **literals;
+	bot_matchindex_t *index;
+	bot_matchtemplate_t *mt;
+	bot_matchpiece_t *mp;
+	bot_matchstring_t *ms;
+
+	if (!matches) return NULL;
+	index = (bot_matchindex_t *) GetClearedMemory(sizeof(bot_matchindex_t));
+	//count the templates, groups and alternatives
+	numgroups = 0;
+	numalternatives = 0;
+	for (mt = matches; mt; mt = mt->next)
+	{
+		index->numtemplates++;
+		for (mp = mt->first; mp; mp = mp->next)
+		{
+			if (mp->type != MT_STRING) continue;
+			//a piece with an empty string always matches
+			for (ms = mp->firststring; ms; ms = ms->next)
+			{
+				if (!ms->string[0]) break;
+			} //end for
+			if (ms) continue;
+			numgroups++;
+			for (ms = mp->firststring; ms; ms = ms->next) numalternatives++;
+		} //end for
+	} //end for
+	index->firstgroup = (int *) GetClearedMemory(index->numtemplates * sizeof(int));
+	index->numgroups = (int *) GetClearedMemory(index->numtemplates * sizeof(int));
+	index->firstalternative = (int *) GetClearedMemory((numgroups + 1) * sizeof(int));
+	index->numalternatives = (int *) GetClearedMemory((numgroups + 1) * sizeof(int));
+	index->alternatives = (int *) GetClearedMemory((numalternatives + 1) * sizeof(int));
+	literals = (char **) GetClearedMemory((numalternatives + 1) * sizeof(char *));
+	//collect the groups and the distinct literals
+	numliterals = 0;
+	numgroups = 0;
+	numalternatives = 0;
+	for (mt = matches, i = 0; mt; mt = mt->next, i++)
+	{
+		index->firstgroup[i] = numgroups;
+		for (mp = mt->first; mp; mp = mp->next)
+		{
+			if (mp->type != MT_STRING) continue;
+			for (ms = mp->firststring; ms; ms = ms->next)
+			{
+				if (!ms->string[0]) break;
+			} //end for
+			if (ms) continue;
+			index->firstalternative[numgroups] = numalternatives;
+			for (ms = mp->firststring; ms; ms = ms->next)
+			{
+				index->alternatives[numalternatives++] = BotMatchIndexLiteral(literals, &numliterals, ms->string);
+			} //end for
+			index->numalternatives[numgroups] = numalternatives - index->firstalternative[numgroups];
+			numgroups++;
+		} //end for
+		index->numgroups[i] = numgroups - index->firstgroup[i];
+	} //end for
+	index->numliterals = numliterals;
+	index->present = (unsigned int *) GetClearedMemory(((numliterals + 31) >> 5) * sizeof(int) + sizeof(int));
+	//the alphabet only has the characters used by the literals
+	totallength = 0;
+	index->numsymbols = 1;
+	for (i = 0; i < numliterals; i++)
+	{
+		for (n = 0; literals[i][n]; n++)
+		{
+			c = BotMatchIndexSymbol(literals[i][n]);
+			if (!index->symbols[c]) index->symbols[c] = index->numsymbols++;
+		} //end for
+		totallength += n;
+	} //end for
+	//build the trie of the literals
+	index->transitions = (int *) GetClearedMemory((totallength + 1) * index->numsymbols * sizeof(int));
+	index->literal = (int *) GetMemory((totallength + 1) * sizeof(int));
+	index->outlink = (int *) GetMemory((totallength + 1) * sizeof(int));
+	index->literal[0] = -1;
+	index->outlink[0] = -1;
+	index->numnodes = 1;
+	for (i = 0; i < numliterals; i++)
+	{
+		node = 0;
+		for (n = 0; literals[i][n]; n++)
+		{
+			sym = index->symbols[BotMatchIndexSymbol(literals[i][n])];
+			child = index->transitions[node * index->numsymbols + sym];
+			if (!child)
+			{
+				child = index->numnodes++;
+				index->literal[child] = -1;
+				index->outlink[child] = -1;
+				index->transitions[node * index->numsymbols + sym] = child;
+			} //end if
+			node = child;
+		} //end for
+		index->literal[node] = i;
+	} //end for
+	FreeMemory(literals);
+	//breadth first turn the trie into a DFA, the fail state of each state
+	//is the longest proper suffix that's also in the trie
+	depthqueue = (int *) GetMemory(index->numnodes * sizeof(int) * 2);
+	head = tail = 0;
+	for (sym = 0; sym < index->numsymbols; sym++)
+	{
+		child = index->transitions[sym];
+		if (child)
+		{
+			depthqueue[tail++] = child;
+			depthqueue[tail++] = 0;
+		} //end if
+	} //end for
+	while(head < tail)
+	{
+		node = depthqueue[head++];
+		fail = depthqueue[head++];
+		if (index->literal[fail] >= 0) index->outlink[node] = fail;
+		else index->outlink[node] = index->outlink[fail];
+		for (sym = 0; sym < index->numsymbols; sym++)
+		{
+			child = index->transitions[node * index->numsymbols + sym];
+			if (child)
+			{
+				depthqueue[tail++] = child;
+				depthqueue[tail++] = index->transitions[fail * index->numsymbols + sym];
+			} //end if
+			else
+			{
+				index->transitions[node * index->numsymbols + sym] = index->transitions[fail * index->numsymbols + sym];
+			} //end else
+		} //end for
+	} //end while
+	FreeMemory(depthqueue);
+	return index;
+} //end of the function BotBuildMatchIndex
+//===========================================================================
+// marks all the literals present in the string
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void BotMatchIndexScan(bot_matchindex_t *index, char *string)
+{
+	int node, n;
+
+	Com_Memset(index->present, 0, ((index->numliterals + 31) >> 5) * sizeof(int));
+	node = 0;
+	for (; *string; string++)
+	{
+		node = index->transitions[node * index->numsymbols + index->symbols[BotMatchIndexSymbol(*string)]];
+		n = index->literal[node] >= 0 ? node : index->outlink[node];
+		for (; n >= 0; n = index->outlink[n])
+		{
+			index->present[index->literal[n] >> 5] |= 1u << (index->literal[n] & 31);
+		} //end for
+	} //end for
+} //end of the function BotMatchIndexScan
+//===========================================================================
+// returns qfalse if the template can't match the last scanned string
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+int BotMatchIndexCandidate(bot_matchindex_t *index, int templatenum)
+{
+	int i, j, group, literal;
+
+	for (i = 0; i < index->numgroups[templatenum]; i++)
+	{
+		group = index->firstgroup[templatenum] + i;
+		for (j = 0; j < index->numalternatives[group]; j++)
+		{
+			literal = index->alternatives[index->firstalternative[group] + j];
+			if (index->present[literal >> 5] & (1u << (literal & 31))) break;
+		} //end for
+		if (j >= index->numalternatives[group]) return qfalse;
+	} //end for
+	return qtrue;
+} //end of the function BotMatchIndexCandidate
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+int BotFindMatch(char *str, bot_match_t *match, unsigned long int context)
+{
+	int i, templatenum;
 	bot_matchtemplate_t *ms;
 
 	strncpy(match->string, str, MAX_MESSAGE_SIZE);
@@ -1450,10 +1713,14 @@ int BotFindMatch(char *str, bot_match_t *match, unsigned long int context)
 	{
 		match->string[len-1] = '\0';
 	} //end while
+	//find the literal match strings present in the string
+	if (matchindex) BotMatchIndexScan(matchindex, match->string);
 	//compare the string with all the match strings
-	for (ms = matchtemplates; ms; ms = ms->next)
+	for (ms = matchtemplates, templatenum = 0; ms; ms = ms->next, templatenum++)
 	{
 		if (!(ms->context & context)) continue;
+		//skip templates with a string piece that's not in the string
+		if (matchindex && !BotMatchIndexCandidate(matchindex, templatenum)) continue;
 		//reset the match variable offsets
 		for (i = 0; i < MAX_MATCHVARIABLES; i++) match->variables[i].offset = -1;
 		//
@@ -2972,6 +3239,7 @@ int BotSetupChatAI(void)
 	randomstrings = BotLoadRandomStrings(file);
 	file = LibVarString("matchfile", "match.c");
 	matchtemplates = BotLoadMatchTemplates(file);
+	matchindex = BotBuildMatchIndex(matchtemplates);
 	//
 	if (!LibVarValue("nochat", "0"))
 	{
@@ -3016,6 +3284,8 @@ void BotShutdownChatAI(void)
 	} //end for
 	if (consolemessageheap) FreeMemory(consolemessageheap);
 	consolemessageheap = NULL;
+	if (matchindex) BotFreeMatchIndex(matchindex);
+	matchindex = NULL;
 	if (matchtemplates) BotFreeMatchTemplates(matchtemplates);
 	matchtemplates = NULL;
 	if (randomstrings) FreeMemory(randomstrings);
@@ -239,10 +239,10 @@ float AngleDiff(float ang1, float ang2)
 //===========================================================================
 int BotFuzzyPointReachabilityArea(vec3_t origin)
 {
-	int firstareanum, j, x, y, z;
-	int areas[10], numareas, areanum, bestareanum;
+	int firstareanum, i, j, x, y, z;
+	int areas[9][10], numareas[9], areanum, bestareanum;
 	float dist, bestdist;
-	vec3_t points[10], v, end;
+	vec3_t points[9][10], starts[9], ends[9], v, end;
 
 	firstareanum = 0;
 	areanum = AAS_PointAreaNum(origin);
@@ -253,38 +253,45 @@ int BotFuzzyPointReachabilityArea(vec3_t origin)
 	} //end if
 	VectorCopy(origin, end);
 	end[2] += 4;
-	numareas = AAS_TraceAreas(origin, end, areas, points, 10);
-	for (j = 0; j < numareas; j++)
+	numareas[0] = AAS_TraceAreas(origin, end, areas[0], points[0], 10);
+	for (j = 0; j < numareas[0]; j++)
 	{
-		if (AAS_AreaReachability(areas[j])) return areas[j];
+		if (AAS_AreaReachability(areas[0][j])) return areas[0][j];
 	} //end for
 	bestdist = 999999;
 	bestareanum = 0;
 	for (z = 1; z >= -1; z -= 1)
 	{
+		//trace the nine lines of this height together
+		i = 0;
 		for (x = 1; x >= -1; x -= 1)
 		{
 			for (y = 1; y >= -1; y -= 1)
 			{
-				VectorCopy(origin, end);
-				end[0] += x * 8;
-				end[1] += y * 8;
-				end[2] += z * 12;
-				numareas = AAS_TraceAreas(origin, end, areas, points, 10);
-				for (j = 0; j < numareas; j++)
+				VectorCopy(origin, starts[i]);
+				VectorCopy(origin, ends[i]);
+				ends[i][0] += x * 8;
+				ends[i][1] += y * 8;
+				ends[i][2] += z * 12;
+				i++;
+			} //end for
+		} //end for
+		AAS_TraceAreasBatch(starts, ends, 9, areas[0], points[0], 10, numareas);
+		for (i = 0; i < 9; i++)
+		{
+			for (j = 0; j < numareas[i]; j++)
+			{
+				if (AAS_AreaReachability(areas[i][j]))
 				{
-					if (AAS_AreaReachability(areas[j]))
+					VectorSubtract(points[i][j], origin, v);
+					dist = VectorLength(v);
+					if (dist < bestdist)
 					{
-						VectorSubtract(points[j], origin, v);
-						dist = VectorLength(v);
-						if (dist < bestdist)
-						{
-							bestareanum = areas[j];
-							bestdist = dist;
-						} //end if
+						bestareanum = areas[i][j];
+						bestdist = dist;
 					} //end if
-					if (!firstareanum) firstareanum = areas[j];
-				} //end for
+				} //end if
+				if (!firstareanum) firstareanum = areas[i][j];
 			} //end for
 		} //end for
 		if (bestareanum) return bestareanum;
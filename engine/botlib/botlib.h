@@ -191,6 +191,8 @@ typedef struct botlib_import_s
 	void		(*FreeMemory)(void *ptr);		// free memory from Zone
 	int			(*AvailableMemory)(void);		// available Zone memory
 	void		*(*HunkAlloc)(int size);		// allocate from hunk
+	//read-only data shared with the other server processes, NULL when unavailable
+	const void	*(*SharedData)(const char *name, int size, void (*build)(void *data, void *context), void *context);
 	//file system access
 	int			(*FS_FOpenFile)( const char *qpath, fileHandle_t *file, fsMode_t mode );
 	int			(*FS_Read)( void *buffer, int len, fileHandle_t f );
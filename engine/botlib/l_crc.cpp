@@ -149,3 +149,38 @@ void CRC_ContinueProcessString(unsigned short *crc, char *data, int length)
 		*crc = (*crc << 8) ^ crctable[(*crc >> 8) ^ data[i]];
 	} //end for
 } //end of the function CRC_ProcessString
+//===========================================================================
+// 32 bit reflected CRC using the polynomial 0xedb88320 (zip/png CRC-32),
+// used where the 16 bit CRC is too weak to detect file changes
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+unsigned int CRC_ProcessString32(const unsigned char *data, int length)
+{
+	static unsigned int crc32table[256];
+	static int crc32tableinitialized;
+	unsigned int crcvalue, c;
+	int i, j;
+
+	if (!crc32tableinitialized)
+	{
+		for (i = 0; i < 256; i++)
+		{
+			c = i;
+			for (j = 0; j < 8; j++)
+			{
+				c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+			} //end for
+			crc32table[i] = c;
+		} //end for
+		crc32tableinitialized = qtrue;
+	} //end if
+	crcvalue = 0xffffffff;
+	for (i = 0; i < length; i++)
+	{
+		crcvalue = crc32table[(crcvalue ^ data[i]) & 0xff] ^ (crcvalue >> 8);
+	} //end for
+	return crcvalue ^ 0xffffffff;
+} //end of the function CRC_ProcessString32
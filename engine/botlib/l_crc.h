@@ -27,3 +27,4 @@ void CRC_ProcessByte(unsigned short *crcvalue, byte data);
 unsigned short CRC_Value(unsigned short crcvalue);
 unsigned short CRC_ProcessString(unsigned char *data, int length);
 void CRC_ContinueProcessString(unsigned short *crc, char *data, int length);
+unsigned int CRC_ProcessString32(const unsigned char *data, int length);
@@ -60,6 +60,8 @@ typedef enum {qfalse, qtrue}	qbool;
 #include "l_script.h"
 #include "l_precomp.h"
 #include "l_log.h"
+#include "l_libvar.h"
+#include "l_crc.h"
 #endif //BOTLIB
 
 #ifdef MEQCC
@@ -114,6 +116,63 @@ token_t *freetokens;					//free tokens from the heap
 //list with global defines added to every source loaded
 define_t *globaldefines;
 
+#ifdef BOTLIB
+//the precompiled token cache stores the fully preprocessed token stream of a
+//source (includes read, defines expanded, directives evaluated) so sources
+//with unchanged files can be replayed without running the precompiler
+#define PCCACHE_IDENT			(('C'<<24)+('C'<<16)+('P'<<8)+'B')
+#define PCCACHE_VERSION			1
+#define PCCACHE_FOLDER			"botcache"
+#define PCCACHE_MAXFILES		32
+#define PCCACHE_INITIALSIZE		0x10000
+
+//file the cached tokens were read from
+typedef struct pccachefile_s
+{
+	char filename[MAX_QPATH];				//file name relative to the base folder
+	unsigned int checksum;					//CRC-32 of the file contents
+} pccachefile_t;
+
+//cache file header
+typedef struct pccacheheader_s
+{
+	int ident;
+	int version;
+	unsigned int definechecksum;			//checksum of the global defines
+	int numfiles;							//number of pccachefile_t following the header
+	int numtokens;							//number of tokens following the files
+	int tokensize;							//size of the token data in bytes
+} pccacheheader_t;
+
+//token as stored in the cache, followed by length + 1 string characters
+typedef struct pccachetoken_s
+{
+	int type;
+	int subtype;
+	int line;
+	int length;
+	unsigned long int intvalue;
+	double floatvalue;
+} pccachetoken_t;
+
+typedef struct pccache_s
+{
+	int replaying;							//qtrue if replaying, qfalse if recording
+	int error;								//qtrue if a source error occured while recording
+	int eof;								//qtrue if the whole source was read while recording
+	int lasttoken;							//offset of the last recorded token, -1 if none
+	char basefolder[MAX_QPATH];				//base folder the source was loaded from
+	pccacheheader_t header;
+	pccachefile_t files[PCCACHE_MAXFILES];
+	byte *data;								//token data
+	int size;								//allocated size of the token data
+	int offset;								//write offset when recording, read offset when replaying
+} pccache_t;
+
+static void PC_CacheAddFile(pccache_t *cache, script_t *script);
+static void PC_CacheUnrecordToken(pccache_t *cache);
+#endif //BOTLIB
+
 void QDECL SourceError(source_t *source, PRINTF_FORMAT_STRING char *str, ...)
 {
 	char text[1024];
@@ -123,6 +182,7 @@ void QDECL SourceError(source_t *source, PRINTF_FORMAT_STRING char *str, ...)
 	vsprintf(text, str, ap);
 	va_end(ap);
 #ifdef BOTLIB
+	if (source->cache) source->cache->error = qtrue;
 	botimport.Print(PRT_ERROR, "file %s, line %d: %s\n", source->scriptstack->filename, source->scriptstack->line, text);
 #endif	//BOTLIB
 #ifdef MEQCC
@@ -196,6 +256,9 @@ void PC_PushScript(source_t *source, script_t *script)
 	//push the script on the script stack
 	script->next = source->scriptstack;
 	source->scriptstack = script;
+#ifdef BOTLIB
+	if (source->cache && !source->cache->replaying) PC_CacheAddFile(source->cache, script);
+#endif //BOTLIB
 } 
 
 void PC_InitTokenHeap(void)
@@ -301,6 +364,13 @@ int PC_ReadSourceToken(source_t *source, token_t *token)
 //============================================================================
 int PC_UnreadSourceToken(source_t *source, token_t *token)
 {
+#ifdef BOTLIB
+	//a token unread by the caller of PC_ReadToken will be read and recorded again
+	if (source->cache && !source->cache->replaying && !source->readdepth)
+	{
+		PC_CacheUnrecordToken(source->cache);
+	} //end if
+#endif //BOTLIB
 	token_t *t = PC_CopyToken(token);
 	t->next = source->tokens;
 	source->tokens = t;
@@ -2607,13 +2677,312 @@ int QuakeCMacro(source_t *source)
 	return qtrue;
 } //end of the function QuakeCMacro
 #endif //QUAKEC
+#ifdef BOTLIB
 //============================================================================
 //
 // Parameter:				-
 // Returns:					-
 // Changes Globals:		-
 //============================================================================
-int PC_ReadToken(source_t *source, token_t *token)
+static int PC_CacheEnabled(void)
+{
+	return LibVarValue("precompcache", "1") != 0;
+} //end of the function PC_CacheEnabled
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_CachePath(const char *filename, char *path, int size)
+{
+	//sources loaded through handles by the game and ui have no base folder
+	if (PS_BaseFolder()[0]) Com_sprintf(path, size, "%s/%s/%s.pcc", PCCACHE_FOLDER, PS_BaseFolder(), filename);
+	else Com_sprintf(path, size, "%s/%s.pcc", PCCACHE_FOLDER, filename);
+} //end of the function PC_CachePath
+//============================================================================
+// the global defines are added to every source so they're part of the key
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static unsigned int PC_GlobalDefinesChecksum(void)
+{
+	unsigned int checksum;
+	define_t *define;
+	token_t *t;
+
+	checksum = 0;
+	for (define = globaldefines; define; define = define->next)
+	{
+		checksum = ((checksum << 5) | (checksum >> 27)) ^
+			CRC_ProcessString32((unsigned char *) define->name, strlen(define->name));
+		for (t = define->parms; t; t = t->next)
+		{
+			checksum = ((checksum << 5) | (checksum >> 27)) ^
+				CRC_ProcessString32((unsigned char *) t->string, strlen(t->string));
+		} //end for
+		for (t = define->tokens; t; t = t->next)
+		{
+			checksum = ((checksum << 5) | (checksum >> 27)) ^
+				CRC_ProcessString32((unsigned char *) t->string, strlen(t->string));
+		} //end for
+	} //end for
+	return checksum;
+} //end of the function PC_GlobalDefinesChecksum
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_CacheAddFile(pccache_t *cache, script_t *script)
+{
+	pccachefile_t *file;
+
+	if (cache->header.numfiles >= PCCACHE_MAXFILES)
+	{
+		//too many includes to validate, don't write the cache
+		cache->error = qtrue;
+		return;
+	} //end if
+	file = &cache->files[cache->header.numfiles++];
+	Q_strncpyz(file->filename, script->filename, sizeof(file->filename));
+	file->checksum = script->checksum;
+} //end of the function PC_CacheAddFile
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_CacheRecordToken(pccache_t *cache, token_t *token)
+{
+	pccachetoken_t cachetoken;
+	int length, size, newsize;
+	byte *data;
+
+	length = strlen(token->string);
+	size = sizeof(pccachetoken_t) + length + 1;
+	if (cache->offset + size > cache->size)
+	{
+		newsize = cache->size ? cache->size : PCCACHE_INITIALSIZE;
+		while(cache->offset + size > newsize) newsize <<= 1;
+		data = (byte *) GetMemory(newsize);
+		if (cache->data)
+		{
+			Com_Memcpy(data, cache->data, cache->offset);
+			FreeMemory(cache->data);
+		} //end if
+		cache->data = data;
+		cache->size = newsize;
+	} //end if
+	Com_Memset(&cachetoken, 0, sizeof(pccachetoken_t));
+	cachetoken.type = token->type;
+	cachetoken.subtype = token->subtype;
+	cachetoken.line = token->line;
+	cachetoken.length = length;
+	cachetoken.intvalue = token->intvalue;
+	cachetoken.floatvalue = token->floatvalue;
+	Com_Memcpy(cache->data + cache->offset, &cachetoken, sizeof(pccachetoken_t));
+	Com_Memcpy(cache->data + cache->offset + sizeof(pccachetoken_t), token->string, length + 1);
+	cache->lasttoken = cache->offset;
+	cache->offset += size;
+	cache->header.numtokens++;
+} //end of the function PC_CacheRecordToken
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_CacheUnrecordToken(pccache_t *cache)
+{
+	if (cache->lasttoken < 0)
+	{
+		//only the last read token can be taken back
+		cache->error = qtrue;
+		return;
+	} //end if
+	cache->offset = cache->lasttoken;
+	cache->lasttoken = -1;
+	cache->header.numtokens--;
+} //end of the function PC_CacheUnrecordToken
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static int PC_ReadCachedToken(source_t *source, token_t *token)
+{
+	pccache_t *cache;
+	pccachetoken_t cachetoken;
+
+	cache = source->cache;
+	//unread tokens first
+	if (source->tokens)
+	{
+		PC_ReadSourceToken(source, token);
+	} //end if
+	else
+	{
+		if (cache->offset + (int) sizeof(pccachetoken_t) > cache->size) return qfalse;
+		Com_Memcpy(&cachetoken, cache->data + cache->offset, sizeof(pccachetoken_t));
+		if (cachetoken.length < 0 || cachetoken.length >= MAX_TOKEN ||
+			cache->offset + (int) sizeof(pccachetoken_t) + cachetoken.length + 1 > cache->size)
+		{
+			SourceError(source, "corrupt precompiled cache");
+			cache->offset = cache->size;
+			return qfalse;
+		} //end if
+		Com_Memset(token, 0, sizeof(token_t));
+		Com_Memcpy(token->string, cache->data + cache->offset + sizeof(pccachetoken_t), cachetoken.length + 1);
+		token->type = cachetoken.type;
+		token->subtype = cachetoken.subtype;
+		token->line = cachetoken.line;
+		token->intvalue = cachetoken.intvalue;
+		token->floatvalue = cachetoken.floatvalue;
+		cache->offset += sizeof(pccachetoken_t) + cachetoken.length + 1;
+	} //end else
+	//keep source errors pointing at the right line
+	source->scriptstack->line = token->line;
+	//copy token for unreading
+	Com_Memcpy(&source->token, token, sizeof(token_t));
+	return qtrue;
+} //end of the function PC_ReadCachedToken
+//============================================================================
+// loads the precompiled cache for the given file, returns NULL if there's
+// no cache or any of the files it was built from changed
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static pccache_t *PC_LoadCache(const char *filename)
+{
+	fileHandle_t fp;
+	char path[MAX_QPATH];
+	int length, i;
+	unsigned int checksum;
+	pccache_t *cache;
+	pccacheheader_t *header;
+
+	PC_CachePath(filename, path, sizeof(path));
+	length = botimport.FS_FOpenFile(path, &fp, FS_READ);
+	if (!fp) return NULL;
+	cache = (pccache_t *) GetClearedMemory(sizeof(pccache_t));
+	header = &cache->header;
+	if (length < (int) sizeof(pccacheheader_t))
+	{
+		botimport.FS_FCloseFile(fp);
+		FreeMemory(cache);
+		return NULL;
+	} //end if
+	botimport.FS_Read(header, sizeof(pccacheheader_t), fp);
+	if (header->ident != PCCACHE_IDENT || header->version != PCCACHE_VERSION ||
+		header->definechecksum != PC_GlobalDefinesChecksum() ||
+		header->numfiles < 1 || header->numfiles > PCCACHE_MAXFILES ||
+		header->numtokens < 0 || header->tokensize < 0 ||
+		length != (int) (sizeof(pccacheheader_t) + header->numfiles * sizeof(pccachefile_t)) + header->tokensize)
+	{
+		botimport.FS_FCloseFile(fp);
+		FreeMemory(cache);
+		return NULL;
+	} //end if
+	botimport.FS_Read(cache->files, header->numfiles * sizeof(pccachefile_t), fp);
+	cache->data = (byte *) GetMemory(header->tokensize + 1);
+	cache->size = header->tokensize;
+	botimport.FS_Read(cache->data, header->tokensize, fp);
+	botimport.FS_FCloseFile(fp);
+	//the first file is the source itself, the others are included files
+	cache->files[0].filename[MAX_QPATH-1] = '\0';
+	if (Q_stricmp(cache->files[0].filename, filename))
+	{
+		FreeMemory(cache->data);
+		FreeMemory(cache);
+		return NULL;
+	} //end if
+	for (i = 0; i < header->numfiles; i++)
+	{
+		cache->files[i].filename[MAX_QPATH-1] = '\0';
+		if (PS_FileChecksum(cache->files[i].filename, &checksum) < 0 ||
+			checksum != cache->files[i].checksum)
+		{
+			FreeMemory(cache->data);
+			FreeMemory(cache);
+			return NULL;
+		} //end if
+	} //end for
+	cache->replaying = qtrue;
+	cache->offset = 0;
+	cache->lasttoken = -1;
+	return cache;
+} //end of the function PC_LoadCache
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_WriteCache(source_t *source)
+{
+	fileHandle_t fp;
+	char path[MAX_QPATH];
+	pccache_t *cache;
+
+	cache = source->cache;
+	PC_CachePath(source->filename, path, sizeof(path));
+	botimport.FS_FOpenFile(path, &fp, FS_WRITE);
+	if (!fp) return;
+	cache->header.ident = PCCACHE_IDENT;
+	cache->header.version = PCCACHE_VERSION;
+	cache->header.tokensize = cache->offset;
+	botimport.FS_Write(&cache->header, sizeof(pccacheheader_t), fp);
+	botimport.FS_Write(cache->files, cache->header.numfiles * sizeof(pccachefile_t), fp);
+	if (cache->offset) botimport.FS_Write(cache->data, cache->offset, fp);
+	botimport.FS_FCloseFile(fp);
+} //end of the function PC_WriteCache
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_FreeCache(source_t *source)
+{
+	pccache_t *cache;
+	token_t token;
+	char basefolder[MAX_QPATH];
+
+	cache = source->cache;
+	if (!cache->replaying && !cache->error)
+	{
+		//handles can be freed after other sources changed the base folder
+		Q_strncpyz(basefolder, PS_BaseFolder(), sizeof(basefolder));
+		PS_SetBaseFolder(cache->basefolder);
+		//readers like BotLoadCharacterFromFile stop once they found what they
+		//were looking for, but the next reader may want what comes after it
+		if (!cache->eof)
+		{
+			while(PC_ReadToken(source, &token)) ;
+		} //end if
+		if (cache->eof && !cache->error) PC_WriteCache(source);
+		PS_SetBaseFolder(basefolder);
+	} //end if
+	if (cache->data) FreeMemory(cache->data);
+	FreeMemory(cache);
+	source->cache = NULL;
+} //end of the function PC_FreeCache
+#endif //BOTLIB
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static int PC_ReadExpandedToken(source_t *source, token_t *token)
 {
 	define_t *define;
 
@@ -2689,6 +3058,35 @@ int PC_ReadToken(source_t *source, token_t *token)
 		//found a token
 		return qtrue;
 	} //end while
+} //end of the function PC_ReadExpandedToken
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+int PC_ReadToken(source_t *source, token_t *token)
+{
+	int result;
+
+#ifdef BOTLIB
+	if (source->cache && source->cache->replaying)
+	{
+		return PC_ReadCachedToken(source, token);
+	} //end if
+#endif //BOTLIB
+	source->readdepth++;
+	result = PC_ReadExpandedToken(source, token);
+	source->readdepth--;
+#ifdef BOTLIB
+	//only record the tokens returned to the caller
+	if (source->cache && !source->readdepth)
+	{
+		if (result) PC_CacheRecordToken(source->cache, token);
+		else if (!source->scriptstack->next && !*source->scriptstack->script_p) source->cache->eof = qtrue;
+	} //end if
+#endif //BOTLIB
+	return result;
 } //end of the function PC_ReadToken
 //============================================================================
 //
@@ -2895,9 +3293,36 @@ source_t *LoadSourceFile(const char *filename)
 {
 	source_t *source;
 	script_t *script;
+#ifdef BOTLIB
+	pccache_t *cache;
+	char empty[1] = "";
+#endif //BOTLIB
 
 	PC_InitTokenHeap();
 
+#ifdef BOTLIB
+	cache = NULL;
+	if (PC_CacheEnabled())
+	{
+		cache = PC_LoadCache(filename);
+		if (cache)
+		{
+			//errors are still reported with the name of the source
+			script = LoadScriptMemory(empty, 0, (char *) filename);
+			script->next = NULL;
+
+			source = (source_t *) GetClearedMemory(sizeof(source_t));
+			strncpy(source->filename, filename, MAX_PATH);
+			source->scriptstack = script;
+			source->cache = cache;
+#if DEFINEHASHING
+			source->definehash = (define_t**)GetClearedMemory(DEFINEHASHSIZE * sizeof(define_t *));
+#endif //DEFINEHASHING
+			return source;
+		} //end if
+	} //end if
+#endif //BOTLIB
+
 	script = LoadScriptFile(filename);
 	if (!script) return NULL;
 
@@ -2917,6 +3342,18 @@ source_t *LoadSourceFile(const char *filename)
 	source->definehash = (define_t**)GetClearedMemory(DEFINEHASHSIZE * sizeof(define_t *));
 #endif //DEFINEHASHING
 	PC_AddGlobalDefinesToSource(source);
+#ifdef BOTLIB
+	//record the preprocessed tokens for the next time the source is loaded
+	if (PC_CacheEnabled())
+	{
+		cache = (pccache_t *) GetClearedMemory(sizeof(pccache_t));
+		cache->lasttoken = -1;
+		Q_strncpyz(cache->basefolder, PS_BaseFolder(), sizeof(cache->basefolder));
+		cache->header.definechecksum = PC_GlobalDefinesChecksum();
+		PC_CacheAddFile(cache, script);
+		source->cache = cache;
+	} //end if
+#endif //BOTLIB
 	return source;
 } //end of the function LoadSourceFile
 //============================================================================
@@ -2966,6 +3403,9 @@ void FreeSource(source_t *source)
 	indent_t *indent;
 	int i;
 
+#ifdef BOTLIB
+	if (source->cache) PC_FreeCache(source);
+#endif //BOTLIB
 	//PC_PrintDefineHashTable(source->definehash);
 	//free all the scripts
 	while(source->scriptstack)
@@ -104,6 +104,8 @@ typedef struct source_s
 	indent_t *indentstack;					//stack with indents
 	int skip;								// > 0 if skipping conditional code
 	token_t token;							//last read token
+	int readdepth;							//PC_ReadToken recursion depth
+	struct pccache_s *cache;				//precompiled token cache being recorded or replayed
 } source_t;
 
 
@@ -53,6 +53,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "l_memory.h"
 #include "l_log.h"
 #include "l_libvar.h"
+#include "l_crc.h"
 #endif //BOTLIB
 
 #ifdef MEQCC
@@ -1344,6 +1345,7 @@ script_t *LoadScriptFile(const char *filename)
 #ifdef BOTLIB
 	botimport.FS_Read(script->buffer, length, fp);
 	botimport.FS_FCloseFile(fp);
+	script->checksum = CRC_ProcessString32((unsigned char *) script->buffer, length);
 #else
 	if (fread(script->buffer, length, 1, fp) != 1)
 	{
@@ -1390,6 +1392,9 @@ script_t *LoadScriptMemory(char *ptr, int length, char *name)
 	SetScriptPunctuations(script, NULL);
 	//
 	Com_Memcpy(script->buffer, ptr, length);
+#ifdef BOTLIB
+	script->checksum = CRC_ProcessString32((unsigned char *) script->buffer, length);
+#endif
 	//
 	return script;
 } //end of the function LoadScriptMemory
@@ -1420,3 +1425,41 @@ void PS_SetBaseFolder(char *path)
 	Com_sprintf(basefolder, sizeof(basefolder), path);
 #endif
 } //end of the function PS_SetBaseFolder
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+char *PS_BaseFolder(void)
+{
+	return basefolder;
+} //end of the function PS_BaseFolder
+#ifdef BOTLIB
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+int PS_FileChecksum(const char *filename, unsigned int *checksum)
+{
+	fileHandle_t fp;
+	char pathname[MAX_QPATH];
+	int length;
+	void *buffer;
+
+	if (basefolder[0])
+		Com_sprintf(pathname, sizeof(pathname), "%s/%s", basefolder, filename);
+	else
+		Com_sprintf(pathname, sizeof(pathname), "%s", filename);
+	length = botimport.FS_FOpenFile( pathname, &fp, FS_READ );
+	if (!fp) return -1;
+	buffer = GetMemory(length + 1);
+	botimport.FS_Read(buffer, length, fp);
+	botimport.FS_FCloseFile(fp);
+	*checksum = CRC_ProcessString32((unsigned char *) buffer, length);
+	FreeMemory(buffer);
+	return length;
+} //end of the function PS_FileChecksum
+#endif //BOTLIB
@@ -185,6 +185,7 @@ typedef struct script_s
 	int lastline;					//line before reading token
 	int tokenavailable;				//set by UnreadLastToken
 	int flags;						//several script flags
+	unsigned int checksum;			//CRC-32 of the script text as loaded
 	punctuation_t *punctuations;	//the punctuations used in the script
 	punctuation_t **punctuationtable;
 	token_t token;					//available token
@@ -239,6 +240,10 @@ script_t *LoadScriptMemory(char *ptr, int length, char *name);
 void FreeScript(script_t *script);
 //set the base folder to load files from
 void PS_SetBaseFolder(char *path);
+//returns the base folder files are loaded from
+char *PS_BaseFolder(void);
+//returns the length of the given file and its CRC-32, -1 if the file is not found
+int PS_FileChecksum(const char *filename, unsigned int *checksum);
 //print a script error with filename and line number
 void QDECL ScriptError(script_t *script, PRINTF_FORMAT_STRING char *str, ...);
 //print a script warning with filename and line number
@@ -386,7 +386,7 @@ void CL_SystemInfoChanged()
 		// ehw!
 		if (!Q_stricmp(key, "fs_game"))
 		{
-			if (FS_CheckDirTraversal(value))
+			if (FS_CheckDirTraversal(value) || (value[0] && !FS_IsGameDirAllowed(value)))
 			{
 				Com_Printf("WARNING: Server sent invalid fs_game value %s\n", value);
 				continue;
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <fcntl.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #if defined(__linux__)
 #include <sys/sysinfo.h>
@@ -35,7 +36,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 #include <dirent.h>
 #include <errno.h>
+#include <signal.h>
 #include <inttypes.h>
+#include <pthread.h>
 #ifdef DEDICATED
 #include <sys/wait.h>
 #endif
@@ -523,6 +526,369 @@ void Sys_Mkdir( const char* path )
 }
 
 
+const void* Sys_MapFileRead( const char* path, int* size )
+{
+	*size = 0;
+
+	const int fd = open( path, O_RDONLY );
+	if ( fd == -1 )
+		return NULL;
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_size <= 0 || st.st_size > 0x7FFFFFFF ) {
+		close( fd );
+		return NULL;
+	}
+
+	// the mapping keeps its own reference to the file
+	void* const data = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	*size = (int)st.st_size;
+
+	return data;
+}
+
+
+void Sys_UnmapFile( const void* data, int size )
+{
+	if ( data != NULL )
+		munmap( (void*)data, (size_t)size );
+}
+
+
+#define MAX_PARALLEL_THREADS	16
+
+typedef struct {
+	void		(*func)( void* data, int index );
+	void*		data;
+	int			count;
+	volatile int next;
+} parallelJob_t;
+
+
+static void* Sys_ParallelWorker( void* arg )
+{
+	parallelJob_t* const job = (parallelJob_t*)arg;
+
+	for (;;) {
+		const int index = __sync_fetch_and_add( &job->next, 1 );
+		if ( index >= job->count )
+			break;
+		job->func( job->data, index );
+	}
+
+	return NULL;
+}
+
+
+void Sys_ParallelFor( int count, int maxThreads, void (*func)( void* data, int index ), void* data )
+{
+	if ( maxThreads <= 0 )
+		maxThreads = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	maxThreads = min( maxThreads, min( count, MAX_PARALLEL_THREADS ) );
+
+	parallelJob_t job;
+	job.func = func;
+	job.data = data;
+	job.count = count;
+	job.next = 0;
+
+	// the calling thread is a worker too, so failing to start threads only costs speed
+	pthread_t threads[MAX_PARALLEL_THREADS];
+	int numThreads = 0;
+	for ( int i = 1; i < maxThreads; ++i ) {
+		if ( pthread_create( &threads[numThreads], NULL, Sys_ParallelWorker, &job ) != 0 )
+			break;
+		numThreads++;
+	}
+
+	Sys_ParallelWorker( &job );
+
+	for ( int i = 0; i < numThreads; ++i ) {
+		pthread_join( threads[i], NULL );
+	}
+}
+
+
+typedef struct {
+	pthread_t	thread;
+	void		(*func)( void* data );
+	void*		data;
+} sysThread_t;
+
+
+static void* Sys_ThreadMain( void* arg )
+{
+	sysThread_t* const thread = (sysThread_t*)arg;
+
+	thread->func( thread->data );
+
+	return NULL;
+}
+
+
+void* Sys_StartThread( void (*func)( void* data ), void* data )
+{
+	sysThread_t* const thread = Z_New<sysThread_t>();
+	thread->func = func;
+	thread->data = data;
+
+	if ( pthread_create( &thread->thread, NULL, Sys_ThreadMain, thread ) != 0 ) {
+		Z_Free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+
+void Sys_JoinThread( void* thread )
+{
+	pthread_join( ((sysThread_t*)thread)->thread, NULL );
+	Z_Free( thread );
+}
+
+
+typedef struct {
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	qbool			signalled;
+} sysThreadEvent_t;
+
+
+void* Sys_CreateEvent()
+{
+	sysThreadEvent_t* const event = Z_New<sysThreadEvent_t>();
+	event->signalled = qfalse;
+
+	if ( pthread_mutex_init( &event->mutex, NULL ) != 0 ) {
+		Z_Free( event );
+		return NULL;
+	}
+
+	if ( pthread_cond_init( &event->cond, NULL ) != 0 ) {
+		pthread_mutex_destroy( &event->mutex );
+		Z_Free( event );
+		return NULL;
+	}
+
+	return event;
+}
+
+
+void Sys_DestroyEvent( void* event )
+{
+	sysThreadEvent_t* const e = (sysThreadEvent_t*)event;
+	pthread_cond_destroy( &e->cond );
+	pthread_mutex_destroy( &e->mutex );
+	Z_Free( e );
+}
+
+
+void Sys_SignalEvent( void* event )
+{
+	sysThreadEvent_t* const e = (sysThreadEvent_t*)event;
+	pthread_mutex_lock( &e->mutex );
+	e->signalled = qtrue;
+	pthread_cond_signal( &e->cond );
+	pthread_mutex_unlock( &e->mutex );
+}
+
+
+void Sys_WaitEvent( void* event )
+{
+	sysThreadEvent_t* const e = (sysThreadEvent_t*)event;
+	pthread_mutex_lock( &e->mutex );
+	while ( !e->signalled ) {
+		pthread_cond_wait( &e->cond, &e->mutex );
+	}
+	e->signalled = qfalse;
+	pthread_mutex_unlock( &e->mutex );
+}
+
+
+#define HUGE_PAGE_SIZE	(2 << 20)
+#define SMALL_PAGE_SIZE	4096
+
+
+void* Sys_AllocLargeMemory( int size, int hugePages, const char** description )
+{
+	const size_t alignedSize = ( (size_t)size + HUGE_PAGE_SIZE - 1 ) & ~(size_t)( HUGE_PAGE_SIZE - 1 );
+
+#if defined( MAP_HUGETLB )
+	// needs pages reserved through vm.nr_hugepages, fails otherwise
+	if ( hugePages >= 2 ) {
+		void* const data = mmap( NULL, alignedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0 );
+		if ( data != MAP_FAILED ) {
+			*description = "pre-faulted MAP_HUGETLB pages";
+			return data;
+		}
+	}
+#endif
+
+	if ( hugePages >= 1 ) {
+		// over-allocate so the region can start on a huge page boundary
+		const size_t mapSize = alignedSize + HUGE_PAGE_SIZE;
+		byte* const base = (byte*)mmap( NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if ( base != MAP_FAILED ) {
+			byte* const data = (byte*)( ( (uintptr_t)base + HUGE_PAGE_SIZE - 1 ) & ~(uintptr_t)( HUGE_PAGE_SIZE - 1 ) );
+			if ( data != base )
+				munmap( base, data - base );
+			if ( data + alignedSize != base + mapSize )
+				munmap( data + alignedSize, ( base + mapSize ) - ( data + alignedSize ) );
+
+			qbool transparent = qfalse;
+#if defined( MADV_HUGEPAGE )
+			transparent = madvise( data, alignedSize, MADV_HUGEPAGE ) == 0;
+#endif
+			// fault everything in now instead of during the first map load
+			volatile byte* const touch = data;
+			for ( size_t i = 0; i < alignedSize; i += SMALL_PAGE_SIZE ) {
+				touch[i] = 0;
+			}
+
+			*description = transparent ? "pre-faulted transparent huge pages" : "pre-faulted regular pages";
+			return data;
+		}
+	}
+
+	*description = "regular pages";
+
+	return calloc( size, 1 );
+}
+
+
+void* Sys_CreateSharedMemory( const char* name, int size )
+{
+	const int fd = shm_open( name, O_CREAT | O_EXCL | O_RDWR, 0600 );
+	if ( fd == -1 )
+		return NULL;
+
+	if ( ftruncate( fd, (off_t)size ) != 0 ) {
+		close( fd );
+		shm_unlink( name );
+		return NULL;
+	}
+
+	void* const data = mmap( NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( data == MAP_FAILED ) {
+		shm_unlink( name );
+		return NULL;
+	}
+
+	return data;
+}
+
+
+const void* Sys_OpenSharedMemory( const char* name, int size )
+{
+	const int fd = shm_open( name, O_RDONLY, 0 );
+	if ( fd == -1 )
+		return NULL;
+
+	// the names are predictable, so only trust what our own user created
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_uid != geteuid() || st.st_size != (off_t)size ) {
+		close( fd );
+		return NULL;
+	}
+
+	void* const data = mmap( NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	return data;
+}
+
+
+void Sys_SealSharedMemory( void* data, int size )
+{
+	mprotect( data, (size_t)size, PROT_READ );
+}
+
+
+void Sys_CloseSharedMemory( const void* data, int size )
+{
+	munmap( (void*)data, (size_t)size );
+}
+
+
+void Sys_RemoveSharedMemory( const char* name )
+{
+	shm_unlink( name );
+}
+
+
+int Sys_SharedMemoryAge( const char* name )
+{
+	const int fd = shm_open( name, O_RDONLY, 0 );
+	if ( fd == -1 )
+		return -1;
+
+	struct stat st;
+	const int result = fstat( fd, &st );
+	close( fd );
+	if ( result != 0 )
+		return -1;
+
+	// writes through a mapping update the time stamps as well
+	const time_t changed = max( st.st_mtime, st.st_ctime );
+
+	return (int)max( time( NULL ) - changed, (time_t)0 );
+}
+
+
+int Sys_RemoveAllSharedMemory( const char* prefix )
+{
+	// shm_open names live in /dev/shm without their leading slash
+	DIR* const dir = opendir( "/dev/shm" );
+	if ( dir == NULL )
+		return 0;
+
+	const size_t prefixLength = strlen( prefix + 1 );
+	int count = 0;
+	struct dirent* d;
+	while ( ( d = readdir( dir ) ) != NULL ) {
+		if ( strncmp( d->d_name, prefix + 1, prefixLength ) != 0 )
+			continue;
+
+		struct stat st;
+		if ( fstatat( dirfd( dir ), d->d_name, &st, 0 ) != 0 || st.st_uid != geteuid() )
+			continue;
+
+		// processes that have it mapped keep their view
+		if ( shm_unlink( va( "/%s", d->d_name ) ) == 0 )
+			count++;
+	}
+	closedir( dir );
+
+	return count;
+}
+
+
+void Sys_MemoryBarrier()
+{
+	__sync_synchronize();
+}
+
+
+int Sys_GetProcessID()
+{
+	return (int)getpid();
+}
+
+
+qbool Sys_IsProcessAlive( int pid )
+{
+	return kill( (pid_t)pid, 0 ) == 0 || errno == EPERM;
+}
+
+
 #define	MAX_FOUND_FILES	0x1000
 
 // bk001129 - new in 1.26
@@ -26,9 +26,6 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../qcommon/tr_types.h"
 
-
-#define	MAX_ENTITIES_IN_SNAPSHOT	256
-
 // snapshots are a view of the server at a given time
 
 // Snapshots are generated at regular time intervals by the server,
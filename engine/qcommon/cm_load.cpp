@@ -36,12 +36,14 @@ clipMap_t cm;
 int c_traces, c_brush_traces, c_patch_traces, c_pointcontents;
 
 const byte* cmod_base;
+static unsigned cmod_checksum;
 
 
 #ifndef BSPC
 cvar_t* cm_noAreas;
 cvar_t* cm_noCurves;
 cvar_t* cm_playerCurveClip;
+static cvar_t* cm_patchCache;
 #endif
 
 
@@ -49,13 +51,11 @@ cvar_t* cm_playerCurveClip;
 // can just be stored out and get a proper clipping hull structure.
 
 static cmodel_t box_model;
-static cplane_t* box_planes;
+static cplane_t box_planes[BOX_PLANES];	// not part of cm.planes, which may be read-only
 static cbrush_t* box_brush;
 
 static void CM_InitBoxHull()
 {
-	box_planes = &cm.planes[cm.numPlanes];
-
 	box_brush = &cm.brushes[cm.numBrushes];
 	box_brush->numsides = 6;
 	box_brush->sides = cm.brushsides + cm.numBrushSides;
@@ -71,7 +71,7 @@ static void CM_InitBoxHull()
 		int side = (i & 1);
 
 		cbrushside_t* s = &cm.brushsides[cm.numBrushSides+i];
-		s->plane = cm.planes + (cm.numPlanes+i*2+side);
+		s->plane = box_planes + (i*2+side);
 		s->surfaceFlags = 0;
 
 		p = &box_planes[i*2];
@@ -100,6 +100,25 @@ static void CM_InitBoxHull()
 */
 
 
+// immutable lumps without pointers are built straight into memory shared with
+// the other server processes when com_sharedMapData is on, on the hunk otherwise
+
+static void* CMod_LoadSharedLump( const char* lumpName, int size, void (*build)( void* data, void* context ), const lump_t* l )
+{
+	void* data;
+#ifndef BSPC
+	data = (void*)Com_SharedData( va( "cm-%08x-%s", cmod_checksum, lumpName ), size, build, (void*)l );
+	if ( data )
+		return data;
+#endif
+	data = Hunk_Alloc( size, h_high );
+	build( data, (void*)l );
+
+	return data;
+}
+
+
+
 static void CMod_LoadShaders( const lump_t* l )
 {
 	const dshader_t* in = (const dshader_t*)(cmod_base + l->fileofs);
@@ -233,19 +252,12 @@ static void CMod_LoadBrushes( const lump_t* l )
 }
 
 
-static void CMod_LoadLeafs( const lump_t* l )
+static void CMod_BuildLeafs( void* data, void* context )
 {
+	const lump_t* l = (const lump_t*)context;
 	const dleaf_t* in = (const dleaf_t*)(cmod_base + l->fileofs);
-	if (l->filelen % sizeof(*in))
-		Com_Error(ERR_DROP, "CMod_LoadLeafs: funny lump size");
-
-	cm.numLeafs = l->filelen / sizeof(*in);
-	if (cm.numLeafs < 1)
-		Com_Error(ERR_DROP, "Map has no leafs");
 
-	cm.leafs = H_New<cLeaf_t>( BOX_LEAFS + cm.numLeafs, h_high );
-
-	cLeaf_t* out = cm.leafs;
+	cLeaf_t* out = (cLeaf_t*)data;
 	for (int i = 0; i < cm.numLeafs; ++i, ++in, ++out)
 	{
 		out->cluster = LittleLong( in->cluster );
@@ -254,11 +266,30 @@ static void CMod_LoadLeafs( const lump_t* l )
 		out->numLeafBrushes = LittleLong( in->numLeafBrushes );
 		out->firstLeafSurface = LittleLong( in->firstLeafSurface );
 		out->numLeafSurfaces = LittleLong( in->numLeafSurfaces );
+	}
+}
 
-		if (out->cluster >= cm.numClusters)
-			cm.numClusters = out->cluster + 1;
-		if (out->area >= cm.numAreas)
-			cm.numAreas = out->area + 1;
+
+static void CMod_LoadLeafs( const lump_t* l )
+{
+	const dleaf_t* in = (const dleaf_t*)(cmod_base + l->fileofs);
+	if (l->filelen % sizeof(*in))
+		Com_Error(ERR_DROP, "CMod_LoadLeafs: funny lump size");
+
+	cm.numLeafs = l->filelen / sizeof(*in);
+	if (cm.numLeafs < 1)
+		Com_Error(ERR_DROP, "Map has no leafs");
+
+	cm.leafs = (cLeaf_t*)CMod_LoadSharedLump( "leafs", (BOX_LEAFS + cm.numLeafs) * sizeof(cLeaf_t), CMod_BuildLeafs, l );
+
+	for (int i = 0; i < cm.numLeafs; ++i, ++in)
+	{
+		const int cluster = LittleLong( in->cluster );
+		const int area = LittleLong( in->area );
+		if (cluster >= cm.numClusters)
+			cm.numClusters = cluster + 1;
+		if (area >= cm.numAreas)
+			cm.numAreas = area + 1;
 	}
 
 	cm.areas = H_New<cArea_t>( cm.numAreas, h_high );
@@ -266,19 +297,12 @@ static void CMod_LoadLeafs( const lump_t* l )
 }
 
 
-static void CMod_LoadPlanes( const lump_t* l )
+static void CMod_BuildPlanes( void* data, void* context )
 {
+	const lump_t* l = (const lump_t*)context;
 	const dplane_t* in = (const dplane_t*)(cmod_base + l->fileofs);
-	if (l->filelen % sizeof(*in))
-		Com_Error(ERR_DROP, "CMod_LoadPlanes: funny lump size");
 
-	cm.numPlanes = l->filelen / sizeof(*in);
-	if (cm.numPlanes < 1)
-		Com_Error(ERR_DROP, "Map has no planes");
-
-	cm.planes = H_New<cplane_t>( BOX_PLANES + cm.numPlanes, h_high );
-
-	cplane_t* out = cm.planes;
+	cplane_t* out = (cplane_t*)data;
 	for (int i = 0; i < cm.numPlanes; ++i, ++in, ++out)
 	{
 		out->signbits = 0;
@@ -294,6 +318,20 @@ static void CMod_LoadPlanes( const lump_t* l )
 }
 
 
+static void CMod_LoadPlanes( const lump_t* l )
+{
+	const dplane_t* in = (const dplane_t*)(cmod_base + l->fileofs);
+	if (l->filelen % sizeof(*in))
+		Com_Error(ERR_DROP, "CMod_LoadPlanes: funny lump size");
+
+	cm.numPlanes = l->filelen / sizeof(*in);
+	if (cm.numPlanes < 1)
+		Com_Error(ERR_DROP, "Map has no planes");
+
+	cm.planes = (cplane_t*)CMod_LoadSharedLump( "planes", cm.numPlanes * sizeof(cplane_t), CMod_BuildPlanes, l );
+}
+
+
 static void CMod_LoadLeafBrushes( const lump_t* l )
 {
 	const int* in = (const int*)(cmod_base + l->fileofs);
@@ -360,10 +398,18 @@ static void CMod_LoadEntityString( const lump_t* l )
 }
 
 
-static void CMod_LoadVisibility( const lump_t* l )
+#define VIS_HEADER	8
+
+
+static void CMod_BuildVisibility( void* data, void* context )
 {
-	const int VIS_HEADER = 8;
+	const lump_t* l = (const lump_t*)context;
+	Com_Memcpy( data, cmod_base + l->fileofs + VIS_HEADER, l->filelen - VIS_HEADER );
+}
 
+
+static void CMod_LoadVisibility( const lump_t* l )
+{
 	if ( !l->filelen ) {
 		cm.clusterBytes = ( cm.numClusters + 31 ) & ~31;
 		cm.visibility = H_New<byte>( cm.clusterBytes, h_high );
@@ -374,12 +420,153 @@ static void CMod_LoadVisibility( const lump_t* l )
 	const byte* buf = (const byte*)(cmod_base + l->fileofs);
 
 	cm.vised = qtrue;
-	cm.visibility = H_New<byte>( l->filelen, h_high );
 	cm.numClusters = LittleLong( ((const int*)buf)[0] );
 	cm.clusterBytes = LittleLong( ((const int*)buf)[1] );
-	Com_Memcpy( cm.visibility, buf + VIS_HEADER, l->filelen - VIS_HEADER );
+	cm.visibility = (byte*)CMod_LoadSharedLump( "vis", l->filelen - VIS_HEADER, CMod_BuildVisibility, l );
+}
+
+
+#ifndef BSPC
+
+// the patch collision cache stores the output of CM_GeneratePatchCollide
+// for every patch of a map, keyed by the BSP checksum
+
+#define PATCH_CACHE_IDENT	(('L'<<24)+('O'<<16)+('C'<<8)+'P')
+#define PATCH_CACHE_VERSION	1
+
+typedef struct {
+	int ident;
+	int version;
+	int layout;			// CM_PatchCollideVersion
+	unsigned checksum;	// of the BSP file
+	int numSurfaces;
+} patchCacheHeader_t;
+
+typedef struct {
+	int surfaceNum;
+	int width;
+	int height;
+} patchCacheEntry_t;
+
+typedef struct {
+	byte* buffer;
+	const byte* data;
+	const byte* end;
+} patchCache_t;
+
+
+static const char* CMod_PatchCachePath()
+{
+	return va( "cache/patches/%08x.pcol", cmod_checksum );
+}
+
+
+static void CMod_OpenPatchCache( patchCache_t* cache )
+{
+	Com_Memset( cache, 0, sizeof(*cache) );
+
+	fileHandle_t f;
+	const int length = FS_SV_FOpenFileRead( CMod_PatchCachePath(), &f );
+	if ( !f )
+		return;
+
+	if ( length < (int)sizeof(patchCacheHeader_t) ) {
+		FS_FCloseFile( f );
+		return;
+	}
+
+	cache->buffer = (byte*)Hunk_AllocateTempMemory( length );
+	if ( FS_Read( cache->buffer, length, f ) != length ) {
+		FS_FCloseFile( f );
+		Hunk_FreeTempMemory( cache->buffer );
+		cache->buffer = NULL;
+		return;
+	}
+	FS_FCloseFile( f );
+
+	patchCacheHeader_t header;
+	Com_Memcpy( &header, cache->buffer, sizeof(header) );
+	if ( header.ident != PATCH_CACHE_IDENT ||
+		 header.version != PATCH_CACHE_VERSION ||
+		 header.layout != CM_PatchCollideVersion() ||
+		 header.checksum != cmod_checksum ||
+		 header.numSurfaces != cm.numSurfaces ) {
+		Com_DPrintf( "Ignoring stale patch cache %s\n", CMod_PatchCachePath() );
+		Hunk_FreeTempMemory( cache->buffer );
+		cache->buffer = NULL;
+		return;
+	}
+
+	cache->data = cache->buffer + sizeof(header);
+	cache->end = cache->buffer + length;
+}
+
+
+static void CMod_ClosePatchCache( patchCache_t* cache )
+{
+	if ( cache->buffer )
+		Hunk_FreeTempMemory( cache->buffer );
+	Com_Memset( cache, 0, sizeof(*cache) );
+}
+
+
+// returns NULL and stops using the cache as soon as it doesn't match the map
+
+static struct patchCollide_s* CMod_ReadCachedPatch( patchCache_t* cache, int surfaceNum, int width, int height )
+{
+	if ( !cache->data )
+		return NULL;
+
+	struct patchCollide_s* pc = NULL;
+	patchCacheEntry_t entry;
+	if ( cache->end - cache->data >= (int)sizeof(entry) ) {
+		Com_Memcpy( &entry, cache->data, sizeof(entry) );
+		cache->data += sizeof(entry);
+		if ( entry.surfaceNum == surfaceNum && entry.width == width && entry.height == height )
+			pc = CM_ReadPatchCollide( &cache->data, cache->end );
+	}
+
+	if ( !pc ) {
+		Com_Printf( "WARNING: %s doesn't match the map, rebuilding it\n", CMod_PatchCachePath() );
+		cache->data = NULL;
+	}
+
+	return pc;
+}
+
+
+static void CMod_WritePatchCache( const int* sizes )
+{
+	const fileHandle_t f = FS_SV_FOpenFileWrite( CMod_PatchCachePath() );
+	if ( !f ) {
+		Com_Printf( "WARNING: couldn't write %s\n", CMod_PatchCachePath() );
+		return;
+	}
+
+	patchCacheHeader_t header;
+	header.ident = PATCH_CACHE_IDENT;
+	header.version = PATCH_CACHE_VERSION;
+	header.layout = CM_PatchCollideVersion();
+	header.checksum = cmod_checksum;
+	header.numSurfaces = cm.numSurfaces;
+	FS_Write( &header, sizeof(header), f );
+
+	for (int i = 0; i < cm.numSurfaces; ++i) {
+		if ( !cm.surfaces[i] )
+			continue;
+		patchCacheEntry_t entry;
+		entry.surfaceNum = i;
+		entry.width = sizes[i * 2 + 0];
+		entry.height = sizes[i * 2 + 1];
+		FS_Write( &entry, sizeof(entry), f );
+		CM_WritePatchCollide( f, cm.surfaces[i]->pc );
+	}
+
+	FS_FCloseFile( f );
 }
 
+#endif
+
 
 static void CMod_LoadPatches( const lump_t* surfs, const lump_t* verts )
 {
@@ -396,6 +583,18 @@ static void CMod_LoadPatches( const lump_t* surfs, const lump_t* verts )
 	if (verts->filelen % sizeof(*dvBase))
 		Com_Error (ERR_DROP, "CMod_LoadPatches: funny lump size");
 
+#ifndef BSPC
+	patchCache_t cache;
+	qbool rebuilt = qfalse;
+	int* sizes = NULL;
+	if ( cm_patchCache->integer ) {
+		CMod_OpenPatchCache( &cache );
+		sizes = (int*)Z_Malloc( cm.numSurfaces * 2 * sizeof(int) );
+	} else {
+		Com_Memset( &cache, 0, sizeof(cache) );
+	}
+#endif
+
 	// scan through all the surfaces, but only load patches, not planar faces
 	for (int i = 0; i < cm.numSurfaces; ++i, ++in)
 	{
@@ -406,13 +605,28 @@ static void CMod_LoadPatches( const lump_t* surfs, const lump_t* verts )
 
 		cm.surfaces[i] = H_New<cPatch_t>( h_high );
 
-		// load the full drawverts onto the stack
 		int w = LittleLong( in->patchWidth );
 		int h = LittleLong( in->patchHeight );
 		int c = w * h;
 		if ( c > MAX_PATCH_VERTS )
 			Com_Error( ERR_DROP, "CMod_LoadPatches: exceeded MAX_PATCH_VERTS" );
 
+		int shaderNum = LittleLong( in->shaderNum );
+		cm.surfaces[i]->contents = cm.shaders[shaderNum].contentFlags;
+		cm.surfaces[i]->surfaceFlags = cm.shaders[shaderNum].surfaceFlags;
+
+#ifndef BSPC
+		if ( sizes ) {
+			sizes[i * 2 + 0] = w;
+			sizes[i * 2 + 1] = h;
+		}
+		cm.surfaces[i]->pc = CMod_ReadCachedPatch( &cache, i, w, h );
+		if ( cm.surfaces[i]->pc )
+			continue;
+		rebuilt = qtrue;
+#endif
+
+		// load the full drawverts onto the stack
 		const drawVert_t* dv = dvBase + LittleLong( in->firstVert );
 		for (int j = 0; j < c; ++j, ++dv)
 		{
@@ -421,12 +635,18 @@ static void CMod_LoadPatches( const lump_t* surfs, const lump_t* verts )
 			points[j][2] = LittleFloat( dv->xyz[2] );
 		}
 
-		int shaderNum = LittleLong( in->shaderNum );
-		cm.surfaces[i]->contents = cm.shaders[shaderNum].contentFlags;
-		cm.surfaces[i]->surfaceFlags = cm.shaders[shaderNum].surfaceFlags;
 		// create the internal facet structure
 		cm.surfaces[i]->pc = CM_GeneratePatchCollide( w, h, points );
 	}
+
+#ifndef BSPC
+	CMod_ClosePatchCache( &cache );
+	if ( sizes ) {
+		if ( rebuilt )
+			CMod_WritePatchCache( sizes );
+		Z_Free( sizes );
+	}
+#endif
 }
 
 
@@ -455,13 +675,16 @@ void CM_LoadMap( const char* name, qbool clientload, unsigned* checksum )
 	CM_ClearMap();
 
 	int length;
-	byte* buf = 0;
+	const byte* buf = 0;
 
 #ifndef BSPC
 	cm_noAreas = Cvar_Get("cm_noAreas", "0", CVAR_CHEAT);
 	cm_noCurves = Cvar_Get("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get("cm_playerCurveClip", "1", CVAR_CHEAT);
-	length = FS_ReadFile( name, (void **)&buf );
+	cm_patchCache = Cvar_Get("cm_patchCache", "1", CVAR_ARCHIVE);
+	Cvar_SetRange("cm_patchCache", CVART_BOOL, NULL, NULL);
+	Cvar_SetHelp("cm_patchCache", "caches the patch collision data of maps in the home path");
+	length = FS_ReadFileRO( name, (const void **)&buf );
 #else
 	length = LoadQuakeFile((quakefile_t *) name, (void **)&buf);
 #endif
@@ -471,8 +694,9 @@ void CM_LoadMap( const char* name, qbool clientload, unsigned* checksum )
 
 	last_checksum = LittleLong( Com_BlockChecksum( buf, length ) );
 	*checksum = last_checksum;
+	cmod_checksum = last_checksum;
 
-	dheader_t header = *(dheader_t*)buf;
+	dheader_t header = *(const dheader_t*)buf;
 	for (int i = 0; i < sizeof(dheader_t) / 4; ++i)
 		((int*)&header)[i] = LittleLong( ((int*)&header)[i] );
 
@@ -497,7 +721,11 @@ void CM_LoadMap( const char* name, qbool clientload, unsigned* checksum )
 	CMod_LoadPatches( &header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS] );
 
 	// we are NOT freeing the file, because it is cached for the ref
-	FS_FreeFile(buf);
+#ifndef BSPC
+	FS_FreeFileRO(buf);
+#else
+	FS_FreeFile((void *)buf);
+#endif
 
 	CM_InitBoxHull();
 
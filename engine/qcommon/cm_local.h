@@ -89,13 +89,13 @@ typedef struct {
 	cbrushside_t *brushsides;
 
 	int			numPlanes;
-	cplane_t	*planes;
+	cplane_t	*planes;		// read-only, can live in shared memory
 
 	int			numNodes;
 	cNode_t		*nodes;
 
 	int			numLeafs;
-	cLeaf_t		*leafs;
+	cLeaf_t		*leafs;			// read-only, can live in shared memory
 
 	int			numLeafBrushes;
 	int			*leafbrushes;
@@ -111,7 +111,7 @@ typedef struct {
 
 	int			numClusters;
 	int			clusterBytes;
-	byte		*visibility;
+	byte		*visibility;	// read-only, can live in shared memory
 	qbool	vised;			// if qfalse, visibility is just a single cluster of ffs
 
 	int			numEntityChars;
@@ -197,3 +197,6 @@ struct patchCollide_s* CM_GeneratePatchCollide( int width, int height, const vec
 void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 qbool CM_PositionTestInPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 void CM_ClearLevelPatches( void );
+void CM_WritePatchCollide( fileHandle_t f, const struct patchCollide_s* pc );
+struct patchCollide_s* CM_ReadPatchCollide( const byte** data, const byte* end );
+int CM_PatchCollideVersion();
@@ -423,6 +423,12 @@ static	facet_t			facets[MAX_PATCH_PLANES]; //maybe MAX_FACETS ??
 #define	NORMAL_EPSILON	0.0001
 #define	DIST_EPSILON	0.02
 
+#define	PLANE_HASH_SIZE		1024	// must be a power of 2
+#define	PLANE_HASH_SCALE	8		// buckets are 1/8 unit wide, must stay > DIST_EPSILON
+
+static	int				planeHashHead[PLANE_HASH_SIZE];
+static	int				planeHashNext[MAX_PATCH_PLANES];
+
 
 static qbool CM_PlaneEqual( const patchPlane_t* p, float plane[4], qbool* flipped )
 {
@@ -474,12 +480,62 @@ static void CM_SnapVector( vec3_t normal )
 }
 
 
+// the planes are hashed by distance, in buckets wider than DIST_EPSILON
+// so that any plane CM_PlaneEqual can match is in a bucket next to the key's
+
+static int CM_PlaneHashKey( float dist )
+{
+	return (int)floor( dist * PLANE_HASH_SCALE );
+}
+
+
+static void CM_ClearPlaneHash()
+{
+	Com_Memset( planeHashHead, -1, sizeof(planeHashHead) );
+}
+
+
+static void CM_HashPlane( int planeNum )
+{
+	const int bucket = CM_PlaneHashKey( planes[planeNum].plane[3] ) & (PLANE_HASH_SIZE - 1);
+	planeHashNext[planeNum] = planeHashHead[bucket];
+	planeHashHead[bucket] = planeNum;
+}
+
+
+// returns the lowest-numbered match so the result is the same as a linear scan
+
+static int CM_FindHashedPlane( float plane[4], qbool* flipped )
+{
+	int best = -1;
+	qbool bestFlipped = qfalse;
+
+	// flipped planes are stored with the opposite distance
+	const int keys[2] = { CM_PlaneHashKey( plane[3] ), CM_PlaneHashKey( -plane[3] ) };
+	for (int k = 0; k < 2; ++k) {
+		for (int key = keys[k] - 1; key <= keys[k] + 1; ++key) {
+			const int bucket = key & (PLANE_HASH_SIZE - 1);
+			for (int i = planeHashHead[bucket]; i != -1; i = planeHashNext[i]) {
+				qbool f;
+				if ((best == -1 || i < best) && CM_PlaneEqual(&planes[i], plane, &f)) {
+					best = i;
+					bestFlipped = f;
+				}
+			}
+		}
+	}
+
+	*flipped = bestFlipped;
+	return best;
+}
+
+
 static int CM_FindPlane2( float plane[4], qbool* flipped )
 {
 	// see if the points are close enough to an existing plane
-	for (int i = 0; i < numPlanes; ++i) {
-		if (CM_PlaneEqual(&planes[i], plane, flipped)) return i;
-	}
+	const int i = CM_FindHashedPlane( plane, flipped );
+	if (i != -1)
+		return i;
 
 	// add a new plane
 	if ( numPlanes == MAX_PATCH_PLANES ) {
@@ -488,6 +544,7 @@ static int CM_FindPlane2( float plane[4], qbool* flipped )
 
 	Vector4Copy( plane, planes[numPlanes].plane );
 	planes[numPlanes].signbits = CM_SignbitsForNormal( plane );
+	CM_HashPlane( numPlanes );
 
 	*flipped = qfalse;
 
@@ -540,6 +597,7 @@ static int CM_FindPlane( float *p1, float *p2, float *p3 ) {
 
 	Vector4Copy( plane, planes[numPlanes].plane );
 	planes[numPlanes].signbits = CM_SignbitsForNormal( plane );
+	CM_HashPlane( numPlanes );
 
 	numPlanes++;
 
@@ -969,6 +1027,7 @@ static void CM_PatchCollideFromGrid( cGrid_t *grid, patchCollide_t *pf ) {
 
 	numPlanes = 0;
 	numFacets = 0;
+	CM_ClearPlaneHash();
 
 	// find the planes for each triangle of the grid
 	for ( i = 0 ; i < grid->width - 1 ; i++ ) {
@@ -1195,6 +1254,96 @@ struct patchCollide_s* CM_GeneratePatchCollide( int width, int height, const vec
 	return pf;
 }
 
+/*
+===================
+CM_WritePatchCollide
+
+Appends the patch collide to a cache file as raw structures,
+the cache header is responsible for rejecting files from another build.
+===================
+*/
+void CM_WritePatchCollide( fileHandle_t f, const struct patchCollide_s* pc )
+{
+	FS_Write( pc->bounds, sizeof( pc->bounds ), f );
+	FS_Write( &pc->numPlanes, sizeof( pc->numPlanes ), f );
+	FS_Write( &pc->numFacets, sizeof( pc->numFacets ), f );
+	FS_Write( pc->planes, pc->numPlanes * sizeof( *pc->planes ), f );
+	FS_Write( pc->facets, pc->numFacets * sizeof( *pc->facets ), f );
+}
+
+
+/*
+===================
+CM_ReadPatchCollide
+
+Rebuilds a patch collide written by CM_WritePatchCollide.
+Returns NULL if the data is truncated or inconsistent.
+===================
+*/
+struct patchCollide_s* CM_ReadPatchCollide( const byte** data, const byte* end )
+{
+	const byte* p = *data;
+	const int headerSize = sizeof( vec3_t[2] ) + 2 * sizeof( int );
+	if ( end - p < headerSize )
+		return NULL;
+
+	vec3_t bounds[2];
+	int numPlanes, numFacets;
+	Com_Memcpy( bounds, p, sizeof( bounds ) );
+	Com_Memcpy( &numPlanes, p + sizeof( bounds ), sizeof( int ) );
+	Com_Memcpy( &numFacets, p + sizeof( bounds ) + sizeof( int ), sizeof( int ) );
+	p += headerSize;
+
+	if ( numPlanes < 0 || numPlanes > MAX_PATCH_PLANES || numFacets < 0 || numFacets > MAX_PATCH_PLANES )
+		return NULL;
+
+	const int planesSize = numPlanes * sizeof( patchPlane_t );
+	const int facetsSize = numFacets * sizeof( facet_t );
+	if ( end - p < planesSize + facetsSize )
+		return NULL;
+
+	// every plane reference must be in range, a bad one would crash traces
+	const facet_t* facet = (const facet_t*)( p + planesSize );
+	for ( int i = 0; i < numFacets; ++i, ++facet ) {
+		if ( facet->surfacePlane < 0 || facet->surfacePlane >= numPlanes )
+			return NULL;
+		if ( facet->numBorders < 0 || facet->numBorders > (int)ARRAY_LEN( facet->borderPlanes ) )
+			return NULL;
+		for ( int j = 0; j < facet->numBorders; ++j ) {
+			if ( facet->borderPlanes[j] < -1 || facet->borderPlanes[j] >= numPlanes )
+				return NULL;
+		}
+	}
+
+	patchCollide_t* pf = (patchCollide_t*)Hunk_Alloc( sizeof( *pf ), h_high );
+	Com_Memcpy( pf->bounds, bounds, sizeof( bounds ) );
+	pf->numPlanes = numPlanes;
+	pf->numFacets = numFacets;
+	pf->planes = (patchPlane_t*)Hunk_Alloc( planesSize, h_high );
+	Com_Memcpy( pf->planes, p, planesSize );
+	p += planesSize;
+	pf->facets = (facet_t*)Hunk_Alloc( facetsSize, h_high );
+	Com_Memcpy( pf->facets, p, facetsSize );
+	p += facetsSize;
+
+	*data = p;
+
+	return pf;
+}
+
+
+/*
+===================
+CM_PatchCollideVersion
+
+Changes whenever the cached structures change layout.
+===================
+*/
+int CM_PatchCollideVersion()
+{
+	return ( sizeof( patchPlane_t ) << 16 ) | sizeof( facet_t );
+}
+
 /*
 ================================================================================
 
@@ -68,6 +68,7 @@ static jmp_buf abortframe;		// an ERR_DROP occured, exit the entire frame
 static fileHandle_t	logfile = 0;
 static fileHandle_t	com_journalFile = 0;		// events are written here
 fileHandle_t		com_journalDataFile = 0;		// config files are written here
+static fileHandle_t	com_journalPacketFile = 0;	// outgoing packet checksums are written here
 
 cvar_t	*com_viewlog = 0;
 cvar_t	*com_speeds = 0;
@@ -92,9 +93,11 @@ cvar_t	*com_noErrorInterrupt;
 #endif
 
 static cvar_t	*con_completionStyle;	// 0 = legacy, 1 = ET-style
+static cvar_t	*com_sharedMapData;
 static cvar_t	*con_history;
 
 int		time_game; // for com_speeds
+int64_t	time_gameUS; // for journal benchmarks
 
 int		com_frameTime;
 int		com_frameNumber;
@@ -112,6 +115,7 @@ const char* const com_gitCommit = GIT_COMMIT;
 
 static void Com_WriteConfigToFile( const char* filename, qbool forceWrite );
 static void Com_WriteConfig_f();
+static void Com_ClearSharedMapData_f();
 static void Com_CompleteWriteConfig_f( int startArg, int compArg );
 static const char* Com_GetCompilerInfo();
 extern void CIN_CloseAllVideos( void );
@@ -704,6 +708,15 @@ all big things are allocated on the hunk.
 #define	ZONEID	0x1d4a11
 #define MINFRAGMENT	64
 
+// freed blocks up to ZONE_CLASS_MAX bytes (header included) are kept on per-size lists
+// and handed out again in O(1) without being merged back into the block list,
+// they go back to the zone when it can't satisfy an allocation
+#define ZONE_CLASS_SIZE		16
+#define ZONE_CLASSES		32
+#define ZONE_CLASS_MAX		(ZONE_CLASS_SIZE * ZONE_CLASSES)
+#define ZONE_CACHE_FRACTION	8			// at most 1/8th of a zone sits in the lists
+#define ZONE_TAG_CACHED		-1			// not free as far as the block list is concerned
+
 typedef struct zonedebug_s {
 	char *label;
 	char *file;
@@ -726,6 +739,12 @@ typedef struct {
 	int		used;			// total bytes used
 	memblock_t	blocklist;	// start / end cap for linked list
 	memblock_t	*rover;
+	memblock_t	*classes[ZONE_CLASSES];	// cached blocks, linked through their first bytes
+	int		cachedBytes;
+	int		cachedBlocks;
+	int		classHits;		// allocations served from the lists
+	int		classMisses;	// small allocations that had to scan
+	int		flushes;		// times the lists were emptied to find room
 } memzone_t;
 
 // main zone for all "dynamic" memory allocation
@@ -749,6 +768,14 @@ static void Z_ClearZone( memzone_t* zone, int size )
 	zone->rover = block;
 	zone->size = size;
 	zone->used = 0;
+	for (int i = 0; i < ZONE_CLASSES; ++i) {
+		zone->classes[i] = NULL;
+	}
+	zone->cachedBytes = 0;
+	zone->cachedBlocks = 0;
+	zone->classHits = 0;
+	zone->classMisses = 0;
+	zone->flushes = 0;
 
 	block->prev = block->next = &zone->blocklist;
 	block->tag = 0;			// free block
@@ -769,6 +796,81 @@ int Z_AvailableMemory( void )
 }
 
 
+static memblock_t** Z_BlockLink( memblock_t* block )
+{
+	return (memblock_t**)((byte*)block + sizeof(memblock_t));
+}
+
+
+// marks the block as free and merges it with its free neighbors
+static void Z_ReleaseBlock( memzone_t* zone, memblock_t* block )
+{
+	block->tag = 0;		// mark as free
+
+	memblock_t* other = block->prev;
+	if (!other->tag) {
+		// merge with previous free block
+		other->size += block->size;
+		other->next = block->next;
+		other->next->prev = other;
+		if (block == zone->rover) {
+			zone->rover = other;
+		}
+		block = other;
+	}
+
+	zone->rover = block;
+
+	other = block->next;
+	if ( !other->tag ) {
+		// merge the next free block onto the end
+		block->size += other->size;
+		block->next = other->next;
+		block->next->prev = block;
+		if (other == zone->rover) {
+			zone->rover = block;
+		}
+	}
+}
+
+
+static qbool Z_CacheBlock( memzone_t* zone, memblock_t* block )
+{
+	const int index = block->size / ZONE_CLASS_SIZE - 1;
+	if ( index < 0 || index >= ZONE_CLASSES ||
+		 zone->cachedBytes + block->size > zone->size / ZONE_CACHE_FRACTION ) {
+		return qfalse;
+	}
+
+	block->tag = ZONE_TAG_CACHED;
+	*Z_BlockLink( block ) = zone->classes[index];
+	zone->classes[index] = block;
+	zone->cachedBytes += block->size;
+	zone->cachedBlocks++;
+
+	return qtrue;
+}
+
+
+// gives every cached block back to the zone so that it can be merged
+static void Z_FlushCache( memzone_t* zone )
+{
+	for (int i = 0; i < ZONE_CLASSES; ++i) {
+		memblock_t* block = zone->classes[i];
+		while (block) {
+			memblock_t* const next = *Z_BlockLink( block );
+			Z_ReleaseBlock( zone, block );
+			block = next;
+		}
+		zone->classes[i] = NULL;
+	}
+
+	zone->cachedBytes = 0;
+	zone->cachedBlocks = 0;
+	zone->flushes++;
+}
+
+
 void Z_Free( void* ptr )
 {
 	if (!ptr) {
@@ -779,7 +881,7 @@ void Z_Free( void* ptr )
 	if (block->id != ZONEID) {
 		Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
 	}
-	if (block->tag == 0) {
+	if (block->tag == 0 || block->tag == ZONE_TAG_CACHED) {
 		Com_Error( ERR_FATAL, "Z_Free: freed a freed pointer" );
 	}
 	// if static memory
@@ -798,32 +900,11 @@ void Z_Free( void* ptr )
 	// if it is referenced...
 	Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
 
-	block->tag = 0;		// mark as free
-
-	memblock_t* other = block->prev;
-	if (!other->tag) {
-		// merge with previous free block
-		other->size += block->size;
-		other->next = block->next;
-		other->next->prev = other;
-		if (block == zone->rover) {
-			zone->rover = other;
-		}
-		block = other;
+	if ( Z_CacheBlock( zone, block ) ) {
+		return;
 	}
 
-	zone->rover = block;
-
-	other = block->next;
-	if ( !other->tag ) {
-		// merge the next free block onto the end
-		block->size += other->size;
-		block->next = other->next;
-		block->next->prev = block;
-		if (other == zone->rover) {
-			zone->rover = block;
-		}
-	}
+	Z_ReleaseBlock( zone, block );
 }
 
 
@@ -843,7 +924,7 @@ static void Z_LogZoneHeap( const memzone_t* zone, const char* name )
 	Com_sprintf(buf, sizeof(buf), "\r\n================\r\n%s log\r\n================\r\n", name);
 	FS_Write(buf, strlen(buf), logfile);
 	for (block = zone->blocklist.next ; block->next != &zone->blocklist; block = block->next) {
-		if (block->tag) {
+		if (block->tag && block->tag != ZONE_TAG_CACHED) {
 			ptr = ((char *) block) + sizeof(memblock_t);
 			j = 0;
 			for (i = 0; i < 20 && i < block->d.allocSize; i++) {
@@ -909,19 +990,43 @@ void *Z_TagMalloc( int size, int tag ) {
 	}
 
 	allocSize = size;
-	//
-	// scan through the block list looking for the first free block
-	// of sufficient size
-	//
 	size += sizeof(memblock_t);	// account for size of block header
 	size += 4;					// space for memory trash tester
 	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
 
+	if ( size <= ZONE_CLASS_MAX ) {
+		// round up to the class size so the block can be reused by any request of its class,
+		// a cached block also needs room for the list link and the trash tester
+		size = max( size, (int)(sizeof(memblock_t) + sizeof(memblock_t*) + 4) );
+		size = PAD( size, ZONE_CLASS_SIZE );
+		memblock_t** const head = &zone->classes[size / ZONE_CLASS_SIZE - 1];
+		if ( *head ) {
+			base = *head;
+			*head = *Z_BlockLink( base );
+			zone->cachedBytes -= base->size;
+			zone->cachedBlocks--;
+			zone->classHits++;
+			goto found;
+		}
+		zone->classMisses++;
+	}
+
+	//
+	// scan through the block list looking for the first free block
+	// of sufficient size
+	//
 	base = rover = zone->rover;
 	start = base->prev;
 
 	do {
 		if (rover == start) {
+			if ( zone->cachedBlocks > 0 ) {
+				// merge the cached blocks back in and try again
+				Z_FlushCache( zone );
+				base = rover = zone->rover;
+				start = base->prev;
+				continue;
+			}
 #ifdef ZONE_DEBUG
 			Z_LogHeap();
 #endif
@@ -954,9 +1059,10 @@ void *Z_TagMalloc( int size, int tag ) {
 		base->size = size;
 	}
 
-	base->tag = tag;			// no longer a free block
-
 	zone->rover = base->next;	// next allocation will start looking here
+
+found:
+	base->tag = tag;			// no longer a free block
 	zone->used += base->size;	//
 
 	base->id = ZONEID;
@@ -1127,6 +1233,10 @@ static	int		s_hunkTotal = 0;
 
 static	int		s_zoneTotal = 0;
 
+static	const char*	s_hunkPages = "regular pages";
+static	const char*	s_zonePages = "regular pages";
+static	cvar_t*		com_hugePages;
+
 #ifdef HUNK_DEBUG
 
 typedef struct hunkblock_s {
@@ -1143,6 +1253,43 @@ static hunkblock_t* hunkblocks = NULL;
 #endif
 
 
+static void Z_PrintZoneStats( const memzone_t* zone, const char* name )
+{
+	int freeBytes = 0;
+	int freeBlocks = 0;
+	int largestFree = 0;
+	int usedBlocks = 0;
+
+	for (const memblock_t* block = zone->blocklist.next ; ; block = block->next) {
+		if ( !block->tag ) {
+			freeBytes += block->size;
+			freeBlocks++;
+			largestFree = max( largestFree, block->size );
+		} else if ( block->tag != ZONE_TAG_CACHED ) {
+			usedBlocks++;
+		}
+
+		if (block->next == &zone->blocklist) {
+			break;			// all blocks have been hit
+		}
+	}
+
+	// how much of the free memory can't be handed out as a single block
+	const int fragmentation = freeBytes > 0 ? (int)( 100.0f * (1.0f - (float)largestFree / (float)freeBytes) ) : 0;
+	const int smallAllocs = zone->classHits + zone->classMisses;
+
+	Com_Printf( "%s zone:\n", name );
+	Com_Printf( "   %8i bytes in %i used blocks\n", zone->used, usedBlocks );
+	Com_Printf( "   %8i bytes in %i free blocks\n", freeBytes, freeBlocks );
+	Com_Printf( "   %8i bytes in the largest free block\n", largestFree );
+	Com_Printf( "   %8i%% fragmentation\n", fragmentation );
+	Com_Printf( "   %8i bytes in %i cached blocks\n", zone->cachedBytes, zone->cachedBlocks );
+	Com_Printf( "   %8i%% of %i small allocations served from the size classes\n",
+		smallAllocs > 0 ? (int)( 100.0f * (float)zone->classHits / (float)smallAllocs ) : 0, smallAllocs );
+	Com_Printf( "   %8i cache flushes\n", zone->flushes );
+}
+
+
 static void Com_Meminfo_f( void )
 {
 	const memblock_t* block;
@@ -1156,7 +1303,7 @@ static void Com_Meminfo_f( void )
 			Com_Printf ("block:%p    size:%7i    tag:%3i\n",
 				block, block->size, block->tag);
 		}
-		if ( block->tag ) {
+		if ( block->tag && block->tag != ZONE_TAG_CACHED ) {
 			zoneBytes += block->size;
 			zoneBlocks++;
 			if ( block->tag == TAG_BOTLIB ) {
@@ -1183,7 +1330,7 @@ static void Com_Meminfo_f( void )
 	int smallZoneBytes = 0;
 	int smallZoneBlocks = 0;
 	for (block = smallzone->blocklist.next ; ; block = block->next) {
-		if ( block->tag ) {
+		if ( block->tag && block->tag != ZONE_TAG_CACHED ) {
 			smallZoneBytes += block->size;
 			smallZoneBlocks++;
 		}
@@ -1195,6 +1342,7 @@ static void Com_Meminfo_f( void )
 
 	Com_Printf( "%8i bytes total hunk\n", s_hunkTotal );
 	Com_Printf( "%8i bytes total zone\n", s_zoneTotal );
+	Com_Printf( "hunk in %s, zone in %s\n", s_hunkPages, s_zonePages );
 	Com_Printf( "\n" );
 	Com_Printf( "%8i low mark\n", hunk_low.mark );
 	Com_Printf( "%8i low permanent\n", hunk_low.permanent );
@@ -1227,6 +1375,9 @@ static void Com_Meminfo_f( void )
 	Com_Printf( "   %8i bytes in dynamic renderer\n", rendererBytes );
 	Com_Printf( "   %8i bytes in dynamic other\n", zoneBytes - ( botlibBytes + rendererBytes ) );
 	Com_Printf( "   %8i bytes in small Zone memory\n", smallZoneBytes );
+	Com_Printf( "\n" );
+	Z_PrintZoneStats( mainzone, "main" );
+	Z_PrintZoneStats( smallzone, "small" );
 }
 
 
@@ -1293,7 +1444,16 @@ static void Com_InitZoneMemory()
 	// allocate the random block zone
 	s_zoneTotal = 1024 * 1024 * CST_COMZONEMEGS;
 
-	mainzone = (memzone_t*)calloc( s_zoneTotal, 1 );
+	// the config files haven't been executed yet, so this can only come from the command line
+	Com_StartupVariable( "com_hugePages" );
+	com_hugePages = Cvar_Get( "com_hugePages", "0", CVAR_INIT );
+	Cvar_SetRange( "com_hugePages", CVART_INTEGER, "0", "2" );
+	Cvar_SetHelp( "com_hugePages", "backs the hunk and the zone with huge pages\n"
+		"0 - regular allocation\n"
+		"1 - pre-faulted transparent huge pages\n"
+		"2 - pre-faulted MAP_HUGETLB pages, falls back to 1" );
+
+	mainzone = (memzone_t*)Sys_AllocLargeMemory( s_zoneTotal, com_hugePages->integer, &s_zonePages );
 	if ( !mainzone )
 		Com_Error( ERR_FATAL, "Zone data failed to allocate %i megs", s_zoneTotal / (1024*1024) );
 
@@ -1427,7 +1587,7 @@ static void Com_InitHunkMemory()
 	s_hunkData = (byte*)VirtualAlloc( NULL, ( s_hunkTotal + 4095 ) & ( ~4095 ), MEM_COMMIT | MEM_TOP_DOWN, PAGE_READWRITE );
 	Cvar_Get( "sys_hunkBaseAddress", va( "%p", s_hunkData ), CVAR_ROM );
 #else
-	s_hunkData = (byte*)calloc( s_hunkTotal + 63, 1 );
+	s_hunkData = (byte*)Sys_AllocLargeMemory( s_hunkTotal + 63, com_hugePages->integer, &s_hunkPages );
 #endif
 	if ( !s_hunkData ) {
 		Com_Error( ERR_FATAL, "Hunk data failed to allocate %i megs", s_hunkTotal / (1024*1024) );
@@ -1436,6 +1596,9 @@ static void Com_InitHunkMemory()
 	s_hunkData = (byte *) ( ( (intptr_t)s_hunkData + 63 ) & ( ~63 ) );
 	Hunk_Clear();
 
+	Com_Printf( "Hunk: %i megs in %s\n", s_hunkTotal / (1024*1024), s_hunkPages );
+	Com_Printf( "Zone: %i megs in %s\n", s_zoneTotal / (1024*1024), s_zonePages );
+
 	Cmd_RegisterArray( hunk_cmds, MODULE_COMMON );
 }
 
@@ -1477,6 +1640,131 @@ qbool Hunk_CheckMark()
 
 // the server calls this before shutting down or loading a new map
 
+/*
+==============================================================================
+
+SHARED DATA
+
+Immutable per-map data (clip map planes and PVS, AAS geometry) can be placed in
+named shared memory so that every server process of the host running the same
+map maps the same pages instead of building its own copy.
+Names are derived from content checksums, so a changed map gets new segments.
+Segments are private to the user running the servers and outlive them:
+the old ones of changed maps stay until "clearsharedmapdata" runs or the host
+reboots. Clearing is safe while servers run, they keep the views they have.
+
+==============================================================================
+*/
+
+
+#define SHARED_DATA_MAGIC	0x53444154	// "SDAT"
+#define SHARED_DATA_VERSION	1			// bump when the layout of any shared structure changes
+#define MAX_SHARED_VIEWS	64
+#define SHARED_DATA_ORPHAN_SEC	60	// an ownerless segment this old was left by a builder that died right away
+
+typedef struct {
+	int				magic;
+	int				size;
+	volatile int	ready;
+	int				owner;		// process ID of the builder, also keeps the data 16-byte aligned
+} sharedDataHeader_t;
+
+typedef struct {
+	char		name[64];
+	const void*	view;
+	int			viewSize;
+} sharedDataView_t;
+
+static sharedDataView_t	com_sharedViews[MAX_SHARED_VIEWS];
+static int				com_numSharedViews;
+
+
+const void* Com_SharedData( const char* name, int size, void (*build)( void* data, void* context ), void* context )
+{
+	if ( !com_sharedMapData || !com_sharedMapData->integer || size <= 0 )
+		return NULL;
+
+	const int viewSize = sizeof(sharedDataHeader_t) + size;
+	for ( int i = 0; i < com_numSharedViews; ++i ) {
+		const sharedDataView_t* const v = &com_sharedViews[i];
+		if ( v->viewSize == viewSize && !strcmp( v->name, name ) )
+			return (const byte*)v->view + sizeof(sharedDataHeader_t);
+	}
+
+	if ( com_numSharedViews >= MAX_SHARED_VIEWS )
+		return NULL;
+
+	char fullName[MAX_QPATH];
+	Com_sprintf( fullName, sizeof(fullName), "/cnq3-%d-%d-%s", SHARED_DATA_VERSION, (int)sizeof(void*) * 8, name );
+
+	const void* view;
+	sharedDataHeader_t* const header = (sharedDataHeader_t*)Sys_CreateSharedMemory( fullName, viewSize );
+	if ( header != NULL ) {
+		// we're first, readers ignore the segment until it's marked ready
+		header->owner = Sys_GetProcessID();
+		build( header + 1, context );
+		header->magic = SHARED_DATA_MAGIC;
+		header->size = size;
+		// everything else must be visible before the flag is
+		Sys_MemoryBarrier();
+		header->ready = 1;
+		Sys_SealSharedMemory( header, viewSize );
+		view = header;
+	} else {
+		view = Sys_OpenSharedMemory( fullName, viewSize );
+		if ( view == NULL )
+			return NULL;
+
+		const sharedDataHeader_t* const h = (const sharedDataHeader_t*)view;
+		const qbool ready = h->ready != 0;
+		Sys_MemoryBarrier();
+		if ( !ready ) {
+			// still being built: use a private copy this time
+			// left over by a builder that died: unlink it so that the next process creates a fresh one
+			// an owner of 0 means the builder hasn't written its ID yet, or never will
+			const int owner = h->owner;
+			Sys_CloseSharedMemory( view, viewSize );
+			const qbool orphaned = owner != 0 ?
+				!Sys_IsProcessAlive( owner ) :
+				Sys_SharedMemoryAge( fullName ) > SHARED_DATA_ORPHAN_SEC;
+			if ( orphaned )
+				Sys_RemoveSharedMemory( fullName );
+			return NULL;
+		}
+
+		if ( h->magic != SHARED_DATA_MAGIC || h->size != size ) {
+			Sys_CloseSharedMemory( view, viewSize );
+			return NULL;
+		}
+	}
+
+	sharedDataView_t* const v = &com_sharedViews[com_numSharedViews++];
+	Q_strncpyz( v->name, name, sizeof(v->name) );
+	v->view = view;
+	v->viewSize = viewSize;
+
+	return (const byte*)view + sizeof(sharedDataHeader_t);
+}
+
+
+// the segments themselves stay around for the other processes
+static void Com_ReleaseSharedData()
+{
+	for ( int i = 0; i < com_numSharedViews; ++i ) {
+		Sys_CloseSharedMemory( com_sharedViews[i].view, com_sharedViews[i].viewSize );
+	}
+	com_numSharedViews = 0;
+}
+
+
+// unlinks all of the user's segments, including those of other versions
+static void Com_ClearSharedMapData_f()
+{
+	const int count = Sys_RemoveAllSharedMemory( "/cnq3-" );
+	Com_Printf( "Removed %d shared data segment%s\n", count, count == 1 ? "" : "s" );
+}
+
+
 void Hunk_Clear()
 {
 #ifndef DEDICATED
@@ -1505,6 +1793,9 @@ void Hunk_Clear()
 
 	VM_Clear();
 
+	// everything pointing into the shared views was just released
+	Com_ReleaseSharedData();
+
 #ifdef HUNK_DEBUG
 	hunkblocks = NULL;
 #endif
@@ -1708,11 +1999,48 @@ static sysEvent_t com_pushedEvents[MAX_PUSHED_EVENTS];
 static int com_pushedEventsHead;
 static int com_pushedEventsTail;
 
+/*
+With "journalbench 1", a "journal 2" replay becomes a throughput benchmark:
+the frames run back to back on the journaled time, nothing is sent,
+the server's outgoing packets are checked against the checksums
+in journalpackets.dat and a report is printed when the journal runs out.
+
+The SE_NONE event that ends the events of a frame is tagged when recording,
+so the replay can merge the event loops run while sleeping into the frame's.
+*/
+
+#define JOURNAL_FRAME_END	1	// SE_NONE evValue
+
+struct journalPacket_t {
+	int				frame;
+	int				length;
+	unsigned int	crc32;
+};
+
+struct journalBenchmark_t {
+	int64_t	startUS;
+	int64_t	eventsUS;	// main event loop, includes SV_PacketEvent
+	int64_t	serverUS;	// SV_Frame, includes the game
+	int64_t	gameUS;
+	int		frames;
+	int		packets;
+	int		badPackets;
+	qbool	finished;
+};
+
+static cvar_t*				com_journalBench;
+static journalBenchmark_t	com_bench;
+static qbool				com_frameEventLoop;	// Com_Frame's own call to Com_EventLoop
+static qbool				com_frameEvents;	// Com_EventLoop is reading the frame's events
+static int					com_eventTime;		// time stamp of the last event Com_EventLoop read
+
 
 static void Com_InitJournaling()
 {
 	Com_StartupVariable( "journal" );
 	com_journal = Cvar_Get ("journal", "0", CVAR_INIT);
+	Com_StartupVariable( "journalbench" );
+	com_journalBench = Cvar_Get( "journalbench", "0", CVAR_INIT );
 	if ( !com_journal->integer ) {
 		return;
 	}
@@ -1721,21 +2049,85 @@ static void Com_InitJournaling()
 		Com_Printf( "Journaling events\n");
 		com_journalFile = FS_FOpenFileWrite( "journal.dat" );
 		com_journalDataFile = FS_FOpenFileWrite( "journaldata.dat" );
+		com_journalPacketFile = FS_FOpenFileWrite( "journalpackets.dat" );
 	} else if ( com_journal->integer == 2 ) {
 		Com_Printf( "Replaying journaled events\n");
 		FS_FOpenFileRead( "journal.dat", &com_journalFile, qtrue );
 		FS_FOpenFileRead( "journaldata.dat", &com_journalDataFile, qtrue );
+		FS_FOpenFileRead( "journalpackets.dat", &com_journalPacketFile, qtrue );
+		if ( com_journalBench->integer ) {
+			Com_Printf( "Benchmarking the replay\n" );
+			if ( !com_journalPacketFile )
+				Com_Printf( "^3WARNING: journalpackets.dat not found, outgoing packets won't be verified\n" );
+			com_bench.startUS = Sys_Microseconds();
+		}
 	}
 
 	if ( !com_journalFile || !com_journalDataFile ) {
 		Cvar_Set( "com_journal", "0" );
 		com_journalFile = 0;
 		com_journalDataFile = 0;
+		com_journalPacketFile = 0;
 		Com_Printf( "Couldn't open journal files\n" );
 	}
 }
 
 
+static qbool Com_JournalBenchmark()
+{
+	return com_journal->integer == 2 && com_journalBench->integer;
+}
+
+
+static void Com_JournalBenchmarkEnd()
+{
+	com_bench.finished = qtrue;
+
+	const int frames = max( com_bench.frames, 1 );
+	const double seconds = (double)( Sys_Microseconds() - com_bench.startUS ) / 1000000.0;
+	Com_Printf( "Journal replay: %d frames in %.3f seconds, %.1f frames/s\n",
+		com_bench.frames, seconds, seconds > 0.0 ? (double)com_bench.frames / seconds : 0.0 );
+	Com_Printf( "  events: %7.1f us/frame\n", (double)com_bench.eventsUS / frames );
+	Com_Printf( "  server: %7.1f us/frame\n", (double)( com_bench.serverUS - com_bench.gameUS ) / frames );
+	Com_Printf( "  game:   %7.1f us/frame\n", (double)com_bench.gameUS / frames );
+	if ( com_journalPacketFile )
+		Com_Printf( "  %d outgoing packets checked, %d mismatched\n", com_bench.packets, com_bench.badPackets );
+
+	Com_Quit( com_bench.badPackets > 0 ? 1 : 0 );
+}
+
+
+qbool Com_JournalPacket( netsrc_t sock, int length, const void* data )
+{
+	if ( sock != NS_SERVER || !com_journalPacketFile || com_bench.finished )
+		return !com_journal || !Com_JournalBenchmark();
+
+	journalPacket_t packet;
+	packet.frame = com_frameNumber;
+	packet.length = length;
+	CRC32_Begin( &packet.crc32 );
+	CRC32_ProcessBlock( &packet.crc32, data, length );
+	CRC32_End( &packet.crc32 );
+
+	if ( com_journal->integer == 1 ) {
+		FS_Write( &packet, sizeof(packet), com_journalPacketFile );
+		return qtrue;
+	}
+
+	journalPacket_t recorded;
+	const int r = FS_Read( &recorded, sizeof(recorded), com_journalPacketFile );
+	com_bench.packets++;
+	if ( r != sizeof(recorded) || memcmp( &recorded, &packet, sizeof(packet) ) != 0 ) {
+		if ( com_bench.badPackets++ == 0 ) {
+			Com_Printf( "^3WARNING: outgoing packet %d (frame %d, %d bytes) doesn't match the journal\n",
+				com_bench.packets, packet.frame, packet.length );
+		}
+	}
+
+	return !Com_JournalBenchmark();
+}
+
+
 static sysEvent_t Com_GetRealEvent()
 {
 	int			r;
@@ -1745,6 +2137,9 @@ static sysEvent_t Com_GetRealEvent()
 	if ( com_journal->integer == 2 ) {
 		r = FS_Read( &ev, sizeof(ev), com_journalFile );
 		if ( r != sizeof(ev) ) {
+			if ( Com_JournalBenchmark() ) {
+				Com_JournalBenchmarkEnd();
+			}
 			Com_Error( ERR_FATAL, "Error reading from journal file" );
 		}
 		if ( ev.evPtrLength ) {
@@ -1759,6 +2154,9 @@ static sysEvent_t Com_GetRealEvent()
 
 		// write the journal value out if needed
 		if ( com_journal->integer == 1 ) {
+			if ( ev.evType == SE_NONE && com_frameEvents ) {
+				ev.evValue = JOURNAL_FRAME_END;
+			}
 			r = FS_Write( &ev, sizeof(ev), com_journalFile );
 			if ( r != sizeof(ev) ) {
 				Com_Error( ERR_FATAL, "Error writing to journal file" );
@@ -1839,10 +2237,19 @@ int Com_EventLoop()
 
 	while ( 1 ) {
 		NET_FlushPacketQueue();
+		com_frameEvents = com_frameEventLoop;
 		ev = Com_GetEvent();
+		com_frameEvents = qfalse;
+		com_eventTime = ev.evTime;
 
 		// if no more events are available
 		if ( ev.evType == SE_NONE ) {
+			// the benchmark doesn't sleep, so the frame also runs the events
+			// that were read by the event loops of the sleep
+			if ( com_frameEventLoop && ev.evValue != JOURNAL_FRAME_END && Com_JournalBenchmark() ) {
+				continue;
+			}
+
 			// manually send packet events for the loopback channel
 #ifndef DEDICATED
 			while ( NET_GetLoopPacket( NS_CLIENT, &evFrom, &buf ) ) {
@@ -1917,6 +2324,18 @@ int Com_EventLoop()
 }
 
 
+// while journaling, the time stamp of the event being handled stands in for the
+// real time so that a replay computes the same pings and sends the same bytes
+
+int Com_NetworkMilliseconds()
+{
+	if ( com_journal && com_journal->integer )
+		return com_eventTime;
+
+	return Sys_Milliseconds();
+}
+
+
 // can be used for profiling, but will be journaled accurately
 
 int Com_Milliseconds()
@@ -2178,6 +2597,7 @@ static const cmdTableItem_t com_cmds[] =
 	{ "rand", Com_Rand_f },
 #endif
 	{ "quit", Com_Quit_f, NULL, "closes the application" },
+	{ "clearsharedmapdata", Com_ClearSharedMapData_f, NULL, "removes the shared map data segments" },
 	{ "writeconfig", Com_WriteConfig_f, Com_CompleteWriteConfig_f, help_writeconfig }
 };
 
@@ -2210,6 +2630,7 @@ static const cvarTableItem_t com_cvars[] =
 	{ &sv_packetdelay, "sv_packetdelay", "0", CVAR_CHEAT, CVART_INTEGER, "0", NULL },
 	{ &com_sv_running, "sv_running", "0", CVAR_ROM, CVART_BOOL },
 	{ &com_cl_running, "cl_running", "0", CVAR_ROM, CVART_BOOL },
+	{ &com_sharedMapData, "com_sharedMapData", "0", 0, CVART_BOOL, NULL, NULL, "shares read-only map data with the other server processes of the host" },
 #if defined(_WIN32) && defined(_DEBUG)
 	{ &com_noErrorInterrupt, "com_noErrorInterrupt", "0", 0, CVART_BOOL },
 #endif
@@ -2472,6 +2893,10 @@ static void Com_FrameSleep( qbool demoPlayback )
 	if ( demoPlayback && com_timedemo->integer )
 		return;
 
+	// so do journal benchmarks
+	if ( Com_JournalBenchmark() )
+		return;
+
 	// decide how much sleep we need
 	qbool preciseCap = qfalse;
 	int64_t sleepUS = 0;
@@ -2565,7 +2990,11 @@ void Com_Frame( qbool demoPlayback )
 
 	static int lastTime = 0;
 	lastTime = com_frameTime;
+	const int64_t timeBeforeEventsUS = Sys_Microseconds();
+	com_frameEventLoop = qtrue;
 	com_frameTime = Com_EventLoop();
+	com_frameEventLoop = qfalse;
+	const int64_t timeAfterEventsUS = Sys_Microseconds();
 	int msec = com_frameTime - lastTime;
 
 	Cbuf_Execute();
@@ -2580,8 +3009,16 @@ void Com_Frame( qbool demoPlayback )
 		timeBeforeServer = Sys_Milliseconds();
 	}
 
+	const int64_t timeBeforeServerUS = Sys_Microseconds();
 	SV_Frame( msec );
 
+	if ( Com_JournalBenchmark() ) {
+		com_bench.frames++;
+		com_bench.eventsUS += timeAfterEventsUS - timeBeforeEventsUS;
+		com_bench.serverUS += Sys_Microseconds() - timeBeforeServerUS;
+		com_bench.gameUS += time_gameUS;
+	}
+
 	// if "dedicated" has been modified, start up
 	// or shut down the client system.
 	// Do this after the server may have started,
@@ -2686,6 +3123,11 @@ void Com_Shutdown()
 		FS_FCloseFile( com_journalFile );
 		com_journalFile = 0;
 	}
+
+	if ( com_journalPacketFile ) {
+		FS_FCloseFile( com_journalPacketFile );
+		com_journalPacketFile = 0;
+	}
 }
 
 
@@ -101,6 +101,7 @@ void Crash_SaveModVersion(const char* modVersion)
 static void PrintQVMInfo(vmIndex_t vmIndex)
 {
 	static char callStack[MAX_VM_CALL_STACK_DEPTH * 12];
+	static char callStackSymbols[MAX_VM_CALL_STACK_DEPTH * 64];
 
 	vmCrash_t* vm = &crash.vm[vmIndex];
 	if (vm->crc32 == 0) {
@@ -142,6 +143,18 @@ static void PrintQVMInfo(vmIndex_t vmIndex)
 					Q_strcat(callStack, sizeof(callStack), " ");
 			}
 			JSONW_StringValue("call_stack", callStack);
+
+			// only if they were already loaded, parsing them here isn't safe
+			if (vmp->symbols != NULL) {
+				callStackSymbols[0] = '\0';
+				for (int i = 0; i < d; i++) {
+					const vmSymbol_t* const sym = VM_FindSymbol(vmp, vmp->callStack[i]);
+					Q_strcat(callStackSymbols, sizeof(callStackSymbols), sym != NULL ? sym->symName : "?");
+					if (i + 1 < d)
+						Q_strcat(callStackSymbols, sizeof(callStackSymbols), " ");
+				}
+				JSONW_StringValue("call_stack_symbols", callStackSymbols);
+			}
 		}
 	}
 
@@ -186,6 +186,11 @@ typedef struct fileInPack_s {
 	char					*name;		// name of the file
 	unsigned long			pos;		// file info position in zip
 	struct fileInPack_s*	next;		// next file in the hash
+	// only set when the pk3 file is mapped
+	int						localHeader;	// offset of the local header in the mapping
+	int						compression;	// 0 (stored) or 8 (deflated)
+	int						compressedSize;
+	int						size;
 } fileInPack_t;
 
 typedef struct {
@@ -200,6 +205,8 @@ typedef struct {
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t*	*hashTable;					// hash table
 	fileInPack_t*	buildBuffer;				// buffer with the filenames etc.
+	const byte*		mapping;					// the whole pk3 file, NULL when not mapped
+	int				mappingSize;
 } pack_t;
 
 typedef struct {
@@ -213,6 +220,28 @@ typedef struct searchpath_s {
 	directory_t	*dir;
 } searchpath_t;
 
+// global index of the files in all the pk3 files of the search path
+// a file present in several pk3 files has one entry per pk3 file
+typedef struct fileIndexEntry_s {
+	const fileInPack_t*			file;
+	const pack_t*				pack;
+	struct fileIndexEntry_s*	next;		// next entry in the hash bucket
+} fileIndexEntry_t;
+
+// loose file paths that failed to open
+typedef struct missingPath_s {
+	unsigned int			hash;
+	struct missingPath_s*	next;			// next path in the hash bucket
+	char					path[1];		// allocated with the structure
+} missingPath_t;
+
+#define MISSING_PATH_HASH_SIZE	1024
+#define MAX_MISSING_PATHS		4096
+
+static const byte* FS_MappedFileData( const pack_t* pack, const fileInPack_t* file );
+static qbool FS_IsMappedFile( const pack_t* pack, const fileInPack_t* file );
+static qbool FS_ReadMappedFile( const pack_t* pack, const fileInPack_t* file, byte* buffer );
+
 static char fs_gamedir[MAX_OSPATH]; // this will be a single file name with no separators
 static cvar_t* fs_debug;
 static cvar_t* fs_homepath;
@@ -225,6 +254,8 @@ static cvar_t* fs_developer;
 #endif
 static cvar_t* fs_basegame;
 static cvar_t* fs_gamedirvar;
+static cvar_t* fs_mappaks;
+static cvar_t* fs_scanthreads;
 static searchpath_t* fs_searchpaths;
 
 static int fs_readCount;	// total bytes read
@@ -234,6 +265,13 @@ static int fs_packFiles;	// total number of files in packs
 
 static int fs_checksumFeed;
 
+static fileIndexEntry_t**	fs_fileIndex;			// hash table, NULL until built
+static fileIndexEntry_t*	fs_fileIndexEntries;
+static int					fs_fileIndexSize;		// hash table size (power of 2)
+
+static missingPath_t*		fs_missingPaths[MISSING_PATH_HASH_SIZE];
+static int					fs_numMissingPaths;
+
 typedef union {
 	FILE*		o;
 	unzFile		z;
@@ -301,6 +339,176 @@ int Q_FileHash( const char* s, int tablesize )
 }
 
 
+// case and separator insensitive like FS_FilenameCompare, extension included
+
+static unsigned int FS_IndexHash( const char* s )
+{
+	unsigned int hash = 0;
+
+	for (int i = 0; s[i]; ++i) {
+		int ch = tolower(s[i]);
+		if (ch == '\\' || ch == ':')
+			ch = '/';
+		hash = hash * 31 + ch;
+	}
+
+	return hash;
+}
+
+
+static void FS_FreeFileIndex()
+{
+	if (fs_fileIndex)
+		Z_Free( fs_fileIndex );
+	if (fs_fileIndexEntries)
+		Z_Free( fs_fileIndexEntries );
+	fs_fileIndex = NULL;
+	fs_fileIndexEntries = NULL;
+	fs_fileIndexSize = 0;
+}
+
+
+// indexes the files of every pk3 file on the search path
+// must be called again whenever packs are added or removed
+
+static void FS_BuildFileIndex()
+{
+	FS_FreeFileIndex();
+
+	int numFiles = 0;
+	for (const searchpath_t* search = fs_searchpaths; search; search = search->next) {
+		if (search->pack)
+			numFiles += search->pack->numfiles;
+	}
+	if (!numFiles)
+		return;
+
+	fs_fileIndexSize = 1;
+	while (fs_fileIndexSize < numFiles)
+		fs_fileIndexSize <<= 1;
+
+	fs_fileIndex = (fileIndexEntry_t**)Z_Malloc( fs_fileIndexSize * sizeof(fileIndexEntry_t*) );
+	fs_fileIndexEntries = (fileIndexEntry_t*)Z_Malloc( numFiles * sizeof(fileIndexEntry_t) );
+	Com_Memset( fs_fileIndex, 0, fs_fileIndexSize * sizeof(fileIndexEntry_t*) );
+
+	fileIndexEntry_t* entry = fs_fileIndexEntries;
+	for (const searchpath_t* search = fs_searchpaths; search; search = search->next) {
+		const pack_t* const pack = search->pack;
+		if (!pack)
+			continue;
+		for (int i = 0; i < pack->numfiles; ++i, ++entry) {
+			const unsigned int hash = FS_IndexHash( pack->buildBuffer[i].name ) & (fs_fileIndexSize - 1);
+			entry->file = &pack->buildBuffer[i];
+			entry->pack = pack;
+			entry->next = fs_fileIndex[hash];
+			fs_fileIndex[hash] = entry;
+		}
+	}
+}
+
+
+// returns qfalse if the file is in none of the pk3 files
+
+static qbool FS_FileIsIndexed( const char* filename, unsigned int indexHash )
+{
+	if (!fs_fileIndex)
+		return qtrue;
+
+	for (const fileIndexEntry_t* entry = fs_fileIndex[indexHash & (fs_fileIndexSize - 1)]; entry; entry = entry->next) {
+		if (!FS_FilenameCompare( entry->file->name, filename ))
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
+
+static const fileInPack_t* FS_FindFileInPack( const pack_t* pack, const char* filename, unsigned int indexHash )
+{
+	if (fs_fileIndex) {
+		for (const fileIndexEntry_t* entry = fs_fileIndex[indexHash & (fs_fileIndexSize - 1)]; entry; entry = entry->next) {
+			if (entry->pack == pack && !FS_FilenameCompare( entry->file->name, filename ))
+				return entry->file;
+		}
+		return NULL;
+	}
+
+	// the index isn't built yet during start-up
+	for (const fileInPack_t* pakFile = pack->hashTable[Q_FileHash( filename, pack->hashSize )]; pakFile; pakFile = pakFile->next) {
+		if (!FS_FilenameCompare( pakFile->name, filename ))
+			return pakFile;
+	}
+
+	return NULL;
+}
+
+
+static void FS_ClearMissingPaths()
+{
+	for (int i = 0; i < MISSING_PATH_HASH_SIZE; ++i) {
+		missingPath_t* next;
+		for (missingPath_t* missing = fs_missingPaths[i]; missing; missing = next) {
+			next = missing->next;
+			Z_Free( missing );
+		}
+		fs_missingPaths[i] = NULL;
+	}
+	fs_numMissingPaths = 0;
+}
+
+
+static unsigned int FS_MissingPathHash( const char* osPath )
+{
+	unsigned int hash = 0;
+
+	for (int i = 0; osPath[i]; ++i)
+		hash = hash * 31 + (unsigned char)osPath[i];
+
+	return hash;
+}
+
+
+// opens a loose file for reading
+// paths that failed to open are remembered until something is written through the file system
+// or the next map change, except for config files since admins add and exec those at any time
+
+static FILE* FS_OpenOSPathRead( const char* osPath )
+{
+#if defined( FS_DEVELOPER )
+	// assets are edited while the game is running
+	if (fs_developer->integer)
+		return fopen( osPath, "rb" );
+#endif
+
+	const int length = strlen( osPath );
+	if (length >= 4 && !Q_stricmp( osPath + length - 4, ".cfg" ))
+		return fopen( osPath, "rb" );
+
+	const unsigned int hash = FS_MissingPathHash( osPath );
+	missingPath_t** const bucket = &fs_missingPaths[hash & (MISSING_PATH_HASH_SIZE - 1)];
+	for (const missingPath_t* missing = *bucket; missing; missing = missing->next) {
+		if (missing->hash == hash && !strcmp( missing->path, osPath ))
+			return NULL;
+	}
+
+	FILE* const f = fopen( osPath, "rb" );
+	if (f)
+		return f;
+
+	if (fs_numMissingPaths >= MAX_MISSING_PATHS)
+		FS_ClearMissingPaths();
+
+	missingPath_t* const missing = (missingPath_t*)Z_Malloc( sizeof(missingPath_t) + length );
+	missing->hash = hash;
+	Com_Memcpy( missing->path, osPath, length + 1 );
+	missing->next = *bucket;
+	*bucket = missing;
+	fs_numMissingPaths++;
+
+	return NULL;
+}
+
+
 qbool FS_Initialized()
 {
 	return (fs_searchpaths != NULL);
@@ -345,7 +553,7 @@ static fileHandle_t FS_HandleForFile()
 }
 
 
-static FILE* FS_FileForHandle( fileHandle_t f )
+FILE* FS_FileForHandle( fileHandle_t f )
 {
 	if ( f < 0 || f >= MAX_FILE_HANDLES ) {
 		Com_Error( ERR_DROP, "FS_FileForHandle: out of range" );
@@ -468,6 +676,7 @@ FS_Remove
 */
 void FS_Remove( const char *osPath ) {
 	remove( osPath );
+	FS_ClearMissingPaths();
 }
 
 /*
@@ -479,6 +688,7 @@ FS_HomeRemove
 void FS_HomeRemove( const char *homePath ) {
 	remove( FS_BuildOSPath( fs_homepath->string,
 			fs_gamedir, homePath ) );
+	FS_ClearMissingPaths();
 }
 
 /*
@@ -499,7 +709,7 @@ qbool FS_FileExists( const char* file )
 qbool FS_FileExistsEx( const char* file, qbool curGameDir )
 {
 	const char* testpath = FS_BuildOSPath( fs_homepath->string, curGameDir ? fs_gamedir : "baseq3", file );
-	FILE* f = fopen( testpath, "rb" );
+	FILE* f = FS_OpenOSPathRead( testpath );
 	if (f) {
 		fclose( f );
 		return qtrue;
@@ -522,7 +732,7 @@ static qbool FS_SV_FileExists( const char *file )
 	testpath = FS_BuildOSPath( fs_homepath->string, file, "");
 	testpath[strlen(testpath)-1] = '\0';
 
-	f = fopen( testpath, "rb" );
+	f = FS_OpenOSPathRead( testpath );
 	if (f) {
 		fclose( f );
 		return qtrue;
@@ -559,6 +769,8 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 		return 0;
 	}
 
+	FS_ClearMissingPaths();
+
 	Com_DPrintf( "writing to: %s\n", ospath );
 	fsh[f].handleFiles.file.o = fopen( ospath, "wb" );
 
@@ -610,7 +822,7 @@ int FS_SV_FOpenFileRead( const char *filename, fileHandle_t *fp )
 		Com_Printf( "FS_SV_FOpenFileRead (fs_homepath): %s\n", ospath );
 	}
 
-	fsh[f].handleFiles.file.o = fopen( ospath, "rb" );
+	fsh[f].handleFiles.file.o = FS_OpenOSPathRead( ospath );
 	fsh[f].handleSync = qfalse;
 
   if (!fsh[f].handleFiles.file.o)
@@ -627,7 +839,7 @@ int FS_SV_FOpenFileRead( const char *filename, fileHandle_t *fp )
         Com_Printf( "FS_SV_FOpenFileRead (fs_basepath): %s\n", ospath );
       }
 
-      fsh[f].handleFiles.file.o = fopen( ospath, "rb" );
+      fsh[f].handleFiles.file.o = FS_OpenOSPathRead( ospath );
       fsh[f].handleSync = qfalse;
 
       if ( !fsh[f].handleFiles.file.o )
@@ -671,6 +883,8 @@ void FS_SV_Rename( const char *from, const char *to ) {
 		Com_Printf( "FS_SV_Rename: %s --> %s\n", from_ospath, to_ospath );
 	}
 
+	FS_ClearMissingPaths();
+
 	if (rename( from_ospath, to_ospath )) {
 		// Failed, try copying it and deleting the original
 		//FS_CopyFile( from_ospath, to_ospath );
@@ -702,6 +916,8 @@ void FS_Rename( const char *from, const char *to ) {
 		Com_Printf( "FS_Rename: %s --> %s\n", from_ospath, to_ospath );
 	}
 
+	FS_ClearMissingPaths();
+
 	rename( from_ospath, to_ospath );
 }
 
@@ -767,6 +983,8 @@ fileHandle_t FS_FOpenFileWrite( const char *filename ) {
 		return 0;
 	}
 
+	FS_ClearMissingPaths();
+
 	// enabling the following line causes a recursive function call loop
 	// when running with +set logfile 1 +set developer 1
 	//Com_DPrintf( "writing to: %s\n", ospath );
@@ -827,6 +1045,8 @@ fileHandle_t FS_FOpenFileAppend( const char *filename ) {
 		return 0;
 	}
 
+	FS_ClearMissingPaths();
+
 	fsh[f].handleFiles.file.o = fopen( ospath, "ab" );
 	fsh[f].handleSync = qfalse;
 	if (!fsh[f].handleFiles.file.o) {
@@ -907,19 +1127,22 @@ separate file or a ZIP file.
 */
 extern qbool		com_fullyInitialized;
 
-int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE, int *pakChecksum ) {
+// when mappedFile is non-NULL and the file is found in a mapped pk3 file,
+// *file is set to 0 and the pack entry is returned instead of a handle
+static int FS_FOpenFileReadEx( const char *filename, fileHandle_t *file, qbool uniqueFILE, int *pakChecksum,
+							   const pack_t **mappedPak, const fileInPack_t **mappedFile ) {
 	searchpath_t	*search;
 	char			*netpath;
 	pack_t			*pak;
-	fileInPack_t	*pakFile;
+	const fileInPack_t	*pakFile;
 	directory_t		*dir;
-	long			hash;
+	unsigned int	indexHash;
+	qbool			indexed;
 	unz_s			*zfi;
 	FILE			*temp;
 	int				l;
 	char			demoExt[16];
 
-	hash = 0;
 	if ( pakChecksum ) {
 		*pakChecksum = 0;
 	}
@@ -930,31 +1153,26 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE
 
 	if ( file == NULL ) {
 		// just wants to see if file is there
+		indexHash = FS_IndexHash( filename );
+		indexed = FS_FileIsIndexed( filename, indexHash );
 		for ( search = fs_searchpaths ; search ; search = search->next ) {
-			//
-			if ( search->pack ) {
-				hash = Q_FileHash( filename, search->pack->hashSize );
-			}
 			// is the element a pak file?
-			if ( search->pack && search->pack->hashTable[hash] ) {
-				// look through all the pak file elements
+			if ( search->pack ) {
+				if ( !indexed ) {
+					continue;
+				}
 				pak = search->pack;
-				pakFile = pak->hashTable[hash];
-				do {
-					// case and separator insensitive comparisons
-					if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-						// found it!
-						if ( pakChecksum ) {
-							*pakChecksum = pak->checksum;
-						}
-						return qtrue;
+				if ( FS_FindFileInPack( pak, filename, indexHash ) ) {
+					// found it!
+					if ( pakChecksum ) {
+						*pakChecksum = pak->checksum;
 					}
-					pakFile = pakFile->next;
-				} while(pakFile != NULL);
+					return qtrue;
+				}
 			} else if ( search->dir ) {
 				dir = search->dir;
 				netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
-				temp = fopen (netpath, "rb");
+				temp = FS_OpenOSPathRead( netpath );
 				if ( !temp ) {
 					continue;
 				}
@@ -997,90 +1215,101 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE
 	*file = FS_HandleForFile();
 	fsh[*file].handleFiles.unique = uniqueFILE;
 
+	indexHash = FS_IndexHash( filename );
+	indexed = FS_FileIsIndexed( filename, indexHash );
+
 	for ( search = fs_searchpaths ; search ; search = search->next ) {
-		//
-		if ( search->pack ) {
-			hash = Q_FileHash( filename, search->pack->hashSize );
-		}
 		// is the element a pak file?
-		if ( search->pack && search->pack->hashTable[hash] ) {
+		if ( search->pack ) {
+			if ( !indexed ) {
+				continue;
+			}
 			// disregard if it doesn't match one of the allowed pure pak files
 			if ( !FS_PakIsPure(search->pack) ) {
 				continue;
 			}
 
-			// look through all the pak file elements
 			pak = search->pack;
-			pakFile = pak->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					// found it!
-
-					// mark the pak as having been referenced and mark specifics on cgame and ui
-					// shaders, txt, arena files  by themselves do not count as a reference as 
-					// these are loaded from all pk3s 
-					// from every pk3 file.. 
-					l = strlen( filename );
-					if ( !(pak->referenced & FS_GENERAL_REF)) {
-						if ( Q_stricmp(filename + l - 7, ".shader") != 0 &&
-							Q_stricmp(filename + l - 4, ".txt") != 0 &&
-							Q_stricmp(filename + l - 4, ".cfg") != 0 &&
-							Q_stricmp(filename + l - 7, ".config") != 0 &&
-							strstr(filename, "levelshots") == NULL &&
-							Q_stricmp(filename + l - 4, ".bot") != 0 &&
-							Q_stricmp(filename + l - 6, ".arena") != 0 &&
-							Q_stricmp(filename + l - 5, ".menu") != 0) {
-							pak->referenced |= FS_GENERAL_REF;
-						}
-					}
-
-					if (!(pak->referenced & FS_QAGAME_REF) && !Q_stricmp(filename, "vm/qagame.qvm")) {
-						pak->referenced |= FS_QAGAME_REF;
-					}
-					if (!(pak->referenced & FS_CGAME_REF) && !Q_stricmp(filename, "vm/cgame.qvm")) {
-						pak->referenced |= FS_CGAME_REF;
-					}
-					if (!(pak->referenced & FS_UI_REF) && !Q_stricmp(filename, "vm/ui.qvm")) {
-						pak->referenced |= FS_UI_REF;
+			pakFile = FS_FindFileInPack( pak, filename, indexHash );
+			if ( pakFile ) {
+				// found it!
+
+				// mark the pak as having been referenced and mark specifics on cgame and ui
+				// shaders, txt, arena files  by themselves do not count as a reference as 
+				// these are loaded from all pk3s 
+				// from every pk3 file.. 
+				l = strlen( filename );
+				if ( !(pak->referenced & FS_GENERAL_REF)) {
+					if ( Q_stricmp(filename + l - 7, ".shader") != 0 &&
+						Q_stricmp(filename + l - 4, ".txt") != 0 &&
+						Q_stricmp(filename + l - 4, ".cfg") != 0 &&
+						Q_stricmp(filename + l - 7, ".config") != 0 &&
+						strstr(filename, "levelshots") == NULL &&
+						Q_stricmp(filename + l - 4, ".bot") != 0 &&
+						Q_stricmp(filename + l - 6, ".arena") != 0 &&
+						Q_stricmp(filename + l - 5, ".menu") != 0) {
+						pak->referenced |= FS_GENERAL_REF;
 					}
+				}
 
-					if ( uniqueFILE ) {
-						// open a new file on the pakfile
-						fsh[*file].handleFiles.file.z = unzReOpen (pak->pakFilename, pak->handle);
-						if (fsh[*file].handleFiles.file.z == NULL) {
-							Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->pakFilename);
-						}
-					} else {
-						fsh[*file].handleFiles.file.z = pak->handle;
-					}
-					Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
-					fsh[*file].zipFile = qtrue;
-					zfi = (unz_s *)fsh[*file].handleFiles.file.z;
-					// in case the file was new
-					temp = zfi->file;
-					// set the file position in the zip file (also sets the current file info)
-					unzSetCurrentFileInfoPosition(pak->handle, pakFile->pos);
-					// copy the file info into the unzip structure
-					Com_Memcpy( zfi, pak->handle, sizeof(unz_s) );
-					// we copy this back into the structure
-					zfi->file = temp;
-					// open the file in the zip
-					unzOpenCurrentFile( fsh[*file].handleFiles.file.z );
-					fsh[*file].zipFilePos = pakFile->pos;
+				if (!(pak->referenced & FS_QAGAME_REF) && !Q_stricmp(filename, "vm/qagame.qvm")) {
+					pak->referenced |= FS_QAGAME_REF;
+				}
+				if (!(pak->referenced & FS_CGAME_REF) && !Q_stricmp(filename, "vm/cgame.qvm")) {
+					pak->referenced |= FS_CGAME_REF;
+				}
+				if (!(pak->referenced & FS_UI_REF) && !Q_stricmp(filename, "vm/ui.qvm")) {
+					pak->referenced |= FS_UI_REF;
+				}
 
+				if ( mappedFile && FS_IsMappedFile( pak, pakFile ) ) {
+					*file = 0;
+					*mappedPak = pak;
+					*mappedFile = pakFile;
 					if ( pakChecksum ) {
 						*pakChecksum = pak->checksum;
 					}
-
 					if ( fs_debug->integer ) {
-						Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n", 
+						Com_Printf( "FS_FOpenFileRead: %s (mapped in '%s')\n", 
 							filename, pak->pakFilename );
 					}
-					return zfi->cur_file_info.uncompressed_size;
+					return pakFile->size;
+				}
+
+				if ( uniqueFILE ) {
+					// open a new file on the pakfile
+					fsh[*file].handleFiles.file.z = unzReOpen (pak->pakFilename, pak->handle);
+					if (fsh[*file].handleFiles.file.z == NULL) {
+						Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->pakFilename);
+					}
+				} else {
+					fsh[*file].handleFiles.file.z = pak->handle;
+				}
+				Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
+				fsh[*file].zipFile = qtrue;
+				zfi = (unz_s *)fsh[*file].handleFiles.file.z;
+				// in case the file was new
+				temp = zfi->file;
+				// set the file position in the zip file (also sets the current file info)
+				unzSetCurrentFileInfoPosition(pak->handle, pakFile->pos);
+				// copy the file info into the unzip structure
+				Com_Memcpy( zfi, pak->handle, sizeof(unz_s) );
+				// we copy this back into the structure
+				zfi->file = temp;
+				// open the file in the zip
+				unzOpenCurrentFile( fsh[*file].handleFiles.file.z );
+				fsh[*file].zipFilePos = pakFile->pos;
+
+				if ( pakChecksum ) {
+					*pakChecksum = pak->checksum;
+				}
+
+				if ( fs_debug->integer ) {
+					Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n", 
+						filename, pak->pakFilename );
 				}
-				pakFile = pakFile->next;
-			} while(pakFile != NULL);
+				return zfi->cur_file_info.uncompressed_size;
+			}
 		} else if ( search->dir ) {
 			// check a file in the directory tree
 
@@ -1109,7 +1338,7 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE
 			dir = search->dir;
 			
 			netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
-			fsh[*file].handleFiles.file.o = fopen (netpath, "rb");
+			fsh[*file].handleFiles.file.o = FS_OpenOSPathRead( netpath );
 			if ( !fsh[*file].handleFiles.file.o ) {
 				continue;
 			}
@@ -1136,6 +1365,11 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE
 }
 
 
+int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE, int *pakChecksum ) {
+	return FS_FOpenFileReadEx( filename, file, uniqueFILE, pakChecksum, NULL, NULL );
+}
+
+
 int FS_FOpenAbsoluteRead( const char* absPath, fileHandle_t* file )
 {
 	Q_assert( absPath );
@@ -1396,35 +1630,30 @@ qbool FS_FileIsInPAK( const char* filename, int* pureChecksum, int* checksum )
 		return qfalse;
 	}
 
+	const unsigned int indexHash = FS_IndexHash( filename );
+	if ( !FS_FileIsIndexed( filename, indexHash ) ) {
+		return qfalse;
+	}
+
 	// search through the path, one element at a time
 
 	for ( const searchpath_t* search = fs_searchpaths; search; search = search->next ) {
 		if ( !search->pack )
 			continue;
 
-		long hash = Q_FileHash( filename, search->pack->hashSize );
-		// is the element a pak file?
-		if ( search->pack->hashTable[hash] ) {
-			// disregard if it doesn't match one of the allowed pure pak files
-			if ( !FS_PakIsPure(search->pack) ) {
-				continue;
-			}
+		// disregard if it doesn't match one of the allowed pure pak files
+		if ( !FS_PakIsPure(search->pack) ) {
+			continue;
+		}
 
-			// look through all the pak file elements
-			const fileInPack_t* pakFile = search->pack->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					if (pureChecksum) {
-						*pureChecksum = search->pack->pure_checksum;
-					}
-					if (checksum) {
-						*checksum = search->pack->checksum;
-					}
-					return qtrue;
-				}
-				pakFile = pakFile->next;
-			} while (pakFile);
+		if ( FS_FindFileInPack( search->pack, filename, indexHash ) ) {
+			if (pureChecksum) {
+				*pureChecksum = search->pack->pure_checksum;
+			}
+			if (checksum) {
+				*checksum = search->pack->checksum;
+			}
+			return qtrue;
 		}
 	}
 
@@ -1445,6 +1674,8 @@ int FS_ReadFilePak( const char *qpath, void **buffer, int *pakChecksum ) {
 	byte*			buf;
 	qbool		isConfig;
 	int				len;
+	const pack_t		*pak;
+	const fileInPack_t	*pakFile;
 
 	if ( !fs_searchpaths ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
@@ -1505,8 +1736,10 @@ int FS_ReadFilePak( const char *qpath, void **buffer, int *pakChecksum ) {
 	}
 
 	// look for it in the filesystem or pack files
-	len = FS_FOpenFileRead( qpath, &h, qfalse, pakChecksum );
-	if ( h == 0 ) {
+	pak = NULL;
+	pakFile = NULL;
+	len = FS_FOpenFileReadEx( qpath, &h, qfalse, pakChecksum, &pak, &pakFile );
+	if ( h == 0 && pakFile == NULL ) {
 		if ( buffer ) {
 			*buffer = NULL;
 		}
@@ -1526,7 +1759,9 @@ int FS_ReadFilePak( const char *qpath, void **buffer, int *pakChecksum ) {
 			FS_Write( &len, sizeof( len ), com_journalDataFile );
 			FS_Flush( com_journalDataFile );
 		}
-		FS_FCloseFile( h);
+		if ( h ) {
+			FS_FCloseFile( h );
+		}
 		return len;
 	}
 
@@ -1536,11 +1771,22 @@ int FS_ReadFilePak( const char *qpath, void **buffer, int *pakChecksum ) {
 	buf = (byte*)Hunk_AllocateTempMemory(len+1);
 	*buffer = buf;
 
-	FS_Read (buf, len, h);
+	if ( h == 0 && !FS_ReadMappedFile( pak, pakFile, buf ) ) {
+		// the entry can't be read from the mapping, let unzip deal with it
+		Com_DPrintf( "FS_ReadFile: can't read %s from the mapping of '%s'\n", qpath, pak->pakFilename );
+		FS_FOpenFileRead( qpath, &h, qfalse, NULL );
+		if ( h == 0 ) {
+			Com_Error( ERR_DROP, "FS_ReadFile: couldn't reopen %s", qpath );
+		}
+	}
+
+	if ( h ) {
+		FS_Read (buf, len, h);
+		FS_FCloseFile( h );
+	}
 
 	// guarantee that it will have a trailing 0 for string operations
 	buf[len] = 0;
-	FS_FCloseFile( h );
 
 	// if we are journalling and it is a config file, write it to the journal file
 	if ( isConfig && com_journal && com_journal->integer == 1 ) {
@@ -1578,6 +1824,129 @@ void FS_FreeFile( void *buffer ) {
 	}
 }
 
+/*
+============
+FS_ReadFileRO
+
+Like FS_ReadFile, but 4-byte aligned stored entries of mapped pk3 files are
+returned as pointers into the mapping: the buffer is read-only and it is only
+NUL-terminated when it doesn't come from the mapping.
+Other entries of mapped pk3 files are copied or inflated straight from the mapping.
+============
+*/
+int FS_ReadFileRO( const char *qpath, const void **buffer ) {
+	const pack_t		*pak;
+	const fileInPack_t	*pakFile;
+	const byte			*data;
+	fileHandle_t		h;
+	byte				*buf;
+	void				*fileBuffer;
+	int					len;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFileRO with empty name\n" );
+	}
+
+	*buffer = NULL;
+
+	// config files may have to go through the journal
+	if ( strstr( qpath, ".cfg" ) ) {
+		len = FS_ReadFile( qpath, &fileBuffer );
+		*buffer = fileBuffer;
+		return len;
+	}
+
+	pak = NULL;
+	pakFile = NULL;
+	len = FS_FOpenFileReadEx( qpath, &h, qfalse, NULL, &pak, &pakFile );
+	if ( h != 0 ) {
+		// not in a mapped pk3 file
+		fs_loadCount++;
+		fs_loadStack++;
+
+		buf = (byte*)Hunk_AllocateTempMemory( len + 1 );
+		FS_Read( buf, len, h );
+		buf[len] = 0;
+		FS_FCloseFile( h );
+
+		*buffer = buf;
+		return len;
+	}
+
+	if ( pakFile == NULL ) {
+		return -1;
+	}
+
+	// stored entries start anywhere in the pk3 file and callers cast the buffer
+	// to structures of ints and floats, so misaligned ones are copied
+	data = FS_MappedFileData( pak, pakFile );
+	if ( data != NULL && pakFile->compression == 0 && pakFile->compressedSize == len && ((intptr_t)data & 3) == 0 ) {
+		fs_loadCount++;
+		fs_readCount += len;
+		*buffer = data;
+		return len;
+	}
+
+	if ( data != NULL ) {
+		buf = (byte*)Hunk_AllocateTempMemory( len + 1 );
+		if ( FS_ReadMappedFile( pak, pakFile, buf ) ) {
+			fs_loadCount++;
+			fs_loadStack++;
+			buf[len] = 0;
+			*buffer = buf;
+			return len;
+		}
+		Hunk_FreeTempMemory( buf );
+	}
+
+	// the entry can't be read from the mapping, let unzip deal with it
+	Com_DPrintf( "FS_ReadFileRO: can't read %s from the mapping of '%s'\n", qpath, pak->pakFilename );
+	len = FS_ReadFile( qpath, &fileBuffer );
+	*buffer = fileBuffer;
+
+	return len;
+}
+
+
+static qbool FS_IsMappedBuffer( const void *buffer ) {
+	const byte* const p = (const byte*)buffer;
+
+	for ( const searchpath_t* search = fs_searchpaths; search; search = search->next ) {
+		const pack_t* const pak = search->pack;
+		if ( pak && pak->mapping && p >= pak->mapping && p < pak->mapping + pak->mappingSize ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+/*
+=============
+FS_FreeFileRO
+=============
+*/
+void FS_FreeFileRO( const void *buffer ) {
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	}
+	if ( !buffer ) {
+		Com_Error( ERR_FATAL, "FS_FreeFileRO( NULL )" );
+	}
+
+	// the mapping lives as long as the pk3 file is in the search path
+	if ( FS_IsMappedBuffer( buffer ) ) {
+		return;
+	}
+
+	FS_FreeFile( (void*)buffer );
+}
+
 /*
 ============
 FS_WriteFile
@@ -1628,66 +1997,360 @@ static const char* FS_GetFileName( const char* filePath )
 	return filePath;
 }
 
-/*
-=================
-FS_LoadZipFile
+#define ZIP_CENTRAL_HEADER_SIG		0x02014b50
+#define ZIP_CENTRAL_HEADER_SIZE		46
+#define ZIP_LOCAL_HEADER_SIG		0x04034b50
+#define ZIP_LOCAL_HEADER_SIZE		30
 
-Creates a new pak_t in the search chain for the contents
-of a zip file.
-=================
-*/
-static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
-{
-	unzFile			uf;
-	int				err;
-	unz_global_info gi;
-	char			filename_inzip[MAX_ZPATH];
-	unz_file_info	file_info;
-	int				i, len;
-	long			hash;
-	int				fs_numHeaderLongs;
+typedef enum {
+	ZIPWALK_OK,
+	ZIPWALK_LONGNAME,	// the entry was skipped
+	ZIPWALK_ERROR
+} zipWalkResult_t;
+
+// walks a central directory that is fully in memory (mapped or read in one go)
+typedef struct {
+	const byte*		data;			// start of the central directory
+	unsigned long	dataSize;
+	unsigned long	start;			// offset of the central directory
+	unsigned long	pos;			// same meaning as unzGetCurrentFileInfoPosition
+	unsigned long	byteBefore;		// bytes before the zip data (self-extracting archives)
+} zipWalk_t;
+
+typedef struct {
+	unsigned long	pos;
+	unsigned long	crc;
+	int				compression;
+	int				compressedSize;
+	int				size;
+	int				localHeader;	// only valid when mapped
+} zipEntry_t;
+
+// everything FS_LoadZipFile needs that can be gathered without the zone or the console,
+// filled by FS_ScanZipFile which is safe to run on any thread
+typedef struct {
+	char			path[MAX_OSPATH];
+	qbool			map;
+	qbool			valid;
+	const byte*		mapping;		// NULL when not mapped
+	int				mappingSize;
+	byte*			centralCopy;	// malloc'd copy of the central directory when not mapped
+	zipWalk_t		walk;			// positioned at the first entry
+	int				numEntries;
 	int				fileCount;
-	char*			filename_lastchar = &filename_inzip[sizeof(filename_inzip) - 1];
+	int				namesLength;
+	int				checksum;
+	int				pure_checksum;
+} zipScan_t;
+
+
+static unsigned int FS_ZipShort( const byte* p )
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+
+static unsigned int FS_ZipLong( const byte* p )
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+
+// reads the current entry and moves on to the next one
+static zipWalkResult_t FS_ZipWalkNext( zipWalk_t* walk, char* name, int nameSize, zipEntry_t* entry )
+{
+	const unsigned long offset = walk->pos - walk->start;
+	if ( walk->pos < walk->start || offset + ZIP_CENTRAL_HEADER_SIZE > walk->dataSize ) {
+		return ZIPWALK_ERROR;
+	}
+
+	const byte* const header = walk->data + offset;
+	if ( FS_ZipLong( header ) != ZIP_CENTRAL_HEADER_SIG ) {
+		return ZIPWALK_ERROR;
+	}
 
-	fs_numHeaderLongs = 0;
+	const unsigned int nameLength = FS_ZipShort( header + 28 );
+	const unsigned int extraLength = FS_ZipShort( header + 30 );
+	const unsigned int commentLength = FS_ZipShort( header + 32 );
+	const unsigned long headerSize = ZIP_CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+	if ( offset + headerSize > walk->dataSize ) {
+		return ZIPWALK_ERROR;
+	}
+
+	entry->pos = walk->pos;
+	walk->pos += headerSize;
+
+	if ( nameLength >= (unsigned int)nameSize ) {
+		return ZIPWALK_LONGNAME;
+	}
+	Com_Memcpy( name, header + ZIP_CENTRAL_HEADER_SIZE, nameLength );
+	name[nameLength] = '\0';
+
+	entry->crc = FS_ZipLong( header + 16 );
+	entry->compression = (int)FS_ZipShort( header + 10 );
+	entry->compressedSize = (int)FS_ZipLong( header + 20 );
+	entry->size = (int)FS_ZipLong( header + 24 );
+	entry->localHeader = (int)(FS_ZipLong( header + 42 ) + walk->byteBefore);
+
+	return ZIPWALK_OK;
+}
 
-	uf = unzOpen(zipfile);
-	err = unzGetGlobalInfo (uf,&gi);
 
-	if (err != UNZ_OK)
+// returns NULL if the local header is broken or the data doesn't fit in the mapping
+// the data has no particular alignment
+static const byte* FS_MappedFileData( const pack_t* pack, const fileInPack_t* file )
+{
+	const unsigned int offset = (unsigned int)file->localHeader;
+	if ( offset + ZIP_LOCAL_HEADER_SIZE > (unsigned int)pack->mappingSize ) {
 		return NULL;
+	}
 
-	len = 0;
-	unzGoToFirstFile(uf);
-	fileCount = 0;
+	const byte* const header = pack->mapping + offset;
+	if ( FS_ZipLong( header ) != ZIP_LOCAL_HEADER_SIG ) {
+		return NULL;
+	}
 
-	for (i = 0; i < gi.number_entry; i++)
-	{
-		*filename_lastchar = '\0';
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			Com_Printf("^3FS_LoadZipFile: ^7Can't read past entry %d in '%s'\n", i, FS_GetFileName(zipfile));
+	const unsigned int dataOffset = offset + ZIP_LOCAL_HEADER_SIZE + FS_ZipShort( header + 26 ) + FS_ZipShort( header + 28 );
+	if ( file->compressedSize < 0 ||
+		 (unsigned long)dataOffset + (unsigned long)file->compressedSize > (unsigned long)pack->mappingSize ) {
+		return NULL;
+	}
+
+	return pack->mapping + dataOffset;
+}
+
+
+static qbool FS_IsMappedFile( const pack_t* pack, const fileInPack_t* file )
+{
+	if ( pack->mapping == NULL || file->size < 0 ) {
+		return qfalse;
+	}
+
+	return file->compression == 0 || file->compression == 8;
+}
+
+
+// copies or inflates the whole file, the buffer must have room for file->size bytes
+static qbool FS_ReadMappedFile( const pack_t* pack, const fileInPack_t* file, byte* buffer )
+{
+	const byte* const data = FS_MappedFileData( pack, file );
+	if ( data == NULL ) {
+		return qfalse;
+	}
+
+	if ( file->compression == 0 ) {
+		if ( file->compressedSize != file->size ) {
+			return qfalse;
+		}
+		Com_Memcpy( buffer, data, file->size );
+	} else if ( unzInflateMemory( data, file->compressedSize, buffer, file->size ) != UNZ_OK ) {
+		return qfalse;
+	}
+
+	fs_readCount += file->size;
+
+	return qtrue;
+}
+
+
+#define ZIP_END_HEADER_SIG		0x06054b50
+#define ZIP_END_HEADER_SIZE		22
+#define ZIP_MAX_COMMENT			0xFFFF
+
+
+// same rules as unzOpen, returns NULL if the record is missing or describes a zip we can't use
+static const byte* FS_ZipFindEnd( const byte* tail, int tailSize )
+{
+	for ( int i = tailSize - ZIP_END_HEADER_SIZE; i >= 0; --i ) {
+		if ( FS_ZipLong( tail + i ) == ZIP_END_HEADER_SIG ) {
+			return tail + i;
+		}
+	}
+
+	return NULL;
+}
+
+
+static void FS_ScanZipFileEntries( zipScan_t* scan )
+{
+	char filename_inzip[MAX_ZPATH];
+	zipEntry_t entry;
+
+	int* const headerLongs = (int*)malloc( ( scan->numEntries + 1 ) * sizeof(int) );
+	if ( headerLongs == NULL ) {
+		return;
+	}
+
+	int numHeaderLongs = 0;
+	headerLongs[numHeaderLongs++] = LittleLong( fs_checksumFeed );
+
+	zipWalk_t walk = scan->walk;
+	for ( int i = 0; i < scan->numEntries; i++ ) {
+		const zipWalkResult_t err = FS_ZipWalkNext( &walk, filename_inzip, sizeof(filename_inzip), &entry );
+		if ( err == ZIPWALK_ERROR ) {
 			break;
 		}
-		if (*filename_lastchar != '\0') {
-			Com_Printf("^3FS_LoadZipFile: ^7Entry %d's name is too long in '%s'\n", i, FS_GetFileName(zipfile));
-			unzGoToNextFile(uf);
+		if ( err == ZIPWALK_LONGNAME ) {
 			continue;
 		}
-		len += strlen(filename_inzip) + 1;
-		unzGoToNextFile(uf);
-		fileCount++;
+		if ( entry.size > 0 ) {
+			headerLongs[numHeaderLongs++] = LittleLong( entry.crc );
+		}
+		scan->namesLength += strlen( filename_inzip ) + 1;
+		scan->fileCount++;
+	}
+
+	scan->checksum = LittleLong( Com_BlockChecksum( &headerLongs[1], 4 * ( numHeaderLongs - 1 ) ) );
+	scan->pure_checksum = LittleLong( Com_BlockChecksum( headerLongs, 4 * numHeaderLongs ) );
+	scan->valid = qtrue;
+
+	free( headerLongs );
+}
+
+
+// reads the central directory and computes the checksums
+// only uses malloc and stdio, so several pk3 files can be scanned at once
+static void FS_ScanZipFile( zipScan_t* scan )
+{
+	scan->valid = qfalse;
+	scan->mapping = NULL;
+	scan->mappingSize = 0;
+	scan->centralCopy = NULL;
+	scan->numEntries = 0;
+	scan->fileCount = 0;
+	scan->namesLength = 0;
+
+	// the mapping is shared with every other process reading the same pk3 file
+	// pk3 files must then be replaced (new file + rename) and never overwritten in place:
+	// reading pages past the new end of a truncated file raises SIGBUS
+	if ( scan->map ) {
+		scan->mapping = (const byte*)Sys_MapFileRead( scan->path, &scan->mappingSize );
+	}
+
+	FILE* file = NULL;
+	byte* tailCopy = NULL;
+	const byte* tail;
+	int tailSize;
+	unsigned long fileSize;
+	if ( scan->mapping != NULL ) {
+		fileSize = (unsigned long)scan->mappingSize;
+		tailSize = (int)min( fileSize, (unsigned long)(ZIP_MAX_COMMENT + ZIP_END_HEADER_SIZE) );
+		tail = scan->mapping + fileSize - tailSize;
+	} else {
+		file = fopen( scan->path, "rb" );
+		if ( file == NULL || fseek( file, 0, SEEK_END ) != 0 ) {
+			goto done;
+		}
+		const long end = ftell( file );
+		if ( end <= 0 ) {
+			goto done;
+		}
+		fileSize = (unsigned long)end;
+		tailSize = (int)min( fileSize, (unsigned long)(ZIP_MAX_COMMENT + ZIP_END_HEADER_SIZE) );
+		tailCopy = (byte*)malloc( tailSize );
+		if ( tailCopy == NULL ||
+			 fseek( file, (long)(fileSize - tailSize), SEEK_SET ) != 0 ||
+			 fread( tailCopy, tailSize, 1, file ) != 1 ) {
+			goto done;
+		}
+		tail = tailCopy;
+	}
+
+	{
+		const byte* const end = FS_ZipFindEnd( tail, tailSize );
+		if ( end == NULL ) {
+			goto done;
+		}
+
+		const unsigned long endPos = fileSize - tailSize + (unsigned long)( end - tail );
+		const unsigned int numEntries = FS_ZipShort( end + 10 );
+		const unsigned long centralSize = FS_ZipLong( end + 12 );
+		const unsigned long centralOffset = FS_ZipLong( end + 16 );
+		if ( FS_ZipShort( end + 4 ) != 0 || FS_ZipShort( end + 6 ) != 0 ||
+			 FS_ZipShort( end + 8 ) != numEntries ||
+			 endPos == 0 || centralSize > endPos || centralOffset > endPos - centralSize ) {
+			goto done;
+		}
+
+		zipWalk_t* const walk = &scan->walk;
+		walk->byteBefore = endPos - ( centralOffset + centralSize );
+		walk->start = centralOffset;
+		walk->pos = centralOffset;
+		walk->dataSize = centralSize;
+		scan->numEntries = (int)numEntries;
+
+		if ( scan->mapping != NULL ) {
+			walk->data = scan->mapping + centralOffset + walk->byteBefore;
+		} else {
+			// one read for the whole directory instead of two per entry through unzip
+			scan->centralCopy = (byte*)malloc( centralSize > 0 ? centralSize : 1 );
+			if ( scan->centralCopy == NULL ||
+				 fseek( file, (long)( centralOffset + walk->byteBefore ), SEEK_SET ) != 0 ||
+				 ( centralSize > 0 && fread( scan->centralCopy, centralSize, 1, file ) != 1 ) ) {
+				goto done;
+			}
+			walk->data = scan->centralCopy;
+		}
+	}
+
+	FS_ScanZipFileEntries( scan );
+
+done:
+	if ( file != NULL ) {
+		fclose( file );
+	}
+	free( tailCopy );
+}
+
+
+static void FS_FreeZipScan( zipScan_t* scan )
+{
+	free( scan->centralCopy );
+	scan->centralCopy = NULL;
+}
+
+
+static void FS_ScanZipFileJob( void* data, int index )
+{
+	FS_ScanZipFile( (zipScan_t*)data + index );
+}
+
+
+/*
+=================
+FS_BuildZipPack
+
+Creates a new pak_t for the contents of a scanned zip file.
+Must run on the main thread.
+=================
+*/
+static pack_t *FS_BuildZipPack( zipScan_t* scan, const char *basename )
+{
+	const char*		zipfile = scan->path;
+	unzFile			uf;
+	int				err;
+	char			filename_inzip[MAX_ZPATH];
+	zipWalk_t		walk;
+	zipEntry_t		entry;
+	int				i;
+	long			hash;
+	int				fileCount;
+
+	// the handle is still needed to stream files
+	uf = NULL;
+	if ( scan->valid && scan->fileCount > 0 ) {
+		uf = unzOpen(zipfile);
 	}
 
-	if ( !fileCount ) {
-		unzClose(uf);
+	if ( uf == NULL ) {
+		FS_FreeZipScan(scan);
+		Sys_UnmapFile(scan->mapping, scan->mappingSize);
 		return NULL;
 	}
 
-	fileInPack_t* buildBuffer = (fileInPack_t*)Z_Malloc( (fileCount * sizeof( fileInPack_t )) + len );
+	fileCount = scan->fileCount;
+	fileInPack_t* buildBuffer = (fileInPack_t*)Z_Malloc( (fileCount * sizeof( fileInPack_t )) + scan->namesLength );
 	char* namePtr = ((char*)buildBuffer) + fileCount * sizeof( fileInPack_t );
-	int* fs_headerLongs = (int*)Z_Malloc( ( fileCount + 1 ) * sizeof(int) );
-	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
 
 	// get the hash table size from the number of files in the zip
 	// because lots of custom pk3 files have less than 32 or 64 files
@@ -1714,50 +2377,69 @@ static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
 
 	pack->handle = uf;
 	pack->numfiles = fileCount;
-	unzGoToFirstFile(uf);
+	pack->mapping = scan->mapping;
+	pack->mappingSize = scan->mappingSize;
+	walk = scan->walk;
 	fileCount = 0;
 
-	for (i = 0; i < gi.number_entry; i++)
+	for (i = 0; i < scan->numEntries; i++)
 	{
-		*filename_lastchar = '\0';
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
+		err = FS_ZipWalkNext(&walk, filename_inzip, sizeof(filename_inzip), &entry);
+		if (err == ZIPWALK_ERROR) {
+			Com_Printf("^3FS_LoadZipFile: ^7Can't read past entry %d in '%s'\n", i, FS_GetFileName(zipfile));
 			break;
 		}
-		if (*filename_lastchar != '\0') {
-			unzGoToNextFile(uf);
+		if (err == ZIPWALK_LONGNAME) {
+			Com_Printf("^3FS_LoadZipFile: ^7Entry %d's name is too long in '%s'\n", i, FS_GetFileName(zipfile));
 			continue;
 		}
-		if (file_info.uncompressed_size > 0) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(file_info.crc);
-		}
 		Q_strlwr( filename_inzip );
 		hash = Q_FileHash( filename_inzip, pack->hashSize );
 		buildBuffer[fileCount].name = namePtr;
 		strcpy( buildBuffer[fileCount].name, filename_inzip );
 		namePtr += strlen(filename_inzip) + 1;
 		// store the file position in the zip
-		unzGetCurrentFileInfoPosition(uf, &buildBuffer[fileCount].pos);
+		buildBuffer[fileCount].pos = entry.pos;
+		buildBuffer[fileCount].localHeader = scan->mapping != NULL ? entry.localHeader : 0;
+		buildBuffer[fileCount].compression = entry.compression;
+		buildBuffer[fileCount].compressedSize = entry.compressedSize;
+		buildBuffer[fileCount].size = entry.size;
 
 		buildBuffer[fileCount].next = pack->hashTable[hash];
 		pack->hashTable[hash] = &buildBuffer[fileCount];
-		unzGoToNextFile(uf);
 		fileCount++;
 	}
 
-	pack->checksum = Com_BlockChecksum( &fs_headerLongs[ 1 ], 4 * ( fs_numHeaderLongs - 1 ) );
-	pack->pure_checksum = Com_BlockChecksum( fs_headerLongs, 4 * fs_numHeaderLongs );
-	pack->checksum = LittleLong( pack->checksum );
-	pack->pure_checksum = LittleLong( pack->pure_checksum );
+	pack->checksum = scan->checksum;
+	pack->pure_checksum = scan->pure_checksum;
 	pack->buildBuffer = buildBuffer;
 
-	Z_Free(fs_headerLongs);
+	FS_FreeZipScan(scan);
 
 	fs_packFiles += fileCount;
 
 	return pack;
 }
 
+
+/*
+=================
+FS_LoadZipFile
+
+Creates a new pak_t in the search chain for the contents
+of a zip file.
+=================
+*/
+static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
+{
+	zipScan_t scan;
+	Q_strncpyz( scan.path, zipfile, sizeof( scan.path ) );
+	scan.map = fs_mappaks->integer != 0;
+	FS_ScanZipFile(&scan);
+
+	return FS_BuildZipPack(&scan, basename);
+}
+
 /*
 =================================================================================
 
@@ -2402,9 +3084,26 @@ static void FS_AddGameDirectory( const char *path, const char *dir )
 
 	qsort( sorted, numfiles, sizeof(char*), paksort );
 
+	// the headers are read in parallel but the packs are created in paksort order,
+	// so the search path and the pure checksums don't depend on the thread count
+	zipScan_t* scans = NULL;
+	if ( numfiles > 1 && fs_scanthreads->integer != 1 ) {
+		scans = (zipScan_t*)Z_Malloc( numfiles * sizeof(zipScan_t) );
+		for ( i = 0 ; i < numfiles ; i++ ) {
+			Q_strncpyz( scans[i].path, FS_BuildOSPath( path, dir, sorted[i] ), sizeof( scans[i].path ) );
+			scans[i].map = fs_mappaks->integer != 0;
+		}
+		Sys_ParallelFor( numfiles, fs_scanthreads->integer, FS_ScanZipFileJob, scans );
+	}
+
 	for ( i = 0 ; i < numfiles ; i++ ) {
-		pakfile = FS_BuildOSPath( path, dir, sorted[i] );
-		if ( ( pak = FS_LoadZipFile( pakfile, sorted[i] ) ) == 0 )
+		if ( scans != NULL ) {
+			pak = FS_BuildZipPack( &scans[i], sorted[i] );
+		} else {
+			pakfile = FS_BuildOSPath( path, dir, sorted[i] );
+			pak = FS_LoadZipFile( pakfile, sorted[i] );
+		}
+		if ( pak == NULL )
 			continue;
 		// store the game name for downloading
 		strcpy(pak->pakGamename, dir);
@@ -2415,6 +3114,10 @@ static void FS_AddGameDirectory( const char *path, const char *dir )
 		fs_searchpaths = search;
 	}
 
+	if ( scans != NULL ) {
+		Z_Free( scans );
+	}
+
 	// done
 	Sys_FreeFileList( pakfiles );
 }
@@ -2442,6 +3145,41 @@ qbool FS_CheckDirTraversal(const char *checkdir)
 }
 
 
+// the VMs can write files in their gamedir, so it must be a relative path
+// whose first folder isn't where the engine keeps executable code
+
+qbool FS_IsGameDirAllowed( const char* gamedir )
+{
+	if (strchr( gamedir, ':' ))
+		return qfalse;
+
+	const char* component = gamedir;
+	qbool first = qtrue;
+	for (;;) {
+		int length = 0;
+		while (component[length] && component[length] != '/' && component[length] != '\\')
+			length++;
+
+		// Windows ignores trailing dots and spaces, which also takes care of "." and ".."
+		int nameLength = length;
+		while (nameLength > 0 && (component[nameLength - 1] == '.' || component[nameLength - 1] == ' '))
+			nameLength--;
+		if (nameLength == 0)
+			return qfalse;
+
+		if (first) {
+			if (nameLength == (int)strlen( FS_VM_CACHE_DIR ) && !Q_stricmpn( component, FS_VM_CACHE_DIR, nameLength ))
+				return qfalse;
+			first = qfalse;
+		}
+
+		if (!component[length])
+			return qtrue;
+		component += length + 1;
+	}
+}
+
+
 /*
 dlstring == qtrue
 
@@ -2642,6 +3380,7 @@ void FS_Shutdown( qbool closemfp ) {
 
 		if ( p->pack ) {
 			unzClose(p->pack->handle);
+			Sys_UnmapFile( p->pack->mapping, p->pack->mappingSize );
 			Z_Free( p->pack->buildBuffer );
 			Z_Free( p->pack );
 		}
@@ -2654,6 +3393,9 @@ void FS_Shutdown( qbool closemfp ) {
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
 
+	FS_FreeFileIndex();
+	FS_ClearMissingPaths();
+
 	Cmd_UnregisterArray( fs_cmds );
 
 #ifdef FS_MISSING
@@ -2732,6 +3474,15 @@ static void FS_Startup( const char *gameName )
 	if (!homePath || !homePath[0])
 		homePath = fs_basepath->string;
 	fs_homepath = Cvar_Get ("fs_homepath", homePath, CVAR_INIT );
+	fs_mappaks = Cvar_Get( "fs_mappaks", "0", CVAR_INIT );
+	Cvar_SetRange( "fs_mappaks", CVART_BOOL, NULL, NULL );
+	Cvar_SetHelp( "fs_mappaks", "maps pk3 files in memory for zero-copy reads\n"
+		"Only enable it if pk3 files are never modified in place while the process runs:\n"
+		"overwriting or truncating a mapped pk3 file crashes the process (SIGBUS),\n"
+		"new versions must be written to another file and renamed over the old one" );
+	fs_scanthreads = Cvar_Get( "fs_scanthreads", "0", CVAR_INIT );
+	Cvar_SetRange( "fs_scanthreads", CVART_INTEGER, "0", "16" );
+	Cvar_SetHelp( "fs_scanthreads", "threads reading pk3 headers at startup\n0 means one per core, 1 disables threading" );
 
 	// add search path elements in reverse priority order
 	if (fs_basepath->string[0]) {
@@ -2759,7 +3510,9 @@ static void FS_Startup( const char *gameName )
 	}
 
 	// check for additional game folder for mods
-	if ( fs_gamedirvar->string[0] && !Q_stricmp( gameName, BASEGAME ) && Q_stricmp( fs_gamedirvar->string, gameName ) ) {
+	if ( fs_gamedirvar->string[0] && !FS_IsGameDirAllowed( fs_gamedirvar->string ) ) {
+		Com_Printf( "WARNING: fs_game %s is not allowed, ignoring it\n", fs_gamedirvar->string );
+	} else if ( fs_gamedirvar->string[0] && !Q_stricmp( gameName, BASEGAME ) && Q_stricmp( fs_gamedirvar->string, gameName ) ) {
 		if (fs_basepath->string[0]) {
 			FS_AddGameDirectory(fs_basepath->string, fs_gamedirvar->string);
 		}
@@ -2804,6 +3557,8 @@ static void FS_Startup( const char *gameName )
 
 	fs_gamedirvar->modified = qfalse; // We just loaded, it's not modified
 
+	FS_BuildFileIndex();
+
 #ifdef FS_MISSING
 	if (missingFiles == NULL) {
 		missingFiles = fopen( "\\missing.txt", "ab" );
@@ -3271,7 +4026,13 @@ restart if necessary
 void FS_ConditionalRestart( int checksumFeed ) {
 	if( fs_gamedirvar->modified || checksumFeed != fs_checksumFeed ) {
 		FS_Restart( checksumFeed );
-	} else if ( fs_numServerPaks && !fs_reordered ) {
+		return;
+	}
+
+	// files may have been added since the last map was loaded
+	FS_ClearMissingPaths();
+
+	if ( fs_numServerPaks && !fs_reordered ) {
 		FS_ReorderPurePaks();
 	}
 }
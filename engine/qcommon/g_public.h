@@ -411,7 +411,11 @@ typedef enum {
 	G_EXT_CVAR_SETRANGE,
 	G_EXT_CVAR_SETHELP,
 	G_EXT_CMD_SETHELP,
-	G_EXT_ERROR2
+	G_EXT_ERROR2,
+	G_EXT_SETTRACETIME,
+	G_EXT_TRACEATTIME,
+	G_EXT_RESETENTITYHISTORY,
+	G_EXT_MICROSECONDS
 } gameImport_t;
 
 
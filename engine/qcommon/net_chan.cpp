@@ -549,6 +549,9 @@ void NET_SendPacket( netsrc_t sock, int length, const void* data, const netadr_t
 	if ( to.type == NA_BAD ) {
 		return;
 	}
+	if ( !Com_JournalPacket( sock, length, data ) ) {
+		return;
+	}
 
 	if ( sock == NS_CLIENT && cl_packetdelay->integer > 0 ) {
 		NET_QueuePacket( length, data, to, cl_packetdelay->integer );
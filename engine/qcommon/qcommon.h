@@ -98,6 +98,8 @@ NET
 
 #define	MAX_PACKET_USERCMDS		32		// max number of usercmd_t in a packet
 
+#define	MAX_ENTITIES_IN_SNAPSHOT	256		// cgame's limit, the server prioritizes snapshots to fit it
+
 #define	PORT_ANY			-1
 
 #define	MAX_RELIABLE_COMMANDS	64			// max string commands buffered for restransmit
@@ -787,6 +789,9 @@ qbool	FS_FileIsInPAK( const char* filename, int* pureChecksum, int* checksum );
 
 int		FS_Write( const void *buffer, int len, fileHandle_t f );
 
+FILE*	FS_FileForHandle( fileHandle_t f );
+// lets another thread write with plain stdio calls, the handle must not be used until it's done
+
 int		FS_Read2( void *buffer, int len, fileHandle_t f );
 int		FS_Read( void *buffer, int len, fileHandle_t f );
 // properly handles partial reads and reads from other dlls
@@ -809,6 +814,13 @@ void	FS_ForceFlush( fileHandle_t f );
 void	FS_FreeFile( void *buffer );
 // frees the memory returned by FS_ReadFile
 
+int		FS_ReadFileRO( const char *qpath, const void **buffer );
+// same as FS_ReadFile, but the data of stored pk3 entries isn't copied
+// the buffer is NOT guaranteed to have a trailing 0
+
+void	FS_FreeFileRO( const void *buffer );
+// releases the buffer returned by FS_ReadFileRO
+
 void	FS_WriteFile( const char *qpath, const void *buffer, int size );
 // writes a complete file, creating any subdirectories needed
 
@@ -857,6 +869,10 @@ void FS_PureServerSetLoadedPaks( const char *pakSums );
 // sole exception of .cfg files.
 
 qbool FS_CheckDirTraversal(const char *checkdir);
+qbool FS_IsGameDirAllowed( const char* gamedir );
+// qfalse for traversal and for anything that could reach FS_VM_CACHE_DIR
+
+#define FS_VM_CACHE_DIR	"vmcache"	// in the home path, no gamedir can write to it
 qbool FS_idPak( const char* pak, const char* base );
 qbool FS_ComparePaks( char *neededpaks, int len, qbool dlstring );
 void FS_MissingPaks( unsigned int* checksums, int* checksumCount, int maxChecksums );
@@ -975,8 +991,12 @@ void		Com_BeginRedirect (char *buffer, int buffersize, void (*flush)(char *));
 void		Com_EndRedirect( void );
 void		QDECL Com_DPrintf( PRINTF_FORMAT_STRING const char *fmt, ... );
 void		Com_Quit( int status );
+// records or verifies the checksum of an outgoing packet when journaling
+// returns qfalse if the packet must not be sent
+qbool		Com_JournalPacket( netsrc_t sock, int length, const void* data );
 int			Com_EventLoop();
 int			Com_Milliseconds();	// will be journaled properly
+int			Com_NetworkMilliseconds();	// for pings and rate limits, journaled without pumping events
 unsigned	Com_BlockChecksum( const void *buffer, int length );
 char		*Com_MD5File(const char *filename, int length);
 int			Com_HashKey(char *string, int maxlen);
@@ -1015,6 +1035,7 @@ extern	cvar_t	*sv_packetdelay;
 
 // com_speeds times
 extern	int		time_game;
+extern	int64_t	time_gameUS;
 extern	int		time_frontend;
 extern	int		time_backend;		// renderer backend time
 
@@ -1091,6 +1112,11 @@ int Hunk_MemoryRemaining();
 template <class T> T* H_New( ha_pref heap ) { return (T*)Hunk_Alloc(sizeof(T), heap); }
 template <class T> T* H_New( int c, ha_pref heap ) { return static_cast<T*>(Hunk_Alloc(sizeof(T) * c, heap)); }
 
+// read-only data shared by all processes on the host asking for the same name (com_sharedMapData)
+// build fills the data when this process is the first one, the result stays valid until Hunk_Clear
+// returns NULL when sharing is off or failed, the caller then keeps a private copy
+const void* Com_SharedData( const char* name, int size, void (*build)( void* data, void* context ), void* context );
+
 void Com_TouchMemory();
 
 // commandLine should not include the executable name (argv[0])
@@ -1297,6 +1323,45 @@ void	Sys_ShowIP();
 
 void		Sys_Mkdir( const char* path );
 const char* Sys_Cwd();
+
+// read-only view of a whole file, NULL on failure
+const void*	Sys_MapFileRead( const char* path, int* size );
+void		Sys_UnmapFile( const void* data, int size );
+
+// calls func( data, i ) for every i in [0, count) from up to maxThreads threads (0 = one per core)
+// and returns once all calls are done, func must not touch the zone, the hunk or the console
+void		Sys_ParallelFor( int count, int maxThreads, void (*func)( void* data, int index ), void* data );
+
+// runs func( data ) on a new thread, NULL if it couldn't be started
+// func has the same restrictions as with Sys_ParallelFor, every started thread must be joined once
+void*		Sys_StartThread( void (*func)( void* data ), void* data );
+void		Sys_JoinThread( void* thread );
+
+// auto-reset events: a signal wakes up one waiter or the next one to wait, NULL on failure
+// they're created and destroyed on the main thread
+void*		Sys_CreateEvent();
+void		Sys_DestroyEvent( void* event );
+void		Sys_SignalEvent( void* event );
+void		Sys_WaitEvent( void* event );
+
+// named shared memory segments, names start with a slash and contain no other
+// Create returns NULL if the segment already exists, Open returns NULL if it doesn't,
+// has a different size or belongs to another user
+void*		Sys_CreateSharedMemory( const char* name, int size );
+const void*	Sys_OpenSharedMemory( const char* name, int size );
+void		Sys_SealSharedMemory( void* data, int size );		// makes the creator's view read-only
+void		Sys_CloseSharedMemory( const void* data, int size );
+void		Sys_RemoveSharedMemory( const char* name );		// the name becomes available again
+int			Sys_SharedMemoryAge( const char* name );		// seconds since the last change, -1 if unknown
+int			Sys_RemoveAllSharedMemory( const char* prefix );	// the user's segments, returns how many
+void		Sys_MemoryBarrier();
+int			Sys_GetProcessID();
+qbool		Sys_IsProcessAlive( int pid );
+
+// zero-filled memory for the hunk and the zone, never freed
+// hugePages: 0 = regular allocation, 1 = pre-faulted transparent huge pages, 2 = try MAP_HUGETLB first
+// description tells what was actually obtained
+void*		Sys_AllocLargeMemory( int size, int hugePages, const char** description );
 const char* Sys_DefaultHomePath();
 
 char**	Sys_ListFiles( const char *directory, const char *extension, const char *filter, int *numfiles, qbool wantsubs );
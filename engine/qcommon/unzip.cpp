@@ -1950,6 +1950,47 @@ extern int unzOpenCurrentFile (unzFile file)
 }
 
 
+/*
+  Read and inflate the whole current file in one go.
+  The compressed data goes to temporary hunk memory, so this is only tried
+  when there is enough of it left; the caller streams the file otherwise.
+  return UNZ_OK with the file state moved to the end of the file
+*/
+static int unzlocal_ReadWholeCurrentFile (unz_s* s, file_in_zip_read_info_s* pfile_in_zip_read_info, void *buf)
+{
+	const uLong compressed = pfile_in_zip_read_info->rest_read_compressed;
+	const uLong uncompressed = pfile_in_zip_read_info->rest_read_uncompressed;
+	void *src;
+	int err;
+
+	if (compressed == 0 || compressed > 0x7FFFFFFF ||
+		(uLong)Hunk_MemoryRemaining() < compressed + 1024)
+		return UNZ_INTERNALERROR;
+
+	if (fseek(pfile_in_zip_read_info->file,
+			  pfile_in_zip_read_info->pos_in_zipfile +
+				 pfile_in_zip_read_info->byte_before_the_zipfile,SEEK_SET)!=0)
+		return UNZ_ERRNO;
+
+	src = Hunk_AllocateTempMemory((int)compressed);
+	if (fread(src,(uInt)compressed,1,pfile_in_zip_read_info->file)!=1)
+		err = UNZ_ERRNO;
+	else
+		err = unzInflateMemory(src,compressed,buf,uncompressed);
+	Hunk_FreeTempMemory(src);
+
+	if (err != UNZ_OK)
+		return err;
+
+	pfile_in_zip_read_info->pos_in_zipfile += compressed;
+	pfile_in_zip_read_info->rest_read_compressed = 0;
+	pfile_in_zip_read_info->rest_read_uncompressed = 0;
+	pfile_in_zip_read_info->stream.total_out += uncompressed;
+
+	return UNZ_OK;
+}
+
+
 /*
   Read bytes from the current file.
   buf contain buffer where data must be copied
@@ -1980,6 +2021,18 @@ extern int unzReadCurrentFile  (unzFile file, void *buf, unsigned len)
 	if (len==0)
 		return 0;
 
+	/* reading a whole deflated file at once: skip the streaming decoder */
+	if ((pfile_in_zip_read_info->compression_method==Z_DEFLATED) &&
+		(pfile_in_zip_read_info->stream.total_out==0) &&
+		(pfile_in_zip_read_info->rest_read_compressed==s->cur_file_info.compressed_size) &&
+		(len>=pfile_in_zip_read_info->rest_read_uncompressed) &&
+		(pfile_in_zip_read_info->rest_read_uncompressed<=0x7FFFFFFF))
+	{
+		const uLong uncompressed = pfile_in_zip_read_info->rest_read_uncompressed;
+		if (unzlocal_ReadWholeCurrentFile(s,pfile_in_zip_read_info,buf)==UNZ_OK)
+			return (int)uncompressed;
+	}
+
 	pfile_in_zip_read_info->stream.next_out = (Byte*)buf;
 
 	pfile_in_zip_read_info->stream.avail_out = (uInt)len;
@@ -2216,6 +2269,694 @@ extern int unzCloseCurrentFile (unzFile file)
 }
 
 
+/*
+  Single-shot inflate.
+
+  The embedded zlib decoder above walks its state machine for every code and
+  copies through the sliding window. When the whole compressed stream is in
+  memory and the uncompressed size is known (always the case for zip entries),
+  the output buffer is the window and the decoder can be much simpler:
+  - a 64-bit bit buffer refilled 8 bytes at a time
+  - Huffman tables indexed by the next FI_LITLEN_BITS bits, with a second level
+    for the longer codes
+  - two literals per lookup when both codes fit in the first level
+*/
+
+#define FI_LITLEN_BITS		11
+#define FI_DIST_BITS		8
+#define FI_PRECODE_BITS		7
+#define FI_MAX_CODELEN		15
+
+/* first level plus the worst case for the second level (one table per symbol) */
+#define FI_LITLEN_ENOUGH	((1 << FI_LITLEN_BITS) + 288 * (1 << (FI_MAX_CODELEN - FI_LITLEN_BITS)))
+#define FI_DIST_ENOUGH		((1 << FI_DIST_BITS) + 32 * (1 << (FI_MAX_CODELEN - FI_DIST_BITS)))
+
+/* table entry layout:
+   bits  0.. 4  number of bits to consume
+   bits  5.. 7  entry type
+   bits  8..12  extra bits / second level bits
+   bits 16..31  symbol data */
+#define FI_TYPE_LITERAL		(1 << 5)
+#define FI_TYPE_LITERAL2	(2 << 5)
+#define FI_TYPE_LENGTH		(3 << 5)
+#define FI_TYPE_END			(4 << 5)
+#define FI_TYPE_SUBTABLE	(5 << 5)
+#define FI_TYPE_INVALID		(6 << 5)
+#define FI_TYPE_MASK		(7 << 5)
+
+#define FI_ENTRY(bits, type, extra, data)	((unsigned int)(bits) | (unsigned int)(type) | ((unsigned int)(extra) << 8) | ((unsigned int)(data) << 16))
+#define FI_BITS(e)		((e) & 31)
+#define FI_EXTRA(e)		(((e) >> 8) & 31)
+#define FI_DATA(e)		((e) >> 16)
+
+typedef struct
+{
+	unsigned int litlen[FI_LITLEN_ENOUGH];
+	unsigned int dist[FI_DIST_ENOUGH];
+	unsigned int precode[1 << FI_PRECODE_BITS];
+} fastInflateTables_t;
+
+static const unsigned short fi_lengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char fi_lengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short fi_distBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char fi_distExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const unsigned char fi_precodeOrder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+
+/* the entry a symbol decodes to, without the code length */
+static unsigned int fi_SymbolEntry (int sym, int kind)
+{
+	if (kind == 0)			/* precode */
+		return FI_ENTRY(0, FI_TYPE_LITERAL, 0, sym);
+	if (kind == 1)			/* literal/length */
+	{
+		if (sym < 256)
+			return FI_ENTRY(0, FI_TYPE_LITERAL, 0, sym);
+		if (sym == 256)
+			return FI_ENTRY(0, FI_TYPE_END, 0, 0);
+		if (sym < 286)
+			return FI_ENTRY(0, FI_TYPE_LENGTH, fi_lengthExtra[sym - 257], fi_lengthBase[sym - 257]);
+		return FI_ENTRY(0, FI_TYPE_INVALID, 0, 0);
+	}
+	if (sym < 30)			/* distance */
+		return FI_ENTRY(0, FI_TYPE_LENGTH, fi_distExtra[sym], fi_distBase[sym]);
+	return FI_ENTRY(0, FI_TYPE_INVALID, 0, 0);
+}
+
+
+static unsigned int fi_ReverseBits (unsigned int code, int len)
+{
+	code = ((code & 0x5555) << 1) | ((code >> 1) & 0x5555);
+	code = ((code & 0x3333) << 2) | ((code >> 2) & 0x3333);
+	code = ((code & 0x0F0F) << 4) | ((code >> 4) & 0x0F0F);
+	code = ((code & 0x00FF) << 8) | ((code >> 8) & 0x00FF);
+	return code >> (16 - len);
+}
+
+
+/*
+  Builds a two-level decoding table from the code lengths.
+  Incomplete codes are allowed (the unused entries decode as invalid),
+  over-subscribed ones are not.
+  return 0 on failure
+*/
+static int fi_BuildTable (unsigned int *table, int tableBits, int tableSize,
+						  const unsigned char *lens, int numSyms, int kind)
+{
+	int count[FI_MAX_CODELEN + 1];
+	int offset[FI_MAX_CODELEN + 2];
+	unsigned short sorted[288];
+	unsigned char subBits[1 << FI_LITLEN_BITS];
+	const unsigned int invalid = FI_ENTRY(0, FI_TYPE_INVALID, 0, 0);
+	const int primarySize = 1 << tableBits;
+	int left, len, sym, i, n, used, longest;
+	unsigned int code, prefix, lastPrefix, subStart;
+
+	for (len = 0; len <= FI_MAX_CODELEN; len++)
+		count[len] = 0;
+	for (sym = 0; sym < numSyms; sym++)
+		count[lens[sym]]++;
+	count[0] = 0;
+
+	left = 1;
+	longest = 0;
+	for (len = 1; len <= FI_MAX_CODELEN; len++)
+	{
+		left <<= 1;
+		left -= count[len];
+		if (left < 0)
+			return 0;
+		if (count[len] != 0)
+			longest = len;
+	}
+
+	/* canonical order: by length, then by symbol */
+	offset[1] = 0;
+	for (len = 1; len <= FI_MAX_CODELEN; len++)
+		offset[len + 1] = offset[len] + count[len];
+	for (sym = 0; sym < numSyms; sym++)
+		if (lens[sym] != 0)
+			sorted[offset[lens[sym]]++] = (unsigned short)sym;
+
+	/* a complete code covers every entry */
+	if (left != 0)
+		for (i = 0; i < primarySize; i++)
+			table[i] = invalid;
+
+	/* canonical codes left-aligned are increasing, so the codes sharing
+	   a first level entry are consecutive and the last one is the longest */
+	if (longest > tableBits)
+	{
+		code = 0;
+		i = 0;
+		for (len = 1; len <= longest; len++, code <<= 1)
+			for (n = 0; n < count[len]; n++, i++, code++)
+				if (len > tableBits)
+					subBits[fi_ReverseBits(code >> (len - tableBits), tableBits)] = (unsigned char)(len - tableBits);
+	}
+
+	used = primarySize;
+	lastPrefix = (unsigned int)primarySize;
+	subStart = 0;
+	code = 0;
+	i = 0;
+	for (len = 1; len <= longest; len++, code <<= 1)
+	{
+		for (n = 0; n < count[len]; n++, i++, code++)
+		{
+			const unsigned int rev = fi_ReverseBits(code, len);
+			const unsigned int entry = fi_SymbolEntry(sorted[i], kind);
+			unsigned int step, at, subSize;
+
+			if (len <= tableBits)
+			{
+				/* replicated over the unused high bits */
+				step = 1u << len;
+				for (at = rev; at < (unsigned int)primarySize; at += step)
+					table[at] = entry | (unsigned int)len;
+				continue;
+			}
+
+			prefix = rev & (primarySize - 1);
+			subSize = 1u << subBits[prefix];
+			if (prefix != lastPrefix)
+			{
+				if (used + (int)subSize > tableSize)
+					return 0;
+				lastPrefix = prefix;
+				subStart = (unsigned int)used;
+				table[prefix] = FI_ENTRY(tableBits, FI_TYPE_SUBTABLE, subBits[prefix], used);
+				if (left != 0)
+					for (at = 0; at < subSize; at++)
+						table[used + at] = invalid;
+				used += subSize;
+			}
+			step = 1u << (len - tableBits);
+			for (at = rev >> tableBits; at < subSize; at += step)
+				table[subStart + at] = entry | (unsigned int)(len - tableBits);
+		}
+	}
+
+	/* pair up literals whose codes fit in the first level together;
+	   going down keeps the entries read by the lookup below unmodified */
+	if (kind == 1)
+	{
+		for (i = primarySize - 1; i >= 0; i--)
+		{
+			const unsigned int e1 = table[i];
+			unsigned int e2;
+			int bits1;
+			if ((e1 & FI_TYPE_MASK) != FI_TYPE_LITERAL)
+				continue;
+			bits1 = FI_BITS(e1);
+			if (bits1 >= tableBits)
+				continue;
+			e2 = table[i >> bits1];
+			if ((e2 & FI_TYPE_MASK) != FI_TYPE_LITERAL || FI_BITS(e2) > tableBits - bits1)
+				continue;
+			table[i] = FI_ENTRY(bits1 + FI_BITS(e2), FI_TYPE_LITERAL2, 0,
+								FI_DATA(e1) | (FI_DATA(e2) << 8));
+		}
+	}
+
+	return 1;
+}
+
+
+typedef struct
+{
+	const Byte *in;
+	const Byte *inEnd;
+	uint64_t bitbuf;
+	int bitsleft;
+	int overrun;		/* zero bytes read past the end of the input */
+} fastInflateBits_t;
+
+/* makes sure there are at least 56 bits in the buffer */
+static ID_INLINE void fi_Refill (fastInflateBits_t *b)
+{
+#if defined(Q3_LITTLE_ENDIAN)
+	if (b->inEnd - b->in >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, b->in, 8);
+		/* the bits above bitsleft are the same input bytes, or-ing them again is harmless */
+		b->bitbuf |= word << b->bitsleft;
+		b->in += (63 - b->bitsleft) >> 3;
+		b->bitsleft |= 56;
+		return;
+	}
+#endif
+	while (b->bitsleft <= 56)
+	{
+		if (b->in < b->inEnd)
+			b->bitbuf |= (uint64_t)*b->in++ << b->bitsleft;
+		else
+			b->overrun++;
+		b->bitsleft += 8;
+	}
+}
+
+static ID_INLINE unsigned int fi_Bits (fastInflateBits_t *b, int n)
+{
+	const unsigned int v = (unsigned int)b->bitbuf & ((1u << n) - 1);
+	b->bitbuf >>= n;
+	b->bitsleft -= n;
+	return v;
+}
+
+static ID_INLINE unsigned int fi_Decode (fastInflateBits_t *b, const unsigned int *table, int tableBits)
+{
+	unsigned int e = table[b->bitbuf & ((1u << tableBits) - 1)];
+	if ((e & FI_TYPE_MASK) == FI_TYPE_SUBTABLE)
+	{
+		b->bitbuf >>= tableBits;
+		b->bitsleft -= tableBits;
+		e = table[FI_DATA(e) + (b->bitbuf & ((1u << FI_EXTRA(e)) - 1))];
+	}
+	b->bitbuf >>= FI_BITS(e);
+	b->bitsleft -= FI_BITS(e);
+	return e;
+}
+
+
+static int fi_ReadDynamicTables (fastInflateBits_t *b, fastInflateTables_t *t)
+{
+	unsigned char lens[288 + 32];
+	unsigned char precodeLens[19];
+	int numLitlen, numDist, numPrecode, i;
+
+	fi_Refill(b);
+	numLitlen = 257 + (int)fi_Bits(b, 5);
+	numDist = 1 + (int)fi_Bits(b, 5);
+	numPrecode = 4 + (int)fi_Bits(b, 4);
+	if (numLitlen > 286 || numDist > 30)
+		return 0;
+
+	for (i = 0; i < 19; i++)
+		precodeLens[i] = 0;
+	for (i = 0; i < numPrecode; i++)
+	{
+		fi_Refill(b);
+		precodeLens[fi_precodeOrder[i]] = (unsigned char)fi_Bits(b, 3);
+	}
+	if (!fi_BuildTable(t->precode, FI_PRECODE_BITS, 1 << FI_PRECODE_BITS, precodeLens, 19, 0))
+		return 0;
+
+	i = 0;
+	while (i < numLitlen + numDist)
+	{
+		unsigned int e, sym;
+		int repeat;
+		unsigned char value;
+
+		fi_Refill(b);
+		e = fi_Decode(b, t->precode, FI_PRECODE_BITS);
+		if ((e & FI_TYPE_MASK) != FI_TYPE_LITERAL)
+			return 0;
+		sym = FI_DATA(e);
+		if (sym < 16)
+		{
+			lens[i++] = (unsigned char)sym;
+			continue;
+		}
+		if (sym == 16)
+		{
+			if (i == 0)
+				return 0;
+			value = lens[i - 1];
+			repeat = 3 + (int)fi_Bits(b, 2);
+		}
+		else if (sym == 17)
+		{
+			value = 0;
+			repeat = 3 + (int)fi_Bits(b, 3);
+		}
+		else
+		{
+			value = 0;
+			repeat = 11 + (int)fi_Bits(b, 7);
+		}
+		if (i + repeat > numLitlen + numDist)
+			return 0;
+		while (repeat-- > 0)
+			lens[i++] = value;
+	}
+
+	if (lens[256] == 0)
+		return 0;
+
+	if (!fi_BuildTable(t->litlen, FI_LITLEN_BITS, FI_LITLEN_ENOUGH, lens, numLitlen, 1))
+		return 0;
+	if (!fi_BuildTable(t->dist, FI_DIST_BITS, FI_DIST_ENOUGH, lens + numLitlen, numDist, 2))
+		return 0;
+
+	return 1;
+}
+
+
+static int fi_BuildFixedTables (fastInflateTables_t *t)
+{
+	unsigned char lens[288 + 32];
+	int i;
+
+	for (i = 0; i < 144; i++)
+		lens[i] = 8;
+	for (; i < 256; i++)
+		lens[i] = 9;
+	for (; i < 280; i++)
+		lens[i] = 7;
+	for (; i < 288; i++)
+		lens[i] = 8;
+	for (i = 0; i < 32; i++)
+		lens[288 + i] = 5;
+
+	return fi_BuildTable(t->litlen, FI_LITLEN_BITS, FI_LITLEN_ENOUGH, lens, 288, 1) &&
+		   fi_BuildTable(t->dist, FI_DIST_BITS, FI_DIST_ENOUGH, lens + 288, 32, 2);
+}
+
+
+/* the block decoder keeps the bit reader in locals */
+#if defined(Q3_LITTLE_ENDIAN)
+#define FI_REFILL_WORD() \
+	if (inEnd - in >= 8) \
+	{ \
+		uint64_t word; \
+		memcpy(&word, in, 8); \
+		bitbuf |= word << bitsleft; \
+		in += (63 - bitsleft) >> 3; \
+		bitsleft |= 56; \
+	} \
+	else
+#else
+#define FI_REFILL_WORD()
+#endif
+
+#define FI_REFILL() \
+	do \
+	{ \
+		FI_REFILL_WORD() \
+		while (bitsleft <= 56) \
+		{ \
+			if (in < inEnd) \
+				bitbuf |= (uint64_t)*in++ << bitsleft; \
+			else \
+				overrun++; \
+			bitsleft += 8; \
+		} \
+	} while (0)
+
+#define FI_CONSUME(n) \
+	do \
+	{ \
+		bitbuf >>= (n); \
+		bitsleft -= (n); \
+	} while (0)
+
+#define FI_PEEK(n)	((unsigned int)bitbuf & ((1u << (n)) - 1))
+
+
+/* decodes the symbols of a Huffman block until the end of block code */
+static int fi_InflateBlock (fastInflateBits_t *b, const fastInflateTables_t *t,
+							Byte *dst, Byte **outp, Byte *outEnd)
+{
+	const unsigned int *const litlen = t->litlen;
+	const unsigned int *const distance = t->dist;
+	const Byte *in = b->in;
+	const Byte *const inEnd = b->inEnd;
+	uint64_t bitbuf = b->bitbuf;
+	int bitsleft = b->bitsleft;
+	int overrun = b->overrun;
+	Byte *out = *outp;
+	int ok = 0;
+
+	for (;;)
+	{
+		unsigned int e, length, dist;
+		const Byte *from;
+
+		/* 15 bits of length code + 5 extra bits + 15 bits of distance code
+		   + 13 extra bits all fit in the 56 bits after the refill */
+		FI_REFILL();
+		e = litlen[FI_PEEK(FI_LITLEN_BITS)];
+		if ((e & FI_TYPE_MASK) == FI_TYPE_SUBTABLE)
+		{
+			FI_CONSUME(FI_LITLEN_BITS);
+			e = litlen[FI_DATA(e) + FI_PEEK(FI_EXTRA(e))];
+		}
+		FI_CONSUME(FI_BITS(e));
+
+		if ((e & FI_TYPE_MASK) <= FI_TYPE_LITERAL2)
+		{
+			/* both codes are in the stream, so no room for both is an overflow */
+			if ((e & FI_TYPE_MASK) == FI_TYPE_LITERAL2)
+			{
+				if (outEnd - out < 2)
+					break;
+				out[0] = (Byte)FI_DATA(e);
+				out[1] = (Byte)(FI_DATA(e) >> 8);
+				out += 2;
+			}
+			else
+			{
+				if (out >= outEnd)
+					break;
+				*out++ = (Byte)FI_DATA(e);
+			}
+
+			/* literals come in runs: decode another one without refilling
+			   when its first level entry is enough */
+			if (bitsleft >= FI_LITLEN_BITS)
+			{
+				e = litlen[FI_PEEK(FI_LITLEN_BITS)];
+				if ((e & FI_TYPE_MASK) == FI_TYPE_LITERAL2 && outEnd - out >= 2)
+				{
+					FI_CONSUME(FI_BITS(e));
+					out[0] = (Byte)FI_DATA(e);
+					out[1] = (Byte)(FI_DATA(e) >> 8);
+					out += 2;
+				}
+				else if ((e & FI_TYPE_MASK) == FI_TYPE_LITERAL && out < outEnd)
+				{
+					FI_CONSUME(FI_BITS(e));
+					*out++ = (Byte)FI_DATA(e);
+				}
+			}
+			continue;
+		}
+
+		if ((e & FI_TYPE_MASK) != FI_TYPE_LENGTH)
+		{
+			ok = (e & FI_TYPE_MASK) == FI_TYPE_END;
+			break;
+		}
+
+		length = FI_DATA(e) + FI_PEEK(FI_EXTRA(e));
+		FI_CONSUME(FI_EXTRA(e));
+
+		e = distance[FI_PEEK(FI_DIST_BITS)];
+		if ((e & FI_TYPE_MASK) == FI_TYPE_SUBTABLE)
+		{
+			FI_CONSUME(FI_DIST_BITS);
+			e = distance[FI_DATA(e) + FI_PEEK(FI_EXTRA(e))];
+		}
+		FI_CONSUME(FI_BITS(e));
+		if ((e & FI_TYPE_MASK) != FI_TYPE_LENGTH)
+			break;
+		dist = FI_DATA(e) + FI_PEEK(FI_EXTRA(e));
+		FI_CONSUME(FI_EXTRA(e));
+
+		if (dist > (unsigned int)(out - dst) || length > (unsigned int)(outEnd - out))
+			break;
+
+		from = out - dist;
+		if (dist >= 8 && outEnd - out >= (int)length + 8)
+		{
+			/* 8 bytes at a time, may write up to 7 bytes past the match */
+			Byte *const end = out + length;
+			do
+			{
+				memcpy(out, from, 8);
+				out += 8;
+				from += 8;
+			} while (out < end);
+			out = end;
+		}
+		else if (dist == 1)
+		{
+			memset(out, *from, length);
+			out += length;
+		}
+		else
+		{
+			while (length-- > 0)
+				*out++ = *from++;
+		}
+	}
+
+	b->in = in;
+	b->bitbuf = bitbuf;
+	b->bitsleft = bitsleft;
+	b->overrun = overrun;
+	*outp = out;
+
+	return ok;
+}
+
+
+static int fi_Inflate (const Byte *src, uLong srcLength, Byte *dst, uLong dstLength,
+					   fastInflateTables_t *t)
+{
+	fastInflateBits_t b;
+	Byte *out = dst;
+	Byte *const outEnd = dst + dstLength;
+	int final, type, fixedTables = 0;
+
+	b.in = src;
+	b.inEnd = src + srcLength;
+	b.bitbuf = 0;
+	b.bitsleft = 0;
+	b.overrun = 0;
+
+	do
+	{
+		fi_Refill(&b);
+		final = (int)fi_Bits(&b, 1);
+		type = (int)fi_Bits(&b, 2);
+
+		if (type == 0)
+		{
+			unsigned int length, nlength;
+			int held;
+
+			/* go back to the byte boundary and give the buffered bytes back */
+			fi_Bits(&b, b.bitsleft & 7);
+			held = (b.bitsleft >> 3) - b.overrun;
+			if (held < 0)
+				return 0;
+			b.in -= held;
+			b.bitbuf = 0;
+			b.bitsleft = 0;
+			b.overrun = 0;
+
+			if (b.inEnd - b.in < 4)
+				return 0;
+			length = (unsigned int)b.in[0] | ((unsigned int)b.in[1] << 8);
+			nlength = (unsigned int)b.in[2] | ((unsigned int)b.in[3] << 8);
+			b.in += 4;
+			if (length != (~nlength & 0xFFFF) ||
+				(uLong)(b.inEnd - b.in) < length || (uLong)(outEnd - out) < length)
+				return 0;
+			memcpy(out, b.in, length);
+			b.in += length;
+			out += length;
+		}
+		else if (type == 1)
+		{
+			if (!fixedTables && !fi_BuildFixedTables(t))
+				return 0;
+			fixedTables = 1;
+			if (!fi_InflateBlock(&b, t, dst, &out, outEnd))
+				return 0;
+		}
+		else if (type == 2)
+		{
+			fixedTables = 0;
+			if (!fi_ReadDynamicTables(&b, t) ||
+				!fi_InflateBlock(&b, t, dst, &out, outEnd))
+				return 0;
+		}
+		else
+		{
+			return 0;
+		}
+	} while (!final);
+
+	/* none of the zero bytes past the end of the input may have been used */
+	if (b.overrun > (b.bitsleft >> 3))
+		return 0;
+
+	return out == outEnd;
+}
+
+
+/*
+  Inflate a whole raw deflate stream that is already in memory.
+  The caller knows the exact uncompressed size from the central directory.
+  return UNZ_OK if exactly dstLength bytes were produced
+*/
+extern int unzInflateMemory (const void *src, uLong srcLength, void *dst, uLong dstLength)
+{
+	fastInflateTables_t *tables;
+	int ok;
+
+	if (src==NULL || dst==NULL)
+		return UNZ_PARAMERROR;
+
+	tables = (fastInflateTables_t*)ALLOC(sizeof(fastInflateTables_t));
+	if (tables==NULL)
+		return UNZ_INTERNALERROR;
+
+	ok = fi_Inflate((const Byte*)src, srcLength, (Byte*)dst, dstLength, tables);
+	TRYFREE(tables);
+
+	return ok ? UNZ_OK : UNZ_BADZIPFILE;
+}
+
+
+/*
+  Same as unzInflateMemory, but with the embedded zlib decoder.
+*/
+extern int unzInflateMemoryZlib (const void *src, uLong srcLength, void *dst, uLong dstLength)
+{
+	z_stream stream;
+	int err;
+
+	if (src==NULL || dst==NULL)
+		return UNZ_PARAMERROR;
+
+	Com_Memset(&stream, 0, sizeof(stream));
+	stream.zalloc = (alloc_func)0;
+	stream.zfree = (free_func)0;
+	stream.opaque = (voidp)0;
+	stream.next_in = (Byte*)src;
+	stream.avail_in = (uInt)srcLength;
+	stream.next_out = (Byte*)dst;
+	stream.avail_out = (uInt)dstLength;
+
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return UNZ_INTERNALERROR;
+
+	/* like unzReadCurrentFile, don't insist on Z_STREAM_END: the raw stream
+	   has no trailing dummy byte, but the output size is known */
+	err = inflate(&stream, Z_SYNC_FLUSH);
+	if (err == Z_OK && stream.total_out == dstLength)
+	{
+		/* the output is full: make sure the stream doesn't have more */
+		Byte extra;
+		stream.next_out = &extra;
+		stream.avail_out = 1;
+		err = inflate(&stream, Z_SYNC_FLUSH);
+	}
+	inflateEnd(&stream);
+
+	if ((err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) ||
+		stream.total_out != dstLength)
+		return UNZ_BADZIPFILE;
+
+	return UNZ_OK;
+}
+
+
 /*
   Get the global comment string of the ZipFile, in the szComment buffer.
   uSizeBuf is the size of the szComment buffer.
@@ -334,3 +334,22 @@ extern int unzGetLocalExtrafield (unzFile file, void* buf, unsigned len);
   the return value is the number of unsigned chars copied in buf, or (if <0) 
 	the error code
 */
+
+extern int unzInflateMemory (const void* src, unsigned long srcLength, void* dst, unsigned long dstLength);
+
+/*
+  Inflate a raw deflate stream (a pk3 entry with compression method 8) that
+  is already in memory, e.g. read straight out of a mapped zip file.
+  dstLength must be the exact uncompressed size.
+  This uses a single-shot table-driven decoder, which is also what
+  unzReadCurrentFile uses when a whole deflated file is read at once.
+
+  return UNZ_OK if exactly dstLength unsigned chars were produced
+*/
+
+extern int unzInflateMemoryZlib (const void* src, unsigned long srcLength, void* dst, unsigned long dstLength);
+
+/*
+  Same as unzInflateMemory, but with the embedded zlib decoder.
+  Only meant for validating and benchmarking the fast decoder.
+*/
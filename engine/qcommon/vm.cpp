@@ -137,6 +137,13 @@ static const cvarTableItem_t vm_cvars[] =
 };
 #endif
 
+cvar_t	*vm_codeCache;
+
+static const cvarTableItem_t vm_cache_cvars[] =
+{
+	{ &vm_codeCache, "vm_codeCache", "0", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, "caches the JIT-compiled QVM code in the home path's " FS_VM_CACHE_DIR " folder" }
+};
+
 /*
 ==============
 VM_Init
@@ -146,6 +153,7 @@ void VM_Init( void ) {
 #if !defined( QC )
 	Cvar_RegisterArray( vm_cvars, MODULE_COMMON );
 #endif
+	Cvar_RegisterArray( vm_cache_cvars, MODULE_COMMON );
 
 	Com_Memset( vmTable, 0, sizeof( vmTable ) );
 }
@@ -179,91 +187,209 @@ static int ParseHex( const char* text )
 	return value;
 }
 
+/*
+===============
+VM_ParseSymbol
+
+reads the next code segment symbol of a .map file
+===============
+*/
+static qbool VM_ParseSymbol( const char **text_p, int *value, const char **name )
+{
+	while ( 1 ) {
+		const char* token = COM_Parse( text_p );
+		if ( !token[0] ) {
+			return qfalse;
+		}
+
+		const int segment = ParseHex( token );
+		if ( segment ) {
+			COM_Parse( text_p );
+			COM_Parse( text_p );
+			continue;		// only load code segment values
+		}
+
+		token = COM_Parse( text_p );
+		if ( !token[0] ) {
+			Com_Printf( "WARNING: incomplete line at end of file\n" );
+			return qfalse;
+		}
+		*value = ParseHex( token );
+
+		token = COM_Parse( text_p );
+		if ( !token[0] ) {
+			Com_Printf( "WARNING: incomplete line at end of file\n" );
+			return qfalse;
+		}
+		*name = token;
+
+		return qtrue;
+	}
+}
+
+
+static int VM_CompareSymbols( const void *a, const void *b )
+{
+	const vmSymbol_t* const sa = (const vmSymbol_t*)a;
+	const vmSymbol_t* const sb = (const vmSymbol_t*)b;
+
+	if ( sa->symValue != sb->symValue )
+		return sa->symValue < sb->symValue ? -1 : 1;
+
+	// keep the order of the .map file for aliases
+	return sa < sb ? -1 : ( sa > sb ? 1 : 0 );
+}
+
+
 /*
 ===============
 VM_LoadSymbols
+
+parses the .map file into a single block: the symbols sorted by value, then their names.
+only called on the first lookup since most runs never need the symbols
 ===============
 */
-void VM_LoadSymbols( vm_t *vm ) {
-	union {
-		char	*c;
-		void	*v;
-	}			mapfile;
-	const char	*text_p;
-	const char	*token;
+static void VM_LoadSymbols( vm_t *vm ) {
 	char		name[MAX_QPATH];
 	char		symbols[MAX_QPATH];
-	vmSymbol_t	**prev, *sym;
-	int			count;
+	const char	*text_p;
+	const char	*token;
+	void		*mapfile;
 	int			value;
-	int			chars;
-	int			segment;
-	int			numInstructions;
+	int			count, namesLength;
 
-	// don't load symbols if not developer
-	if ( !com_developer->integer ) {
+	if ( vm->symbolsLoaded ) {
 		return;
 	}
+	vm->symbolsLoaded = qtrue;
 
 	COM_StripExtension(vm->name, name, sizeof(name));
 	Com_sprintf( symbols, sizeof( symbols ), "vm/%s.map", name );
-	FS_ReadFile( symbols, &mapfile.v );
-	if ( !mapfile.c ) {
+	FS_ReadFile( symbols, &mapfile );
+	if ( !mapfile ) {
 		Com_Printf( "Couldn't load symbol file: %s\n", symbols );
 		return;
 	}
 
-	numInstructions = vm->instructionCount;
+	// size everything up
+	count = 0;
+	namesLength = 0;
+	text_p = (const char*)mapfile;
+	while ( VM_ParseSymbol( &text_p, &value, &token ) ) {
+		count++;
+		namesLength += strlen( token ) + 1;
+	}
+
+	vmSymbol_t* const table = (vmSymbol_t*)Z_Malloc( count * sizeof( vmSymbol_t ) + namesLength );
+	char* names = (char*)( table + count );
 
 	// parse the symbols
-	text_p = mapfile.c;
-	prev = &vm->symbols;
-	count = 0;
+	vmSymbol_t* sym = table;
+	text_p = (const char*)mapfile;
+	while ( sym < table + count && VM_ParseSymbol( &text_p, &value, &token ) ) {
+		const int chars = strlen( token ) + 1;
+		Com_Memcpy( names, token, chars );
+		sym->symValue = value;
+		sym->profileCount = 0;
+		sym->symName = names;
+		names += chars;
+		sym++;
+	}
 
-	while ( 1 ) {
-		token = COM_Parse( &text_p );
-		if ( !token[0] ) {
-			break;
-		}
-		segment = ParseHex( token );
-		if ( segment ) {
-			COM_Parse( &text_p );
-			COM_Parse( &text_p );
-			continue;		// only load code segment values
-		}
+	qsort( table, count, sizeof( vmSymbol_t ), VM_CompareSymbols );
 
-		token = COM_Parse( &text_p );
-		if ( !token[0] ) {
-			Com_Printf( "WARNING: incomplete line at end of file\n" );
-			break;
-		}
-		value = ParseHex( token );
+	vm->symbols = table;
+	vm->numSymbols = count;
+	Com_Printf( "%i symbols parsed from %s\n", count, symbols );
+	FS_FreeFile( mapfile );
+}
 
-		token = COM_Parse( &text_p );
-		if ( !token[0] ) {
-			Com_Printf( "WARNING: incomplete line at end of file\n" );
-			break;
-		}
-		chars = strlen( token );
-		sym = (vmSymbol_t*)Hunk_Alloc( sizeof( *sym ) + chars, h_high );
-		*prev = sym;
-		prev = &sym->next;
-		sym->next = NULL;
-
-		// convert value from an instruction number to a code offset
-		if ( vm->instructionPointers && value >= 0 && value < numInstructions ) {
-			value = vm->instructionPointers[value];
-		}
 
-		sym->symValue = value;
-		Q_strncpyz( sym->symName, token, chars + 1 );
+/*
+===============
+VM_FindSymbol
 
-		count++;
+returns the symbol with the highest value <= value, if the symbols are loaded.
+doesn't allocate so the crash handler can use it
+===============
+*/
+const vmSymbol_t *VM_FindSymbol( const vm_t *vm, int value ) {
+	if ( !vm->symbols || vm->numSymbols <= 0 || value < vm->symbols[0].symValue ) {
+		return NULL;
 	}
 
-	vm->numSymbols = count;
-	Com_Printf( "%i symbols parsed from %s\n", count, symbols );
-	FS_FreeFile( mapfile.v );
+	int low = 0;
+	int high = vm->numSymbols - 1;
+	while ( low < high ) {
+		const int mid = ( low + high + 1 ) / 2;
+		if ( vm->symbols[mid].symValue <= value )
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	return &vm->symbols[low];
+}
+
+
+/*
+===============
+VM_ValueToFunctionSymbol
+===============
+*/
+const vmSymbol_t *VM_ValueToFunctionSymbol( vm_t *vm, int value ) {
+	VM_LoadSymbols( vm );
+
+	return VM_FindSymbol( vm, value );
+}
+
+
+/*
+===============
+VM_ValueToSymbol
+
+returns "function+offset" or the value itself if no symbol is found
+===============
+*/
+const char *VM_ValueToSymbol( vm_t *vm, int value ) {
+	static char text[MAX_TOKEN_CHARS];
+
+	const vmSymbol_t* const sym = VM_ValueToFunctionSymbol( vm, value );
+	if ( !sym ) {
+		Com_sprintf( text, sizeof( text ), "%i", value );
+		return text;
+	}
+
+	if ( sym->symValue == value ) {
+		return sym->symName;
+	}
+
+	Com_sprintf( text, sizeof( text ), "%s+%i", sym->symName, value - sym->symValue );
+	return text;
+}
+
+
+/*
+===============
+VM_PrintCallStack
+
+prints the function call stack of the VM with the names from its .map file
+===============
+*/
+void VM_PrintCallStack( vm_t *vm ) {
+	if ( !vm ) {
+		return;
+	}
+
+	const int depth = min( vm->callStackDepth, MAX_VM_CALL_STACK_DEPTH );
+	if ( depth <= 0 ) {
+		return;
+	}
+
+	Com_Printf( "%s call stack:\n", vm->name );
+	for ( int i = depth - 1; i >= 0; i-- ) {
+		Com_Printf( "  %s\n", VM_ValueToSymbol( vm, vm->callStack[i] ) );
+	}
 }
 
 
@@ -488,6 +614,7 @@ vmHeader_t *VM_LoadQVM( vm_t *vm, qboolean alloc ) {
 	CRC32_ProcessBlock( &crc32, header, length );
 	CRC32_End( &crc32 );
 	Crash_SaveQVMChecksum( vm->index, crc32 );
+	vm->checksum = crc32;
 
 	return header;
 }
@@ -1017,9 +1144,6 @@ vm_t *VM_Create( vmIndex_t index, syscall_t systemCalls, vmInterpret_t interpret
 	// free the original file
 	FS_FreeFile( header );
 
-	// load the map file
-	VM_LoadSymbols( vm );
-
 	Crash_SaveQVMPointer( index, vm );
 
 	Com_Printf( "%s loaded in %d bytes on the hunk\n", vm->name, remaining - Hunk_MemoryRemaining() );
@@ -1047,6 +1171,9 @@ void VM_Free( vm_t *vm ) {
 	if ( vm->dllHandle )
 		Sys_UnloadDll( vm->dllHandle );
 
+	if ( vm->symbols )
+		Z_Free( vm->symbols );
+
 	Com_Memset( vm, 0, sizeof( *vm ) );
 
 	currentVM = NULL;
@@ -142,11 +142,10 @@ extern const char *opname[OP_MAX];
 
 typedef int	vmptr_t;
 
-typedef struct vmSymbol_s {
-	struct vmSymbol_s	*next;
-	int		symValue;
-	int		profileCount;
-	char	symName[1];		// variable sized
+typedef struct {
+	int			symValue;		// instruction number
+	int			profileCount;
+	const char	*symName;		// stored after the symbol table
 } vmSymbol_t;
 
 typedef union vmFunc_u {
@@ -193,7 +192,8 @@ struct vm_s {
 	int			*opStackTop;		
 
 	int			numSymbols;
-	vmSymbol_t	*symbols;
+	vmSymbol_t	*symbols;			// sorted by value, loaded on the first lookup
+	qbool		symbolsLoaded;		// also set when there is no .map file
 
 	int			callLevel;			// counts recursive VM_Call
 	int			breakFunction;		// increment breakCount on function entry to this
@@ -208,6 +208,8 @@ struct vm_s {
 	int			lastCallStackDepth;
 	int			callStackDepthTemp; // only for vm_x86.cpp
 	int			callStack[MAX_VM_CALL_STACK_DEPTH];
+
+	unsigned	checksum;			// CRC32 of the QVM file, keys the compiled code cache
 };
 
 extern	vm_t	*currentVM;
@@ -227,6 +229,13 @@ typedef struct {
 	int		bssLength;			// zero filled memory appended to datalength
 } vmHeader_t;
 
+extern	cvar_t	*vm_codeCache;
+
+const vmSymbol_t *VM_FindSymbol( const vm_t *vm, int value );
+const vmSymbol_t *VM_ValueToFunctionSymbol( vm_t *vm, int value );
+const char *VM_ValueToSymbol( vm_t *vm, int value );
+void VM_PrintCallStack( vm_t *vm );
+
 qboolean VM_Compile( vm_t *vm, vmHeader_t *header );
 int	VM_CallCompiled( vm_t *vm, int *args );
 
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // load time compiler and execution environment for x86, 32-bit and 64-bit
 
 #include "vm_local.h"
+#include "git.h"
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -49,6 +50,9 @@ static const int vm_rtChecks = -1;
 
 static void *VM_Alloc_Compiled( vm_t *vm, int codeLength, int tableLength );
 static void VM_Destroy_Compiled( vm_t *vm );
+static void VM_Protect_Compiled( vm_t *vm );
+static qbool VM_LoadCompiledCache( vm_t *vm );
+static void VM_WriteCompiledCache( const vm_t *vm );
 
 /*
   -------------
@@ -181,32 +185,44 @@ int		funcOffset[FUNC_LAST];
 static int	errParam = 0;
 #endif
 
+static void PrintCallStack( void )
+{
+	if ( com_developer->integer )
+		VM_PrintCallStack( currentVM );
+}
+
+
 static void ErrJump( void )
 {
+	PrintCallStack();
 	Com_Error( ERR_DROP, "program tried to execute code outside VM" );
 }
 
 
 static void BadJump( void )
 {
+	PrintCallStack();
 	Com_Error( ERR_DROP, "program tried to execute code at bad location inside VM" );
 }
 
 
 static void BadStack( void )
 {
+	PrintCallStack();
 	Com_Error( ERR_DROP, "program tried to overflow program stack" );
 }
 
 
 static void BadOpStack( void )
 {
+	PrintCallStack();
 	Com_Error( ERR_DROP, "program tried to overflow opcode stack" );
 }
 
 
 static void BadData( void )
 {
+	PrintCallStack();
 #ifdef DEBUG_VM
 	Com_Error( ERR_DROP, "program tried to read/write out of data segment at %i", errParam );
 #else
@@ -222,14 +238,126 @@ static void (*const badOpStackPtr)(void) = BadOpStack;
 static void (*const badDataPtr)(void) = BadData;
 
 
+/*
+  compiled code cache
+
+  the generated code only depends on the QVM, the engine build and the CPU features,
+  except for the absolute addresses written by EmitPtr: those are recorded as
+  relocations relative to the vm_t, the data segment, the code buffer or
+  one of the static variables below so the code can be patched at load time
+*/
+
+#define VM_CACHE_IDENT		(('C'<<24)+('M'<<16)+('V'<<8)+'Q')
+#define VM_CACHE_VERSION	1
+
+typedef enum {
+	RELOC_VM,		// offset into the vm_t
+	RELOC_DATA,		// offset into the data segment
+	RELOC_CODE,		// offset into the code buffer, jump table included
+	RELOC_STATIC,	// index into relocStatics
+	RELOC_COUNT
+} relocType_t;
+
+typedef struct {
+	int		offset;		// where the pointer is written in the code
+	int		type;		// relocType_t
+	int		value;
+} vmReloc_t;
+
+typedef struct {
+	int			ident;
+	int			version;
+	unsigned	build;			// CRC32 of the engine build string
+	unsigned	checksum;		// CRC32 of the QVM file
+	int			cpuFeatures;
+	int			index;
+	int			vmSize;
+	int			pointerSize;
+	int			instructionCount;
+	int			dataMask;
+	int			stackBottom;
+	int			codeLength;		// the jump table starts right after the code
+	int			numRelocs;
+} vmCacheHeader_t;
+
+static const void* const relocStatics[] = {
+	&errJumpPtr,
+	&badJumpPtr,
+	&badStackPtr,
+	&badOpStackPtr,
+	&badDataPtr,
+#ifdef DEBUG_VM
+	&errParam
+#endif
+};
+
+static	vm_t		*relocVM;		// the VM being compiled
+static	vmReloc_t	*relocs;		// only filled by the final pass
+static	int			numRelocs;
+static	int			maxRelocs;
+static	qbool		relocFailed;	// a pointer couldn't be expressed, the code can't be cached
+
+
 static void VM_FreeBuffers( void )
 {
 	// should be freed in reversed allocation order
+	if ( relocs ) {
+		Z_Free( relocs );
+		relocs = NULL;
+	}
 	Z_Free( instructionOffsets );
 	Z_Free( inst );
 }
 
 
+static void VM_AddRelocation( const void *ptr )
+{
+	// the first pass only counts them
+	if ( !code ) {
+		numRelocs++;
+		return;
+	}
+
+	if ( !relocs || numRelocs >= maxRelocs ) {
+		relocFailed = qtrue;
+		return;
+	}
+
+	const vm_t* const vm = relocVM;
+	const byte* const p = (const byte*)ptr;
+	vmReloc_t* const reloc = &relocs[ numRelocs++ ];
+	reloc->offset = compiledOfs;
+
+	if ( p >= (const byte*)vm && p < (const byte*)(vm + 1) ) {
+		reloc->type = RELOC_VM;
+		reloc->value = p - (const byte*)vm;
+		return;
+	}
+
+	if ( p >= vm->dataBase && p <= vm->dataBase + vm->dataMask ) {
+		reloc->type = RELOC_DATA;
+		reloc->value = p - vm->dataBase;
+		return;
+	}
+
+	if ( p >= vm->codeBase.ptr && p < vm->codeBase.ptr + vm->allocSize ) {
+		reloc->type = RELOC_CODE;
+		reloc->value = p - vm->codeBase.ptr;
+		return;
+	}
+
+	for ( int i = 0; i < (int)ARRAY_LEN( relocStatics ); i++ ) {
+		if ( ptr == relocStatics[ i ] ) {
+			reloc->type = RELOC_STATIC;
+			reloc->value = i;
+			return;
+		}
+	}
+
+	relocFailed = qtrue;
+}
+
+
 static void Emit1( int v )
 {
 	if ( code )
@@ -268,6 +396,7 @@ static void Emit8( int64_t v )
 
 static void EmitPtr( const void *ptr )
 {
+	VM_AddRelocation( ptr );
 #if idx64
 	Emit8( (intptr_t)ptr );
 #else
@@ -1505,6 +1634,15 @@ qboolean VM_Compile( vm_t *vm, vmHeader_t *header ) {
 	int		proc_len;
 	int		i, n, v;
 
+	if ( vm_codeCache->integer && VM_LoadCompiledCache( vm ) ) {
+		return qtrue;
+	}
+
+	relocVM = vm;
+	relocs = NULL;
+	maxRelocs = 0;
+	relocFailed = qfalse;
+
 	inst = (instruction_t*)Z_Malloc((header->instructionCount + 8) * sizeof(instruction_t));
 	instructionOffsets = (int*)Z_Malloc( header->instructionCount * sizeof( int ) );
 
@@ -1530,6 +1668,7 @@ qboolean VM_Compile( vm_t *vm, vmHeader_t *header ) {
 __compile:
 	pop1 = OP_UNDEF;
 	lastConst = 0;
+	numRelocs = 0;
 
 	// translate all instructions
 	ip = 0;
@@ -2197,6 +2336,8 @@ __compile:
 			return qfalse;
 		}
 		instructionPointers = (intptr_t*)(byte*)(code + compiledOfs);
+		maxRelocs = numRelocs;
+		relocs = (vmReloc_t*)Z_Malloc( maxRelocs * sizeof( *relocs ) );
 		goto __compile;
 	}
 
@@ -2209,30 +2350,238 @@ __compile:
 		instructionPointers[ i ] = (intptr_t)vm->codeBase.ptr + instructionOffsets[ i ];
 	}
 
+	if ( vm_codeCache->integer && !relocFailed ) {
+		VM_WriteCompiledCache( vm );
+	}
+
 	VM_FreeBuffers();
 
+	VM_Protect_Compiled( vm );
+
+	vm->destroy = VM_Destroy_Compiled;
+
+	Com_Printf( "VM file %s compiled to %i bytes of code\n", vm->name, compiledOfs );
+
+	return qtrue;
+}
+
+
+/*
+=================
+VM_Protect_Compiled
+
+removes the write permissions of the code buffer
+=================
+*/
+static void VM_Protect_Compiled( vm_t *vm )
+{
 #ifdef VM_X86_MMAP
 	if ( mprotect( vm->codeBase.ptr, vm->allocSize, PROT_READ|PROT_EXEC ) ) {
 		VM_Destroy_Compiled( vm );
 		Com_Error( ERR_FATAL, "VM_CompileX86: mprotect failed" );
-		return qfalse;
 	}
 #elif _WIN32
-	{
-		DWORD oldProtect = 0;
+	DWORD oldProtect = 0;
+	if ( !VirtualProtect( vm->codeBase.ptr, vm->allocSize, PAGE_EXECUTE_READ, &oldProtect ) ) {
+		VM_Destroy_Compiled( vm );
+		Com_Error( ERR_FATAL, "VM_CompileX86: VirtualProtect failed" );
+	}
+#endif
+}
+
+
+/*
+=================
+VM_CacheBuild
+
+identifies the engine build, the cache is only valid for the build that wrote it
+=================
+*/
+static unsigned VM_CacheBuild()
+{
+	static const char build[] = Q3_VERSION " " GIT_COMMIT_SHORT " " PLATFORM_STRING " " __DATE__ " " __TIME__;
+
+	unsigned crc32;
+	CRC32_Begin( &crc32 );
+	CRC32_ProcessBlock( &crc32, build, sizeof( build ) );
+	CRC32_End( &crc32 );
+
+	return crc32;
+}
 
-		// remove write permissions.
-		if ( !VirtualProtect( vm->codeBase.ptr, vm->allocSize, PAGE_EXECUTE_READ, &oldProtect ) ) {
-			VM_Destroy_Compiled( vm );
-			Com_Error( ERR_FATAL, "VM_CompileX86: VirtualProtect failed" );
+
+static const char *VM_CachePath( const vm_t *vm )
+{
+	return va( FS_VM_CACHE_DIR "/%s-%08x.bin", vm->name, vm->checksum );
+}
+
+
+static void VM_SetCacheHeader( const vm_t *vm, vmCacheHeader_t *header )
+{
+	Com_Memset( header, 0, sizeof( *header ) );
+	header->ident = VM_CACHE_IDENT;
+	header->version = VM_CACHE_VERSION;
+	header->build = VM_CacheBuild();
+	header->checksum = vm->checksum;
+	header->cpuFeatures = cpu_features;
+	header->index = vm->index;
+	header->vmSize = sizeof( vm_t );
+	header->pointerSize = sizeof( intptr_t );
+	header->instructionCount = vm->instructionCount;
+	header->dataMask = vm->dataMask;
+	header->stackBottom = vm->stackBottom;
+}
+
+
+/*
+=================
+VM_WriteCompiledCache
+
+writes the code before the jump table gets filled in, then the jump table
+as code offsets (-1 for unused entries), then the relocations
+=================
+*/
+static void VM_WriteCompiledCache( const vm_t *vm )
+{
+	const fileHandle_t f = FS_SV_FOpenFileWrite( VM_CachePath( vm ) );
+	if ( !f ) {
+		Com_Printf( "WARNING: couldn't write %s\n", VM_CachePath( vm ) );
+		return;
+	}
+
+	vmCacheHeader_t header;
+	VM_SetCacheHeader( vm, &header );
+	header.codeLength = compiledOfs;
+	header.numRelocs = numRelocs;
+	FS_Write( &header, sizeof( header ), f );
+
+	FS_Write( code, compiledOfs, f );
+
+	for ( int i = 0; i < vm->instructionCount; i++ ) {
+		const int offset = inst[i].jused ? instructionOffsets[i] : -1;
+		FS_Write( &offset, sizeof( offset ), f );
+	}
+
+	FS_Write( relocs, numRelocs * sizeof( *relocs ), f );
+
+	FS_FCloseFile( f );
+}
+
+
+static qbool VM_ApplyRelocation( vm_t *vm, const vmReloc_t *reloc, int codeLength )
+{
+	if ( reloc->offset < 0 || reloc->offset > codeLength - (int)sizeof( intptr_t ) || reloc->value < 0 ) {
+		return qfalse;
+	}
+
+	intptr_t ptr;
+	switch ( reloc->type ) {
+		case RELOC_VM:
+			if ( reloc->value >= (int)sizeof( vm_t ) )
+				return qfalse;
+			ptr = (intptr_t)vm + reloc->value;
+			break;
+		case RELOC_DATA:
+			if ( reloc->value > vm->dataMask )
+				return qfalse;
+			ptr = (intptr_t)vm->dataBase + reloc->value;
+			break;
+		case RELOC_CODE:
+			if ( reloc->value >= vm->allocSize )
+				return qfalse;
+			ptr = (intptr_t)vm->codeBase.ptr + reloc->value;
+			break;
+		case RELOC_STATIC:
+			if ( reloc->value >= (int)ARRAY_LEN( relocStatics ) )
+				return qfalse;
+			ptr = (intptr_t)relocStatics[ reloc->value ];
+			break;
+		default:
 			return qfalse;
+	}
+
+	Com_Memcpy( vm->codeBase.ptr + reloc->offset, &ptr, sizeof( ptr ) );
+
+	return qtrue;
+}
+
+
+/*
+=================
+VM_LoadCompiledCache
+
+returns qfalse if there is no valid cached code for this QVM,
+in which case it has to be compiled again
+=================
+*/
+static qbool VM_LoadCompiledCache( vm_t *vm )
+{
+	fileHandle_t f;
+	const int length = FS_SV_FOpenFileRead( VM_CachePath( vm ), &f );
+	if ( !f ) {
+		return qfalse;
+	}
+
+	vmCacheHeader_t header, expected;
+	VM_SetCacheHeader( vm, &expected );
+	if ( length < (int)sizeof( header ) ||
+		 FS_Read( &header, sizeof( header ), f ) != sizeof( header ) ||
+		 header.codeLength <= 0 || header.numRelocs < 0 ) {
+		FS_FCloseFile( f );
+		return qfalse;
+	}
+
+	// everything but the sizes must match
+	expected.codeLength = header.codeLength;
+	expected.numRelocs = header.numRelocs;
+	if ( memcmp( &header, &expected, sizeof( header ) ) ||
+		 header.codeLength % sizeof( intptr_t ) != 0 ||
+		 length != (int)sizeof( header ) + header.codeLength +
+			header.instructionCount * (int)sizeof( int ) + header.numRelocs * (int)sizeof( vmReloc_t ) ) {
+		Com_DPrintf( "Ignoring stale compiled code cache %s\n", VM_CachePath( vm ) );
+		FS_FCloseFile( f );
+		return qfalse;
+	}
+
+	VM_Alloc_Compiled( vm, header.codeLength, header.instructionCount * sizeof( intptr_t ) );
+
+	int* const offsets = (int*)Z_Malloc( header.instructionCount * sizeof( int ) );
+	vmReloc_t* const cachedRelocs = (vmReloc_t*)Z_Malloc( header.numRelocs * sizeof( vmReloc_t ) );
+	qbool valid =
+		FS_Read( vm->codeBase.ptr, header.codeLength, f ) == header.codeLength &&
+		FS_Read( offsets, header.instructionCount * sizeof( int ), f ) == header.instructionCount * (int)sizeof( int ) &&
+		FS_Read( cachedRelocs, header.numRelocs * sizeof( vmReloc_t ), f ) == header.numRelocs * (int)sizeof( vmReloc_t );
+	FS_FCloseFile( f );
+
+	for ( int i = 0; valid && i < header.numRelocs; i++ ) {
+		valid = VM_ApplyRelocation( vm, &cachedRelocs[i], header.codeLength );
+	}
+
+	intptr_t* const table = (intptr_t*)( vm->codeBase.ptr + header.codeLength );
+	for ( int i = 0; valid && i < header.instructionCount; i++ ) {
+		if ( offsets[i] == -1 ) {
+			table[i] = (intptr_t)badJumpPtr;
+		} else if ( offsets[i] >= 0 && offsets[i] < header.codeLength ) {
+			table[i] = (intptr_t)vm->codeBase.ptr + offsets[i];
+		} else {
+			valid = qfalse;
 		}
 	}
-#endif
+
+	Z_Free( cachedRelocs );
+	Z_Free( offsets );
+
+	if ( !valid ) {
+		Com_Printf( "WARNING: %s is corrupt, recompiling\n", VM_CachePath( vm ) );
+		VM_Destroy_Compiled( vm );
+		return qfalse;
+	}
+
+	VM_Protect_Compiled( vm );
 
 	vm->destroy = VM_Destroy_Compiled;
 
-	Com_Printf( "VM file %s compiled to %i bytes of code\n", vm->name, compiledOfs );
+	Com_Printf( "VM file %s loaded from the code cache, %i bytes of code\n", vm->name, header.codeLength );
 
 	return qtrue;
 }
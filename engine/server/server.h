@@ -170,6 +170,8 @@ typedef struct client_s {
 	netchan_buffer_t **netchan_end_queue;
 
 	int				oldServerTime;
+
+	int				entityLastSent[MAX_GENTITIES];	// svs.time of the last snapshot that carried each entity's current state
 } client_t;
 
 //=============================================================================
@@ -247,6 +249,10 @@ extern	cvar_t	*sv_gametype;
 extern	cvar_t	*sv_pure;
 extern	cvar_t	*sv_floodProtect;
 extern	cvar_t	*sv_lanForceRate;
+extern	cvar_t	*sv_snapshotPriority;
+extern	cvar_t	*sv_snapshotLodDistance;
+extern	cvar_t	*sv_snapshotLodMsec;
+extern	cvar_t	*sv_oobRateLimit;
 extern	cvar_t	*sv_strictAuth;
 extern	cvar_t	*sv_minRestartDelay;
 
@@ -263,6 +269,13 @@ void SV_AddOperatorCommands();
 void SV_RemoveOperatorCommands();
 
 
+void SV_InvalidateStatusCache();
+
+void SV_HashClient( const client_t* cl );
+void SV_UnhashClient( const client_t* cl );
+void SV_RehashClients();
+
+
 void SV_MasterHeartbeat (void);
 void SV_MasterShutdown (void);
 
@@ -307,6 +320,15 @@ void SV_WriteDownloadToClient( client_t *cl , msg_t *msg );
 //
 void SV_Heartbeat_f( void );
 
+//
+// sv_demo.c
+//
+void SV_Record_f();
+void SV_StopRecord_f();
+void SV_WriteDemoFrame();
+void SV_DemoConfigstringChanged( int index );
+void SV_StopDemo();
+
 //
 // sv_snapshot.c
 //
@@ -409,6 +431,21 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 void SV_ClipToEntity( trace_t *trace, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int entityNum, int contentmask, int capsule );
 // clip to a specific entity
 
+void SV_TraceAtTime( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int time );
+// same as SV_Trace, but the client entities are tested at their recorded
+// positions at the given svs.time instead of their current ones
+// a time of 0 means the current positions
+
+void SV_SetTraceTime( int time, int skipEntityNum );
+// makes every SV_Trace call behave like SV_TraceAtTime until it's reset with 0
+// skipEntityNum (e.g. the shooter) stays at its current position
+
+void SV_RecordEntityHistory();
+// stores the boxes of the client entities, called after every game frame
+
+void SV_ResetEntityHistory( int entityNum );
+// for teleports, the old positions shouldn't be interpolated with the new ones
+
 //
 // sv_net_chan.c
 //
@@ -62,6 +62,7 @@ int SV_BotAllocateClient(void) {
 	cl->gentity = SV_GentityNum( i );
 	cl->gentity->s.number = i;
 	cl->state = CS_ACTIVE;
+	SV_InvalidateStatusCache();
 	cl->lastPacketTime = svs.time;
 	cl->netchan.remoteAddress.type = NA_BOT;
 	cl->rate = 16384;
@@ -83,6 +84,7 @@ void SV_BotFreeClient( int clientNum ) {
 	cl = &svs.clients[clientNum];
 	cl->state = CS_FREE;
 	cl->name[0] = 0;
+	SV_InvalidateStatusCache();
 	if ( cl->gentity ) {
 		cl->gentity->r.svFlags &= ~SVF_BOT;
 	}
@@ -527,6 +529,7 @@ void SV_BotInitBotLib(void) {
 	botlib_import.FreeMemory = BotImport_FreeMemory;
 	botlib_import.AvailableMemory = Z_AvailableMemory;
 	botlib_import.HunkAlloc = BotImport_HunkAlloc;
+	botlib_import.SharedData = Com_SharedData;
 
 	// file system access
 	botlib_import.FS_FOpenFile = FS_FOpenFileByMode;
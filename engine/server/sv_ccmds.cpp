@@ -776,7 +776,9 @@ static const cmdTableItem_t sv_cmds[] =
 	{ "killserver", SV_KillServer_f, NULL, "shuts the server down" },
 	{ "sv_restart", SV_ServerRestart_f, NULL, "restarts the server" },
 	{ "sv_restartProcess", SV_RestartProcess_f, NULL, "restarts the server's child process" },
-	{ "uptime", SV_Uptime_f, NULL, "prints the server's uptimes" }
+	{ "uptime", SV_Uptime_f, NULL, "prints the server's uptimes" },
+	{ "sv_record", SV_Record_f, NULL, "records all players and entities to a server demo" },
+	{ "sv_stoprecord", SV_StopRecord_f, NULL, "stops recording the server demo" }
 };
 
 
@@ -34,7 +34,11 @@ static void SV_UserinfoChanged( client_t *cl )
 	int i;
 	const char* val;
 
-	Q_strncpyz( cl->name, Info_ValueForKey( cl->userinfo, "name" ), sizeof(cl->name) );
+	val = Info_ValueForKey( cl->userinfo, "name" );
+	if ( strncmp( cl->name, val, sizeof(cl->name) - 1 ) ) {
+		Q_strncpyz( cl->name, val, sizeof(cl->name) );
+		SV_InvalidateStatusCache();
+	}
 
 	val = Info_ValueForKey( cl->userinfo, "rate" );
 	if (val[0]) {
@@ -442,6 +446,7 @@ gotnewcl:
 	// build a new connection
 	// accept the new client
 	// this is the only place a client_t is ever initialized
+	SV_UnhashClient( newcl );
 	*newcl = temp;
 	clientNum = newcl - svs.clients;
 	ent = SV_GentityNum( clientNum );
@@ -476,6 +481,8 @@ gotnewcl:
 	Com_DPrintf( "Going from CS_FREE to CS_CONNECTED for %s\n", newcl->name );
 
 	newcl->state = CS_CONNECTED;
+	SV_HashClient( newcl );
+	SV_InvalidateStatusCache();
 	newcl->nextSnapshotTime = svs.time;
 	newcl->lastPacketTime = svs.time;
 	newcl->lastConnectTime = svs.time;
@@ -528,6 +535,7 @@ void SV_DropClient( client_t* drop, const char* reason )
 
 	Com_DPrintf( "Going to CS_ZOMBIE for %s\n", drop->name );
 	drop->state = CS_ZOMBIE;		// become free in a few seconds
+	SV_InvalidateStatusCache();
 	if (drop->download)	{
 		FS_FCloseFile( drop->download );
 		drop->download = 0;
@@ -1274,7 +1282,7 @@ static void SV_UserMove( client_t *cl, msg_t *msg, qbool delta ) {
 
 	// save time for ping calculation if this is the first ack of a given snap
 	if ( cl->frames[ cl->messageAcknowledge & PACKET_MASK ].messageAcked <= 0 )
-		cl->frames[ cl->messageAcknowledge & PACKET_MASK ].messageAcked = Sys_Milliseconds();
+		cl->frames[ cl->messageAcknowledge & PACKET_MASK ].messageAcked = Com_NetworkMilliseconds();
 
 	// catch the no-cp-yet situation before SV_ClientEnterWorld
 	// if CS_ACTIVE, then it's time to trigger a new gamestate emission
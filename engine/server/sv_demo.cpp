@@ -0,0 +1,433 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_demo.cpp -- server-side multiview demo recording
+
+
+/*
+
+GENERAL
+
+sv_record captures every entity the clients could be sent and the
+playerState_t of every active client after each game frame.
+Frames are delta-encoded against the previous frame with the regular
+msg.cpp functions and appended to a memory buffer.
+Once a buffer holds DEMO_FLUSH_SIZE bytes, it's handed to the writer thread
+and the server frame keeps filling the other one, so the file I/O never
+happens on the tick. The server only waits for the writer when both
+buffers are full, i.e. when the disk can't keep up.
+The writer thread lives as long as the recording and sleeps on an event
+until a buffer is handed over or the recording stops.
+The buffers are malloc'd so the zone doesn't lose 8 MB to them.
+
+FILE FORMAT
+
+demos/<name>.svdm is a sequence of blocks: [long length] [message data].
+A length of -1 ends the file.
+The message data is written by a non-OOB msg_t, so it's Huffman-encoded.
+
+The first block is the gamestate:
+	[svc_gamestate] { [svc_configstring] [short index] [bigstring] } { [svc_baseline] [delta entity] } [svc_EOF]
+
+Every other block is a server frame:
+	{ [svc_configstring] [short index] [bigstring] }	configstrings changed since the last frame
+	[svc_snapshot] [long serverTime]
+	{ [byte clientNum] [delta playerState_t] } [byte 255]	from the client's last frame or from nothing
+	<packetentities>	same encoding as in snapshots, new entities are sent from their baseline
+	[svc_EOF]
+
+*/
+
+
+#include "server.h"
+
+
+#define DEMO_BUFFER_SIZE	(4 << 20)	// each of the 2 buffers
+#define DEMO_FLUSH_SIZE		(1 << 20)	// hand a buffer over to the writer once it has this much
+#define MAX_DEMO_MESSAGE	(256 << 10)	// the first frame has every entity from its baseline
+#define END_OF_PLAYERS		255
+
+
+typedef struct {
+	entityState_t	entities[MAX_GENTITIES];
+	qbool			present[MAX_GENTITIES];
+} demoFrame_t;
+
+typedef struct {
+	fileHandle_t	file;
+	char			name[MAX_QPATH];
+	byte*			buffers[2];
+	int				bufferBytes[2];
+	int				current;			// the buffer the server frames write to
+	void*			writer;				// NULL if the thread couldn't be started
+	FILE*			writerFile;
+	void*			writerWake;			// signalled when a buffer is handed over or on quit
+	void*			writerIdle;			// signalled when the writer is done with a buffer
+	volatile int	writerBuffer;		// index + 1 of the buffer handed to the writer, 0 when idle
+	volatile int	writerQuit;
+	volatile int	writerFailed;
+	demoFrame_t		frames[2];			// the previous and the current frame
+	int				prevFrame;
+	playerState_t	players[MAX_CLIENTS];
+	qbool			hasPlayer[MAX_CLIENTS];
+	qbool			configStringChanged[MAX_CONFIGSTRINGS];
+	byte			message[MAX_DEMO_MESSAGE];
+	int				numFrames;
+	int				totalBytes;
+	qbool			recording;
+} serverDemo_t;
+
+
+static serverDemo_t svd;
+
+
+// runs on the writer thread: only touches the buffer it was handed and the FILE
+
+static void SV_WriteDemoBuffer( int index )
+{
+	const size_t numBytes = (size_t)svd.bufferBytes[index];
+	if ( fwrite( svd.buffers[index], 1, numBytes, svd.writerFile ) != numBytes )
+		svd.writerFailed = 1;
+}
+
+
+static void SV_DemoWriterThread( void* )
+{
+	for ( ;; ) {
+		Sys_WaitEvent( svd.writerWake );
+
+		const int buffer = svd.writerBuffer;
+		if ( buffer != 0 ) {
+			Sys_MemoryBarrier();
+			SV_WriteDemoBuffer( buffer - 1 );
+			Sys_MemoryBarrier();
+			svd.writerBuffer = 0;
+			Sys_SignalEvent( svd.writerIdle );
+		}
+
+		if ( svd.writerQuit )
+			break;
+	}
+}
+
+
+static qbool SV_IsDemoWriterIdle()
+{
+	return svd.writerBuffer == 0;
+}
+
+
+static void SV_WaitForDemoWriter()
+{
+	while ( !SV_IsDemoWriterIdle() ) {
+		Sys_WaitEvent( svd.writerIdle );
+	}
+	Sys_MemoryBarrier();
+
+	if ( svd.writerFailed ) {
+		Com_Printf( "WARNING: couldn't write to %s\n", svd.name );
+		svd.writerFailed = 0;
+	}
+}
+
+
+static void SV_FlushDemoBuffer()
+{
+	SV_WaitForDemoWriter();
+
+	const int index = svd.current;
+	if ( svd.bufferBytes[index] <= 0 )
+		return;
+
+	svd.current ^= 1;
+	svd.bufferBytes[svd.current] = 0;
+
+	if ( svd.writer == NULL ) {
+		// no thread, no problem: just block
+		SV_WriteDemoBuffer( index );
+		return;
+	}
+
+	// the buffer's content must be visible before the writer sees it's theirs
+	Sys_MemoryBarrier();
+	svd.writerBuffer = index + 1;
+	Sys_SignalEvent( svd.writerWake );
+}
+
+
+static void SV_WriteDemoBlock( const void* data, int length )
+{
+	if ( svd.bufferBytes[svd.current] + 4 + max( length, 0 ) > DEMO_BUFFER_SIZE ) {
+		// the writer is too slow, wait for it and swap buffers
+		SV_FlushDemoBuffer();
+	}
+
+	// a negative length is the end of file marker
+	const int numBytes = 4 + max( length, 0 );
+	byte* const buffer = svd.buffers[svd.current] + svd.bufferBytes[svd.current];
+	const int swlen = LittleLong( length );
+	Com_Memcpy( buffer, &swlen, 4 );
+	if ( length > 0 )
+		Com_Memcpy( buffer + 4, data, length );
+	svd.bufferBytes[svd.current] += numBytes;
+	svd.totalBytes += numBytes;
+
+	if ( svd.bufferBytes[svd.current] >= DEMO_FLUSH_SIZE && SV_IsDemoWriterIdle() ) {
+		SV_FlushDemoBuffer();
+	}
+}
+
+
+static void SV_WriteDemoGamestate()
+{
+	msg_t msg;
+	MSG_Init( &msg, svd.message, sizeof(svd.message) );
+
+	MSG_WriteByte( &msg, svc_gamestate );
+
+	for ( int i = 0; i < MAX_CONFIGSTRINGS; ++i ) {
+		if ( sv.configstrings[i][0] ) {
+			MSG_WriteByte( &msg, svc_configstring );
+			MSG_WriteShort( &msg, i );
+			MSG_WriteBigString( &msg, sv.configstrings[i] );
+		}
+	}
+
+	entityState_t nullstate;
+	Com_Memset( &nullstate, 0, sizeof(nullstate) );
+	for ( int i = 0; i < MAX_GENTITIES; ++i ) {
+		const entityState_t* base = &sv.svEntities[i].baseline;
+		if ( !base->number )
+			continue;
+		MSG_WriteByte( &msg, svc_baseline );
+		MSG_WriteDeltaEntity( &msg, &nullstate, base, qtrue );
+	}
+
+	MSG_WriteByte( &msg, svc_EOF );
+
+	if ( msg.overflowed ) {
+		Com_Printf( "ERROR: demo gamestate message buffer overflow\n" );
+		return;
+	}
+
+	SV_WriteDemoBlock( msg.data, msg.cursize );
+}
+
+
+static void SV_WriteDemoEntities( msg_t* msg, const demoFrame_t* from, demoFrame_t* to )
+{
+	for ( int i = 0; i < MAX_GENTITIES - 1; ++i ) {
+		if ( to->present[i] && from->present[i] ) {
+			MSG_WriteDeltaEntity( msg, &from->entities[i], &to->entities[i], qfalse );
+		} else if ( to->present[i] ) {
+			MSG_WriteDeltaEntity( msg, &sv.svEntities[i].baseline, &to->entities[i], qtrue );
+		} else if ( from->present[i] ) {
+			MSG_WriteDeltaEntity( msg, &from->entities[i], NULL, qtrue );
+		}
+	}
+
+	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );	// end of packetentities
+}
+
+
+void SV_WriteDemoFrame()
+{
+	if ( !svd.recording )
+		return;
+
+	msg_t msg;
+	MSG_Init( &msg, svd.message, sizeof(svd.message) );
+
+	for ( int i = 0; i < MAX_CONFIGSTRINGS; ++i ) {
+		if ( svd.configStringChanged[i] ) {
+			MSG_WriteByte( &msg, svc_configstring );
+			MSG_WriteShort( &msg, i );
+			MSG_WriteBigString( &msg, sv.configstrings[i] );
+			svd.configStringChanged[i] = qfalse;
+		}
+	}
+
+	MSG_WriteByte( &msg, svc_snapshot );
+	MSG_WriteLong( &msg, svs.time );
+
+	for ( int i = 0; i < sv_maxclients->integer; ++i ) {
+		if ( svs.clients[i].state != CS_ACTIVE ) {
+			svd.hasPlayer[i] = qfalse;
+			continue;
+		}
+		playerState_t* ps = SV_GameClientNum( i );
+		MSG_WriteByte( &msg, i );
+		MSG_WriteDeltaPlayerstate( &msg, svd.hasPlayer[i] ? &svd.players[i] : NULL, ps );
+		svd.players[i] = *ps;
+		svd.hasPlayer[i] = qtrue;
+	}
+	MSG_WriteByte( &msg, END_OF_PLAYERS );
+
+	const demoFrame_t* const prev = &svd.frames[svd.prevFrame];
+	demoFrame_t* const curr = &svd.frames[svd.prevFrame ^ 1];
+	for ( int i = 0; i < MAX_GENTITIES - 1; ++i ) {
+		curr->present[i] = qfalse;
+		if ( i >= sv.num_entities )
+			continue;
+		const sharedEntity_t* ent = SV_GentityNum( i );
+		if ( !ent->r.linked || ( ent->r.svFlags & SVF_NOCLIENT ) )
+			continue;
+		curr->entities[i] = ent->s;
+		curr->entities[i].number = i;
+		curr->present[i] = qtrue;
+	}
+	SV_WriteDemoEntities( &msg, prev, curr );
+	svd.prevFrame ^= 1;
+
+	MSG_WriteByte( &msg, svc_EOF );
+
+	if ( msg.overflowed ) {
+		// the next frame will be delta-encoded against this one, so we can't skip it
+		Com_Printf( "ERROR: demo frame message buffer overflow, recording stopped\n" );
+		SV_StopDemo();
+		return;
+	}
+
+	SV_WriteDemoBlock( msg.data, msg.cursize );
+	svd.numFrames++;
+}
+
+
+void SV_DemoConfigstringChanged( int index )
+{
+	if ( svd.recording )
+		svd.configStringChanged[index] = qtrue;
+}
+
+
+void SV_StopDemo()
+{
+	if ( !svd.recording )
+		return;
+
+	svd.recording = qfalse;
+
+	SV_WriteDemoBlock( NULL, -1 );
+	SV_FlushDemoBuffer();
+	SV_WaitForDemoWriter();
+
+	if ( svd.writer != NULL ) {
+		svd.writerQuit = 1;
+		Sys_SignalEvent( svd.writerWake );
+		Sys_JoinThread( svd.writer );
+		svd.writer = NULL;
+		Sys_DestroyEvent( svd.writerWake );
+		Sys_DestroyEvent( svd.writerIdle );
+	}
+
+	FS_FCloseFile( svd.file );
+	free( svd.buffers[0] );
+	free( svd.buffers[1] );
+
+	Com_Printf( "Stopped recording %s: %d frames, %d KB\n", svd.name, svd.numFrames, svd.totalBytes >> 10 );
+}
+
+
+void SV_Record_f()
+{
+	if ( Cmd_Argc() > 2 ) {
+		Com_Printf( "usage: sv_record [demoname]\n" );
+		return;
+	}
+
+	if ( svd.recording ) {
+		Com_Printf( "Already recording %s\n", svd.name );
+		return;
+	}
+
+	if ( sv.state != SS_GAME ) {
+		Com_Printf( "The server isn't running a map\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() == 2 ) {
+		Com_sprintf( svd.name, sizeof(svd.name), "demos/%s.svdm", Cmd_Argv(1) );
+	} else {
+		qtime_t t;
+		Com_RealTime( &t );
+		Com_sprintf( svd.name, sizeof(svd.name), "demos/%04d_%02d_%02d-%02d_%02d_%02d-%s.svdm",
+			1900 + t.tm_year, 1 + t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, sv_mapname->string );
+	}
+
+	svd.file = FS_FOpenFileWrite( svd.name );
+	if ( !svd.file ) {
+		Com_Printf( "ERROR: couldn't open %s\n", svd.name );
+		return;
+	}
+
+	svd.buffers[0] = (byte*)malloc( DEMO_BUFFER_SIZE );
+	svd.buffers[1] = (byte*)malloc( DEMO_BUFFER_SIZE );
+	if ( !svd.buffers[0] || !svd.buffers[1] ) {
+		Com_Printf( "ERROR: couldn't allocate the demo buffers\n" );
+		free( svd.buffers[0] );
+		free( svd.buffers[1] );
+		FS_FCloseFile( svd.file );
+		return;
+	}
+
+	svd.writerFile = FS_FileForHandle( svd.file );
+	svd.writerBuffer = 0;
+	svd.writerQuit = 0;
+	svd.writerFailed = 0;
+	svd.writer = NULL;
+	svd.writerWake = Sys_CreateEvent();
+	svd.writerIdle = Sys_CreateEvent();
+	if ( svd.writerWake != NULL && svd.writerIdle != NULL )
+		svd.writer = Sys_StartThread( SV_DemoWriterThread, NULL );
+	if ( svd.writer == NULL ) {
+		// SV_FlushDemoBuffer falls back to blocking writes
+		if ( svd.writerWake != NULL )
+			Sys_DestroyEvent( svd.writerWake );
+		if ( svd.writerIdle != NULL )
+			Sys_DestroyEvent( svd.writerIdle );
+	}
+	svd.bufferBytes[0] = 0;
+	svd.bufferBytes[1] = 0;
+	svd.current = 0;
+	svd.prevFrame = 0;
+	Com_Memset( svd.frames[0].present, 0, sizeof(svd.frames[0].present) );
+	Com_Memset( svd.hasPlayer, 0, sizeof(svd.hasPlayer) );
+	Com_Memset( svd.configStringChanged, 0, sizeof(svd.configStringChanged) );
+	svd.numFrames = 0;
+	svd.totalBytes = 0;
+	svd.recording = qtrue;
+
+	SV_WriteDemoGamestate();
+
+	Com_Printf( "Recording to %s\n", svd.name );
+}
+
+
+void SV_StopRecord_f()
+{
+	if ( !svd.recording ) {
+		Com_Printf( "Not recording a server demo\n" );
+		return;
+	}
+
+	SV_StopDemo();
+}
+
@@ -244,6 +244,10 @@ static qbool SV_G_GetValue( char* value, int valueSize, const char* key )
 		{ "trap_Cvar_SetHelp", G_EXT_CVAR_SETHELP },
 		{ "trap_Cmd_SetHelp", G_EXT_CMD_SETHELP },
 		{ "trap_Error2", G_EXT_ERROR2 },
+		{ "trap_SetTraceTime", G_EXT_SETTRACETIME },
+		{ "trap_TraceAtTime", G_EXT_TRACEATTIME },
+		{ "trap_ResetEntityHistory", G_EXT_RESETENTITYHISTORY },
+		{ "trap_Microseconds", G_EXT_MICROSECONDS },
 		// capabilities
 		{ "cap_ExtraColorCodes", 1 }
 	};
@@ -838,6 +842,21 @@ static intptr_t SV_GameSystemCalls( intptr_t* args )
 		Com_ErrorExt( ERR_DROP, EXT_ERRMOD_GAME, (qbool)args[2], "%s", (const char*)VMA(1) );
 		return 0;
 
+	case G_EXT_SETTRACETIME:
+		SV_SetTraceTime( args[1], args[2] );
+		return 0;
+
+	case G_EXT_TRACEATTIME:
+		SV_TraceAtTime( VMA(1), VMA(2), VMA(3), VMA(4), VMA(5), args[6], args[7], /*int capsule*/ qfalse, args[8] );
+		return 0;
+
+	case G_EXT_RESETENTITYHISTORY:
+		SV_ResetEntityHistory( args[1] );
+		return 0;
+
+	case G_EXT_MICROSECONDS:
+		return (int)Sys_Microseconds();
+
 	default:
 		Com_Error( ERR_DROP, "Bad game system trap: %i", args[0] );
 	}
@@ -852,6 +871,9 @@ static intptr_t SV_GameSystemCalls( intptr_t* args )
 
 void SV_ShutdownGameProgs()
 {
+	// an error could have come in the middle of a time shifted shot
+	SV_SetTraceTime( 0, ENTITYNUM_NONE );
+
 	if ( !gvm )
 		return;
 
@@ -871,6 +893,8 @@ static void SV_InitGameVM( qbool restart )
 	// start the entity parsing at the beginning
 	sv.entityParsePoint = CM_EntityString();
 
+	SV_SetTraceTime( 0, ENTITYNUM_NONE );
+
 	// clear all gentity pointers that might still be set from a previous level
 	for (int i = 0; i < sv_maxclients->integer; ++i)
 		svs.clients[i].gentity = NULL;
@@ -55,6 +55,11 @@ void SV_SetConfigstring (int index, const char *val) {
 	Z_Free( sv.configstrings[index] );
 	sv.configstrings[index] = CopyString( val );
 
+	if ( index == CS_SERVERINFO ) {
+		SV_InvalidateStatusCache();
+	}
+	SV_DemoConfigstringChanged( index );
+
 	// send it to all the clients if we aren't
 	// spawning a new server
 	if ( sv.state == SS_GAME || sv.restarting ) {
@@ -142,6 +147,7 @@ void SV_SetUserinfo( int index, const char *val ) {
 
 	Q_strncpyz( svs.clients[index].userinfo, val, sizeof( svs.clients[ index ].userinfo ) );
 	Q_strncpyz( svs.clients[index].name, Info_ValueForKey( val, "name" ), sizeof(svs.clients[index].name) );
+	SV_InvalidateStatusCache();
 }
 
 
@@ -218,6 +224,7 @@ void SV_Startup( void )
 	SV_BoundMaxClients( 1 );
 
 	svs.clients = Z_New<client_t>( sv_maxclients->integer );
+	SV_RehashClients();
 	if ( com_dedicated->integer ) {
 		svs.numSnapshotEntities = sv_maxclients->integer * PACKET_BACKUP * 64;
 	} else {
@@ -285,6 +292,8 @@ void SV_ChangeMaxClients( void ) {
 
 	// free the old clients on the hunk
 	Hunk_FreeTempMemory( oldClients );
+
+	SV_RehashClients();
 	
 	// allocate new snapshot entities
 	if ( com_dedicated->integer ) {
@@ -324,6 +333,9 @@ static void SV_TouchCGame()
 
 void SV_SpawnServer( const char* mapname )
 {
+	// a demo can't span a gamestate change
+	SV_StopDemo();
+
 	// shut down the existing game if it is running
 	SV_ShutdownGameProgs();
 
@@ -564,6 +576,10 @@ static const cvarTableItem_t sv_cvars[] =
 	{ &sv_killserver, "sv_killserver", "0", 0, CVART_BOOL, NULL, NULL, "menu system can set to " S_COLOR_VAL "1 " S_COLOR_HELP "to shut server down" },
 	{ NULL, "sv_mapChecksum", "", CVAR_ROM, CVART_INTEGER, NULL, NULL, ".bsp file checksum" },
 	{ &sv_lanForceRate, "sv_lanForceRate", "1", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, S_COLOR_VAL "1 " S_COLOR_HELP "means uncapped rate on LAN" },
+	{ &sv_snapshotPriority, "sv_snapshotPriority", "0", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, "defers low-priority entities when a snapshot has too many or the client's rate is exceeded" },
+	{ &sv_snapshotLodDistance, "sv_snapshotLodDistance", "0", CVAR_ARCHIVE, CVART_INTEGER, "0", NULL, "non-player entities farther than this get their position refreshed less often, " S_COLOR_VAL "0 " S_COLOR_HELP "means disabled" },
+	{ &sv_snapshotLodMsec, "sv_snapshotLodMsec", "100", CVAR_ARCHIVE, CVART_INTEGER, "0", "1000", "position refresh interval added per " S_COLOR_CVAR "sv_snapshotLodDistance " S_COLOR_HELP "of distance" },
+	{ &sv_oobRateLimit, "sv_oobRateLimit", "10", 0, CVART_INTEGER, "0", "1000", "max. connectionless packets per second per IP, " S_COLOR_VAL "0 " S_COLOR_HELP "means no limit" },
 	{ &sv_strictAuth, "sv_strictAuth", "0", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, "requires CD key authentication" },
 	{ &sv_minRestartDelay, "sv_minRestartDelay", "2", 0, CVART_INTEGER, "1", "48", "min. hours to wait before restarting the server" }
 };
@@ -648,6 +664,7 @@ void SV_Shutdown( const char* finalmsg )
 		SV_FinalMessage( finalmsg );
 	}
 
+	SV_StopDemo();
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
 	SV_ShutdownGameProgs();
@@ -660,6 +677,7 @@ void SV_Shutdown( const char* finalmsg )
 		Z_Free( svs.clients );
 	}
 	Com_Memset( &svs, 0, sizeof( svs ) );
+	SV_RehashClients();
 
 	Cvar_Set( "sv_running", "0" );
 	Cvar_Set( "sv_singlePlayer", "0" );
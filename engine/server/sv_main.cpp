@@ -50,6 +50,10 @@ cvar_t	*sv_gametype;
 cvar_t	*sv_pure;
 cvar_t	*sv_floodProtect;
 cvar_t	*sv_lanForceRate;		// dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
+cvar_t	*sv_snapshotPriority;	// defers low-priority entities when a snapshot is over budget
+cvar_t	*sv_snapshotLodDistance;	// entities farther than this get position refreshes less often
+cvar_t	*sv_snapshotLodMsec;	// refresh interval added per sv_snapshotLodDistance of distance
+cvar_t	*sv_oobRateLimit;		// max. connectionless packets per second per IP
 cvar_t	*sv_strictAuth;
 cvar_t	*sv_minRestartDelay;	// min. time before restart in hours
 
@@ -310,78 +314,101 @@ CONNECTIONLESS COMMANDS
 */
 
 /*
-================
-SVC_Status
+==============================================================================
 
-Responds with all the info that qplug or qspy can see about the server
-and all connected players.  Used for getting detailed information after
-the simple info query.
-================
+CACHED STATUS RESPONSES
+
+getstatus and getinfo floods are cheap to send and used to cost a full
+infostring rebuild per packet. The reply bodies are rendered once and reused
+until serverinfo or the player list changes, and only the challenge is spliced
+in per request. Scores and pings change without any event, so a cached body
+also expires after STATUS_CACHE_MSEC.
+
+==============================================================================
 */
-void SVC_Status( netadr_t from ) {
-	char	player[1024];
-	char	status[MAX_MSGLEN];
-	int		i;
-	client_t	*cl;
-	playerState_t	*ps;
-	int		statusLength;
-	int		playerLength;
-	char	infostring[MAX_INFO_STRING];
 
-	// ignore if we are in single player
-	if (Cvar_VariableValue("sv_singlePlayer"))
-		return;
+#define	STATUS_CACHE_MSEC	1000
+#define	MAX_CHALLENGE_LEN	128		// longer challenges are ignored (Luigi Auriemma's infostring bug)
 
-	strcpy( infostring, Cvar_InfoString( CVAR_SERVERINFO ) );
+typedef struct {
+	qbool	valid;
+	int		time;					// Com_NetworkMilliseconds when rendered
+	char	info[MAX_INFO_STRING];	// without the challenge
+	char	players[MAX_MSGLEN];	// getstatus only
+} statusCache_t;
+
+static statusCache_t sv_statusCache;
+static statusCache_t sv_infoCache;
 
-	// echo back the parameter to status. so master servers can use it as a challenge
-	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
 
-	status[0] = 0;
+void SV_InvalidateStatusCache()
+{
+	sv_statusCache.valid = qfalse;
+	sv_infoCache.valid = qfalse;
+}
+
+
+static qbool SV_IsStatusCacheValid( const statusCache_t* cache )
+{
+	return cache->valid && Com_NetworkMilliseconds() - cache->time < STATUS_CACHE_MSEC;
+}
+
+
+// what Info_SetValueForKey( info, "challenge", Cmd_Argv(1) ) would have appended
+// to an info string that has no challenge key yet
+
+static const char* SV_ChallengeInfo( const char* info )
+{
+	const char* challenge = Cmd_Argv(1);
+
+	if ( !*challenge || strchr( challenge, '\\' ) || strchr( challenge, ';' ) || strchr( challenge, '"' ) )
+		return "";
+
+	if ( strlen( info ) + strlen( challenge ) + 11 >= MAX_INFO_STRING )
+		return "";
+
+	return va( "\\challenge\\%s", challenge );
+}
+
+
+static void SV_RenderStatus( statusCache_t* cache )
+{
+	char	player[1024];
+	int		statusLength, playerLength;
+
+	Q_strncpyz( cache->info, Cvar_InfoString( CVAR_SERVERINFO ), sizeof(cache->info) );
+	Info_RemoveKey( cache->info, "challenge" );
+
+	cache->players[0] = 0;
 	statusLength = 0;
 
-	for (i=0 ; i < sv_maxclients->integer ; i++) {
-		cl = &svs.clients[i];
+	for (int i = 0; i < sv_maxclients->integer; ++i) {
+		const client_t* cl = &svs.clients[i];
 		if ( cl->state >= CS_CONNECTED ) {
-			ps = SV_GameClientNum( i );
+			const playerState_t* ps = SV_GameClientNum( i );
 			Com_sprintf (player, sizeof(player), "%i %i \"%s\"\n", 
 				ps->persistant[PERS_SCORE], cl->ping, cl->name);
 			playerLength = strlen(player);
-			if (statusLength + playerLength >= sizeof(status) ) {
+			if (statusLength + playerLength >= sizeof(cache->players) ) {
 				break;		// can't hold any more
 			}
-			strcpy (status + statusLength, player);
+			strcpy (cache->players + statusLength, player);
 			statusLength += playerLength;
 		}
 	}
 
-	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, status );
+	cache->time = Com_NetworkMilliseconds();
+	cache->valid = qtrue;
 }
 
 
-// responds with a short info message that should be enough to determine
-// if a user is interested in a server to do a full status
-
-static void SVC_Info( const netadr_t& from )
+static void SV_RenderInfo( statusCache_t* cache )
 {
-	int		i, count;
-	char	infostring[MAX_INFO_STRING];
-
-	// ignore if we are in single player
-	if (Cvar_VariableValue("sv_singlePlayer"))
-		return;
-
-	// Check whether Cmd_Argv(1) has a sane length. This was not done in the original Quake3 version which led
-	// to the Infostring bug discovered by Luigi Auriemma. See http://aluigi.altervista.org/ for the advisory.
-
-	// A maximum challenge length of 128 should be more than plenty.
-	if(strlen(Cmd_Argv(1)) > 128)
-		return;
+	char* infostring = cache->info;
 
 	// don't count privateclients
-	count = 0;
-	for ( i = sv_privateClients->integer ; i < sv_maxclients->integer ; i++ ) {
+	int count = 0;
+	for (int i = sv_privateClients->integer; i < sv_maxclients->integer; ++i) {
 		if ( svs.clients[i].state >= CS_CONNECTED ) {
 			count++;
 		}
@@ -389,10 +416,6 @@ static void SVC_Info( const netadr_t& from )
 
 	infostring[0] = 0;
 
-	// echo back the parameter to status. so servers can use it as a challenge
-	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
-
 	Info_SetValueForKey( infostring, "protocol", va("%i", PROTOCOL_VERSION) );
 	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
 	Info_SetValueForKey( infostring, "mapname", sv_mapname->string );
@@ -414,7 +437,60 @@ static void SVC_Info( const netadr_t& from )
 		Info_SetValueForKey( infostring, "game", gamedir );
 	}
 
-	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", infostring );
+	cache->time = Com_NetworkMilliseconds();
+	cache->valid = qtrue;
+}
+
+
+/*
+================
+SVC_Status
+
+Responds with all the info that qplug or qspy can see about the server
+and all connected players.  Used for getting detailed information after
+the simple info query.
+================
+*/
+static void SVC_Status( const netadr_t& from )
+{
+	// ignore if we are in single player
+	if (Cvar_VariableValue("sv_singlePlayer"))
+		return;
+
+	if (strlen(Cmd_Argv(1)) > MAX_CHALLENGE_LEN)
+		return;
+
+	if (!SV_IsStatusCacheValid( &sv_statusCache ))
+		SV_RenderStatus( &sv_statusCache );
+
+	// echo back the parameter to status. so master servers can use it as a challenge
+	// to prevent timed spoofed reply packets that add ghost servers
+	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s%s\n%s",
+		sv_statusCache.info, SV_ChallengeInfo( sv_statusCache.info ), sv_statusCache.players );
+}
+
+
+// responds with a short info message that should be enough to determine
+// if a user is interested in a server to do a full status
+
+static void SVC_Info( const netadr_t& from )
+{
+	// ignore if we are in single player
+	if (Cvar_VariableValue("sv_singlePlayer"))
+		return;
+
+	// Check whether Cmd_Argv(1) has a sane length. This was not done in the original Quake3 version which led
+	// to the Infostring bug discovered by Luigi Auriemma. See http://aluigi.altervista.org/ for the advisory.
+	if (strlen(Cmd_Argv(1)) > MAX_CHALLENGE_LEN)
+		return;
+
+	if (!SV_IsStatusCacheValid( &sv_infoCache ))
+		SV_RenderInfo( &sv_infoCache );
+
+	// echo back the parameter to status. so servers can use it as a challenge
+	// to prevent timed spoofed reply packets that add ghost servers
+	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s%s",
+		SV_ChallengeInfo( sv_infoCache.info ), sv_infoCache.info );
 }
 
 /*
@@ -495,11 +571,106 @@ void SVC_RemoteCommand( netadr_t from, msg_t *msg ) {
 }
 
 
+/*
+==============================================================================
+
+CONNECTIONLESS PACKET RATE LIMITING
+
+Every source IP and every /24 subnet gets a token bucket refilled at
+sv_oobRateLimit packets per second (subnets get OOB_SUBNET_SCALE times that).
+The buckets live in small fixed-size hash tables: when a probe sequence is full,
+the stalest bucket is recycled, so spoofed sources can't grow memory use.
+
+==============================================================================
+*/
+
+#define	OOB_BUCKETS			1024	// per table, must be a power of 2
+#define	OOB_PROBES			4
+#define	OOB_BURST_MSEC		2000	// a full bucket holds this much traffic
+#define	OOB_SUBNET_SCALE	4
+#define	OOB_TOKEN			1000	// a packet costs this many tokens
+
+typedef struct {
+	unsigned int	key;
+	int				time;		// Com_NetworkMilliseconds of the last refill, 0 when unused
+	int				tokens;
+} oobBucket_t;
+
+static oobBucket_t sv_oobAddressBuckets[OOB_BUCKETS];
+static oobBucket_t sv_oobSubnetBuckets[OOB_BUCKETS];
+
+
+static oobBucket_t* SV_FindOOBBucket( oobBucket_t* table, unsigned int key, int now )
+{
+	const unsigned int hash = (key * 2654435761u) >> 22;
+	oobBucket_t* stalest = NULL;
+
+	for (int i = 0; i < OOB_PROBES; ++i) {
+		oobBucket_t* bucket = &table[(hash + i) & (OOB_BUCKETS - 1)];
+		if ( bucket->time && bucket->key == key )
+			return bucket;
+		if ( !stalest || !bucket->time || bucket->time - stalest->time < 0 )
+			stalest = bucket;
+		if ( !stalest->time )
+			break;
+	}
+
+	stalest->key = key;
+	stalest->time = now - OOB_BURST_MSEC;
+	stalest->tokens = 0;
+
+	return stalest;
+}
+
+
+// rate is in packets per second
+
+static qbool SV_TakeOOBToken( oobBucket_t* table, unsigned int key, int rate, int now )
+{
+	oobBucket_t* bucket = SV_FindOOBBucket( table, key, now );
+
+	const int elapsed = min( now - bucket->time, OOB_BURST_MSEC );
+	if ( elapsed > 0 ) {
+		bucket->tokens = min( bucket->tokens + elapsed * rate, OOB_BURST_MSEC * rate );
+		bucket->time = now;
+	}
+
+	if ( bucket->tokens < OOB_TOKEN )
+		return qfalse;
+
+	bucket->tokens -= OOB_TOKEN;
+	return qtrue;
+}
+
+
+static qbool SV_AllowConnectionlessPacket( const netadr_t& from )
+{
+	if ( sv_oobRateLimit->integer <= 0 || from.type != NA_IP || Sys_IsLANAddress( from ) )
+		return qtrue;
+
+	const int now = Com_NetworkMilliseconds() | 1; // 0 marks unused buckets
+	const unsigned int subnet = (from.ip[0] << 16) | (from.ip[1] << 8) | from.ip[2];
+	const unsigned int address = (subnet << 8) | from.ip[3];
+	const int rate = sv_oobRateLimit->integer;
+
+	// a single flooding source runs out of its own tokens before it can drain its subnet's
+	if ( !SV_TakeOOBToken( sv_oobAddressBuckets, address, rate, now ) )
+		return qfalse;
+
+	return SV_TakeOOBToken( sv_oobSubnetBuckets, subnet, rate * OOB_SUBNET_SCALE, now );
+}
+
+
 // a connectionless packet has four leading 0xff characters to distinguish it from a game channel.
 // clients that are in the game can still send connectionless packets.
 
 static void SV_ConnectionlessPacket( const netadr_t from, msg_t* msg )
 {
+	if (!SV_AllowConnectionlessPacket( from )) {
+		Com_DPrintf("SV packet %s : rate limited\n", NET_AdrToString(from));
+		return;
+	}
+
 	MSG_BeginReadingOOB( msg );
 	MSG_ReadLong( msg );		// skip the -1 marker
 
@@ -536,6 +707,107 @@ static void SV_ConnectionlessPacket( const netadr_t from, msg_t* msg )
 
 //============================================================================
 
+/*
+In-band packets are matched to their client by base address and qport.
+The chains hold client numbers and are maintained on connect and on the
+switch to CS_FREE, the port isn't part of the key so NAT port fixups
+don't need to touch them.
+*/
+
+#define	CLIENT_HASH_SIZE	256		// must be a power of 2
+
+static int sv_clientHash[CLIENT_HASH_SIZE];		// first client number + 1, 0 when empty
+static int sv_clientHashNext[MAX_CLIENTS];		// next client number + 1 in the chain
+static int sv_clientHashBucket[MAX_CLIENTS];	// -1 when not hashed
+
+
+static int SV_ClientHashBucket( const netadr_t& adr, int qport )
+{
+	unsigned int key = (unsigned int)qport;
+
+	// NET_CompareBaseAdr only looks at the IP for NA_IP
+	if ( adr.type == NA_IP )
+		key ^= (unsigned int)((adr.ip[0] << 24) | (adr.ip[1] << 16) | (adr.ip[2] << 8) | adr.ip[3]) * 2654435761u;
+
+	return (int)((key ^ (key >> 16)) & (CLIENT_HASH_SIZE - 1));
+}
+
+
+void SV_UnhashClient( const client_t* cl )
+{
+	const int clientNum = cl - svs.clients;
+	const int bucket = sv_clientHashBucket[clientNum];
+
+	if ( bucket < 0 )
+		return;
+
+	int* link = &sv_clientHash[bucket];
+	while ( *link ) {
+		if ( *link - 1 == clientNum ) {
+			*link = sv_clientHashNext[clientNum];
+			break;
+		}
+		link = &sv_clientHashNext[*link - 1];
+	}
+
+	sv_clientHashNext[clientNum] = 0;
+	sv_clientHashBucket[clientNum] = -1;
+}
+
+
+void SV_HashClient( const client_t* cl )
+{
+	SV_UnhashClient( cl );
+
+	// bots never send packets
+	if ( cl->netchan.remoteAddress.type == NA_BOT )
+		return;
+
+	const int clientNum = cl - svs.clients;
+	const int bucket = SV_ClientHashBucket( cl->netchan.remoteAddress, cl->netchan.qport );
+
+	sv_clientHashNext[clientNum] = sv_clientHash[bucket];
+	sv_clientHash[bucket] = clientNum + 1;
+	sv_clientHashBucket[clientNum] = bucket;
+}
+
+
+// called whenever svs.clients is (re)allocated
+
+void SV_RehashClients()
+{
+	Com_Memset( sv_clientHash, 0, sizeof(sv_clientHash) );
+	Com_Memset( sv_clientHashNext, 0, sizeof(sv_clientHashNext) );
+	for (int i = 0; i < MAX_CLIENTS; ++i)
+		sv_clientHashBucket[i] = -1;
+
+	if ( !svs.clients )
+		return;
+
+	for (int i = 0; i < sv_maxclients->integer; ++i) {
+		if ( svs.clients[i].state != CS_FREE ) {
+			SV_HashClient( &svs.clients[i] );
+		}
+	}
+}
+
+
+static client_t* SV_FindClientByAddress( const netadr_t& from, int qport )
+{
+	int clientNum = sv_clientHash[SV_ClientHashBucket( from, qport )];
+
+	while ( clientNum ) {
+		client_t* cl = &svs.clients[clientNum - 1];
+		// it is possible to have multiple clients from a single IP
+		// address, so they are differentiated by the qport variable
+		if ( cl->state != CS_FREE && cl->netchan.qport == qport && NET_CompareBaseAdr( from, cl->netchan.remoteAddress ) )
+			return cl;
+		clientNum = sv_clientHashNext[clientNum - 1];
+	}
+
+	return NULL;
+}
+
 
 void SV_PacketEvent( const netadr_t& from, msg_t* msg )
 {
@@ -551,43 +823,31 @@ void SV_PacketEvent( const netadr_t& from, msg_t* msg )
 	int qport = MSG_ReadShort( msg ) & 0xffff;
 
 	// find which client the message is from
-	client_t* cl = svs.clients;
-	for (int i = 0; i < sv_maxclients->integer; ++i, ++cl) {
-		if (cl->state == CS_FREE) {
-			continue;
-		}
-		if ( !NET_CompareBaseAdr( from, cl->netchan.remoteAddress ) ) {
-			continue;
-		}
-		// it is possible to have multiple clients from a single IP
-		// address, so they are differentiated by the qport variable
-		if (cl->netchan.qport != qport) {
-			continue;
-		}
+	client_t* cl = SV_FindClientByAddress( from, qport );
+	if ( !cl ) {
+		// if we received a sequenced packet from an address we don't recognize,
+		// send an out of band disconnect packet to it
+		NET_OutOfBandPrint( NS_SERVER, from, "disconnect" );
+		return;
+	}
 
-		// the IP port can't be used to differentiate them,
-		// because some NATs periodically change UDP port assignments
-		if (cl->netchan.remoteAddress.port != from.port) {
-			Com_Printf( "SV_PacketEvent: fixing up a translated port\n" );
-			cl->netchan.remoteAddress.port = from.port;
-		}
+	// the IP port can't be used to differentiate them,
+	// because some NATs periodically change UDP port assignments
+	if (cl->netchan.remoteAddress.port != from.port) {
+		Com_Printf( "SV_PacketEvent: fixing up a translated port\n" );
+		cl->netchan.remoteAddress.port = from.port;
+	}
 
-		// make sure it is a valid, in sequence packet
-		if (SV_Netchan_Process(cl, msg)) {
-			// zombie clients still need to do the Netchan_Process
-			// to make sure they don't need to retransmit the final
-			// reliable message, but they don't do any other processing
-			if (cl->state != CS_ZOMBIE) {
-				cl->lastPacketTime = svs.time;	// don't timeout
-				SV_ExecuteClientMessage( cl, msg );
-			}
+	// make sure it is a valid, in sequence packet
+	if (SV_Netchan_Process(cl, msg)) {
+		// zombie clients still need to do the Netchan_Process
+		// to make sure they don't need to retransmit the final
+		// reliable message, but they don't do any other processing
+		if (cl->state != CS_ZOMBIE) {
+			cl->lastPacketTime = svs.time;	// don't timeout
+			SV_ExecuteClientMessage( cl, msg );
 		}
-		return;
 	}
-
-	// if we received a sequenced packet from an address we don't recognize,
-	// send an out of band disconnect packet to it
-	NET_OutOfBandPrint( NS_SERVER, from, "disconnect" );
 }
 
 
@@ -665,6 +925,7 @@ void SV_CheckTimeouts( void ) {
 			// using the client id cause the cl->name is empty at this point
 			Com_DPrintf( "Going from CS_ZOMBIE to CS_FREE for client %d\n", i );
 			cl->state = CS_FREE;	// can now be reused
+			SV_UnhashClient( cl );
 			continue;
 		}
 		if ( cl->state >= CS_CONNECTED &&
@@ -675,6 +936,7 @@ void SV_CheckTimeouts( void ) {
 			if ( ++cl->timeoutCount > 5 ) {
 				SV_DropClient (cl, "timed out"); 
 				cl->state = CS_FREE;	// don't bother with zombie state
+				SV_UnhashClient( cl );
 			}
 		} else {
 			cl->timeoutCount = 0;
@@ -826,6 +1088,7 @@ void SV_Frame( int msec ) {
 	}
 
 	int startTime = com_speeds->integer ? Sys_Milliseconds() : 0;
+	const int64_t startTimeUS = Sys_Microseconds();
 
 	// update pings based on the OOB packets received while we were sleeping
 	SV_CalcPings();
@@ -839,8 +1102,13 @@ void SV_Frame( int msec ) {
 		svs.time += frameMsec;
 		// let everything in the world think and move
 		VM_Call( gvm, GAME_RUN_FRAME, svs.time );
+		// remember where the clients ended up for the game's rewound traces
+		SV_RecordEntityHistory();
+		// capture the frame for the server demo, if any
+		SV_WriteDemoFrame();
 	}
 
+	time_gameUS = Sys_Microseconds() - startTimeUS;
 	if ( com_speeds->integer ) {
 		time_game = Sys_Milliseconds() - startTime;
 	}
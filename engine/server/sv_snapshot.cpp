@@ -55,6 +55,421 @@ static void SV_TrackEntityOverhead( int offset, const msg_t* msg, const entitySt
 }
 
 
+/*
+=============================================================================
+
+Snapshot entity priorities
+
+When a snapshot has more entities than cgame will keep or more bytes than
+the client's rate allows, the least important entities are deferred to later
+snapshots instead of being cut off by entity number or delaying the packet.
+
+An entity the client already has in the delta base keeps its old state
+(which costs nothing to send), a new one is left out of the snapshot.
+Players, freestanding events, fresh spawns like missiles and entities whose
+event, flags or trajectory changed are never deferred: an old state would
+replay a stale trajectory or lose the event for good once the entity is freed.
+
+With sv_snapshotLodDistance set, entities far from the viewer also get their
+position and angle refreshes at a reduced rate. Any other change, trajectory
+changes and events included, is still sent right away. Players are left out:
+the game rewinds them to where the shooter's snapshots showed them, so what
+a shooter saw and what gets traced must be the same positions.
+When everything fits, LOD is applied in a single pass without sorting.
+
+=============================================================================
+*/
+
+#define	HEADER_RATE_BYTES		48		// include our header, IP header, and some overhead
+#define	MAX_SNAPSHOT_ENTITIES	1024
+#define	MAX_ENTITY_AGE			1000	// msec, how much waiting can raise an entity's priority
+#define	MAX_LOD_STEPS			4		// the slowest refresh is MAX_LOD_STEPS * sv_snapshotLodMsec
+#define	NEW_TRAJECTORY_MSEC		100		// covers a server frame and the missiles' prestep
+
+// entityState_t::eType values, they must match bg_public.h
+// a debug qagame has ET_DEBUG_TRIGGER before ET_EVENTS, which only means
+// its debug triggers are treated as events here
+typedef enum {
+	ET_GENERAL,
+	ET_PLAYER,
+	ET_ITEM,
+	ET_MISSILE,
+	ET_MOVER,
+	ET_BEAM,
+	ET_PORTAL,
+	ET_SPEAKER,
+	ET_PUSH_TRIGGER,
+	ET_TELEPORT_TRIGGER,
+	ET_INVISIBLE,
+	ET_GRAPPLE,
+	ET_TEAM,
+#if defined( QC )
+	ET_TOTEM,
+	ET_ACID_TRIGGER,
+#endif
+	ET_EVENTS
+} snapshotEntityType_t;
+
+typedef enum {
+	SEA_DROP,		// not in this snapshot
+	SEA_KEEP,		// send the delta base's state again
+	SEA_SEND		// send the current state
+} snapshotEntityAction_t;
+
+typedef struct {
+	int		index;		// into the frame's entities
+	float	priority;
+	qbool	critical;	// never deferred for rate
+	qbool	lod;		// only a position/angle refresh that isn't due yet
+} snapshotEntityPriority_t;
+
+static const entityState_t* sv_baseStates[MAX_GENTITIES];
+
+
+static int SV_ClientRate( const client_t* client )
+{
+	int rate = client->rate;
+	if ( sv_maxRate->integer ) {
+		if ( sv_maxRate->integer < 1000 ) {
+			Cvar_Set( "sv_MaxRate", "1000" );
+		}
+		if ( sv_maxRate->integer < rate ) {
+			rate = sv_maxRate->integer;
+		}
+	}
+	if ( sv_minRate->integer ) {
+		if ( sv_minRate->integer < 1000 )
+			Cvar_Set( "sv_minRate", "1000" );
+		if ( sv_minRate->integer > rate )
+			rate = sv_minRate->integer;
+	}
+
+	return rate;
+}
+
+
+// local clients and LAN clients with sv_lanForceRate get a snapshot every frame
+
+static qbool SV_IsRateLimited( const client_t* client )
+{
+	// TTimo - https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=491
+	// added sv_lanForceRate check
+	if ( client->netchan.remoteAddress.type == NA_LOOPBACK ) {
+		return qfalse;
+	}
+
+	return !sv_lanForceRate->integer || !Sys_IsLANAddress( client->netchan.remoteAddress );
+}
+
+
+static float SV_EntityDistance( const clientSnapshot_t* frame, int entityNum )
+{
+	const sharedEntity_t* const ent = SV_GentityNum( entityNum );
+	vec3_t center, delta;
+	if ( ent->r.bmodel ) {
+		VectorAdd( ent->r.absmin, ent->r.absmax, center );
+		VectorScale( center, 0.5f, center );
+	} else {
+		VectorCopy( ent->r.currentOrigin, center );
+	}
+	VectorSubtract( center, frame->ps.origin, delta );
+
+	return VectorLength( delta );
+}
+
+
+static float SV_EntityPriority( const client_t* client, const clientSnapshot_t* frame, const entityState_t* state, qbool inBase, qbool* critical )
+{
+	float weight;
+	if ( state->number < MAX_CLIENTS || state->eType == ET_PLAYER ) {
+		weight = 8.0f;
+		*critical = qtrue;
+	} else if ( state->eType >= ET_EVENTS ) {
+		weight = 6.0f;
+		*critical = qtrue;
+	} else if ( state->eType == ET_MISSILE ) {
+		weight = 4.0f;
+		*critical = qfalse;
+	} else if ( state->eType == ET_MOVER ) {
+		weight = 2.0f;
+		*critical = qfalse;
+	} else {
+		weight = 1.0f;
+		*critical = qfalse;
+	}
+
+	const float distance = SV_EntityDistance( frame, state->number );
+	const int age = min( svs.time - client->entityLastSent[state->number], MAX_ENTITY_AGE );
+	float priority = weight * ( 1.0f + (float)age / 100.0f ) / ( 1.0f + distance / 1000.0f );
+
+	// swapping entities in and out costs full updates, so favor what the client has
+	if ( inBase ) {
+		priority *= 1.5f;
+	}
+
+	return priority;
+}
+
+
+// cgame only uses trBase for stationary and interpolated trajectories, anything
+// else that changes means a new trajectory (e.g. a grenade bounce)
+
+static qbool SV_IsTrajectoryRefresh( const trajectory_t* base, const trajectory_t* tr )
+{
+	if ( tr->trType != base->trType ) {
+		return qfalse;
+	}
+
+	if ( tr->trType == TR_STATIONARY || tr->trType == TR_INTERPOLATE ) {
+		return qtrue;
+	}
+
+	return !memcmp( tr, base, sizeof(*tr) );
+}
+
+
+// changes that must not be held back by resending the delta base's state
+
+static qbool SV_IsUrgentChange( const entityState_t* base, const entityState_t* state )
+{
+	// a new entity with a trajectory that just started was spawned this frame (e.g. a rocket),
+	// dropping it would make it pop up mid-flight or not show up at all
+	if ( base == NULL ) {
+		return state->event != 0 ||
+			( state->pos.trType != TR_STATIONARY && state->pos.trType != TR_INTERPOLATE &&
+			  state->pos.trTime >= svs.time - NEW_TRAJECTORY_MSEC );
+	}
+
+	if ( state->event != base->event || state->eventParm != base->eventParm || state->eFlags != base->eFlags ) {
+		return qtrue;
+	}
+
+	return !SV_IsTrajectoryRefresh( &base->pos, &state->pos ) || !SV_IsTrajectoryRefresh( &base->apos, &state->apos );
+}
+
+
+// true when the only difference is a new position and/or angles that cgame interpolates
+
+static qbool SV_IsRefreshOnly( const entityState_t* base, const entityState_t* state )
+{
+	if ( state->pos.trType != base->pos.trType || state->apos.trType != base->apos.trType ) {
+		return qfalse;
+	}
+
+	entityState_t refresh = *state;
+	if ( state->pos.trType == TR_STATIONARY || state->pos.trType == TR_INTERPOLATE ) {
+		refresh.pos = base->pos;
+	}
+	if ( state->apos.trType == TR_STATIONARY || state->apos.trType == TR_INTERPOLATE ) {
+		refresh.apos = base->apos;
+	}
+
+	return !memcmp( &refresh, base, sizeof(refresh) );
+}
+
+
+// whether a far entity's refresh can wait for a later snapshot
+
+static qbool SV_DeferEntityRefresh( const client_t* client, const clientSnapshot_t* frame, const entityState_t* base, const entityState_t* state )
+{
+	// the lag compensation needs players to be where the client saw them
+	if ( state->number < MAX_CLIENTS ) {
+		return qfalse;
+	}
+
+	// nothing changed, sending it is free
+	if ( !memcmp( base, state, sizeof(*state) ) ) {
+		return qfalse;
+	}
+
+	if ( !SV_IsRefreshOnly( base, state ) ) {
+		return qfalse;
+	}
+
+	const int steps = min( (int)( SV_EntityDistance( frame, state->number ) / sv_snapshotLodDistance->value ), MAX_LOD_STEPS );
+
+	return svs.time - client->entityLastSent[state->number] < steps * sv_snapshotLodMsec->integer;
+}
+
+
+static int QDECL SV_QsortEntityPriorities( const void* a, const void* b )
+{
+	const snapshotEntityPriority_t* const pa = (const snapshotEntityPriority_t*)a;
+	const snapshotEntityPriority_t* const pb = (const snapshotEntityPriority_t*)b;
+
+	// critical entities get their slots first
+	if ( pa->critical != pb->critical ) {
+		return pa->critical ? -1 : 1;
+	}
+
+	if ( pa->priority > pb->priority ) {
+		return -1;
+	}
+	if ( pa->priority < pb->priority ) {
+		return 1;
+	}
+
+	return pa->index - pb->index;
+}
+
+
+// the number of bytes MSG_WriteDeltaEntity would write for this entity
+
+static int SV_EntityDeltaBytes( const entityState_t* base, const entityState_t* state )
+{
+	static byte buffer[MAX_MSGLEN];
+	msg_t msg;
+	MSG_Init( &msg, buffer, sizeof(buffer) );
+	msg.allowoverflow = qtrue;
+
+	if ( base ) {
+		MSG_WriteDeltaEntity( &msg, base, state, qfalse );
+	} else {
+		MSG_WriteDeltaEntity( &msg, &sv.svEntities[state->number].baseline, state, qtrue );
+	}
+
+	return ( msg.bit + 7 ) / 8;
+}
+
+
+// replaces the far refreshes that aren't due yet with their delta base state in place
+
+static void SV_DeferSnapshotRefreshes( client_t* client, const clientSnapshot_t* oldframe, clientSnapshot_t* frame )
+{
+	int oldIndex = 0;
+	for ( int i = 0; i < frame->num_entities; ++i ) {
+		entityState_t* const state = &svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities];
+
+		// both frames are sorted by entity number
+		const entityState_t* base = NULL;
+		while ( oldIndex < oldframe->num_entities ) {
+			const entityState_t* const old = &svs.snapshotEntities[(oldframe->first_entity + oldIndex) % svs.numSnapshotEntities];
+			if ( old->number > state->number ) {
+				break;
+			}
+			oldIndex++;
+			if ( old->number == state->number ) {
+				base = old;
+				break;
+			}
+		}
+
+		if ( base != NULL && SV_DeferEntityRefresh( client, frame, base, state ) ) {
+			*state = *base;
+		} else {
+			client->entityLastSent[state->number] = svs.time;
+		}
+	}
+}
+
+
+// byteBudget is the room left in the message for entities, -1 means no limit
+
+static void SV_PrioritizeSnapshotEntities( client_t* client, const clientSnapshot_t* oldframe, clientSnapshot_t* frame, int byteBudget )
+{
+	static snapshotEntityPriority_t priorities[MAX_SNAPSHOT_ENTITIES];
+	static byte actions[MAX_SNAPSHOT_ENTITIES];
+	int i;
+
+	const qbool lod = oldframe != NULL && sv_snapshotLodDistance->integer > 0;
+	const int slotBudget = sv_snapshotPriority->integer ? MAX_ENTITIES_IN_SNAPSHOT : MAX_SNAPSHOT_ENTITIES;
+
+	// everything fits, so nothing needs scoring or sorting
+	if ( frame->num_entities <= slotBudget && byteBudget < 0 ) {
+		if ( lod ) {
+			SV_DeferSnapshotRefreshes( client, oldframe, frame );
+			return;
+		}
+		for ( i = 0; i < frame->num_entities; ++i ) {
+			const entityState_t* const state = &svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities];
+			client->entityLastSent[state->number] = svs.time;
+		}
+		return;
+	}
+
+	const int numBase = oldframe ? oldframe->num_entities : 0;
+	for ( i = 0; i < numBase; ++i ) {
+		const entityState_t* const state = &svs.snapshotEntities[(oldframe->first_entity + i) % svs.numSnapshotEntities];
+		sv_baseStates[state->number] = state;
+	}
+
+	for ( i = 0; i < frame->num_entities; ++i ) {
+		const entityState_t* const state = &svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities];
+		const entityState_t* const base = sv_baseStates[state->number];
+		priorities[i].index = i;
+		priorities[i].priority = SV_EntityPriority( client, frame, state, base != NULL, &priorities[i].critical );
+		if ( SV_IsUrgentChange( base, state ) ) {
+			priorities[i].critical = qtrue;
+		}
+		priorities[i].lod = lod && base != NULL && SV_DeferEntityRefresh( client, frame, base, state );
+	}
+	qsort( priorities, frame->num_entities, sizeof(priorities[0]), SV_QsortEntityPriorities );
+
+	// most important first: every entity takes a slot, only sent states take bytes
+	int slots = slotBudget;
+	int bytes = 0;
+	for ( i = 0; i < frame->num_entities; ++i ) {
+		const int index = priorities[i].index;
+		const entityState_t* const state = &svs.snapshotEntities[(frame->first_entity + index) % svs.numSnapshotEntities];
+		const entityState_t* const base = sv_baseStates[state->number];
+
+		if ( slots == 0 ) {
+			actions[index] = SEA_DROP;
+			continue;
+		}
+		slots--;
+
+		if ( priorities[i].lod ) {
+			actions[index] = SEA_KEEP;
+			continue;
+		}
+
+		if ( byteBudget >= 0 ) {
+			const int cost = SV_EntityDeltaBytes( base, state );
+			if ( !priorities[i].critical && bytes + cost > byteBudget ) {
+				if ( base ) {
+					actions[index] = SEA_KEEP;
+				} else {
+					actions[index] = SEA_DROP;
+					slots++;
+				}
+				continue;
+			}
+			bytes += cost;
+		}
+
+		actions[index] = SEA_SEND;
+	}
+
+	// rewrite the frame in entity number order, which the delta compression needs
+	int numEntities = 0;
+	for ( i = 0; i < frame->num_entities; ++i ) {
+		const entityState_t* const state = &svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities];
+		entityState_t* const dest = &svs.snapshotEntities[(frame->first_entity + numEntities) % svs.numSnapshotEntities];
+
+		if ( actions[i] == SEA_DROP ) {
+			continue;
+		}
+
+		if ( actions[i] == SEA_KEEP ) {
+			*dest = *sv_baseStates[state->number];
+		} else {
+			client->entityLastSent[state->number] = svs.time;
+			if ( dest != state ) {
+				*dest = *state;
+			}
+		}
+		numEntities++;
+	}
+	frame->num_entities = numEntities;
+
+	for ( i = 0; i < numBase; ++i ) {
+		const entityState_t* const state = &svs.snapshotEntities[(oldframe->first_entity + i) % svs.numSnapshotEntities];
+		sv_baseStates[state->number] = NULL;
+	}
+}
+
+
 /*
 =============================================================================
 
@@ -217,6 +632,14 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 		MSG_WriteDeltaPlayerstate( msg, NULL, &frame->ps );
 	}
 
+	// defer what doesn't fit or isn't due yet, the rate budget is what's left of one snapshot interval
+	int byteBudget = -1;
+	if ( sv_snapshotPriority->integer && client->state == CS_ACTIVE && SV_IsRateLimited( client ) ) {
+		const int snapshotBytes = SV_ClientRate( client ) * client->snapshotMsec / 1000 - HEADER_RATE_BYTES;
+		byteBudget = max( snapshotBytes - msg->cursize - 2, 0 );
+	}
+	SV_PrioritizeSnapshotEntities( client, oldframe, frame, byteBudget );
+
 	// delta encode the entities
 	SV_EmitPacketEntities (oldframe, frame, msg);
 
@@ -266,7 +689,6 @@ Build a client snapshot structure
 =============================================================================
 */
 
-#define	MAX_SNAPSHOT_ENTITIES	1024
 typedef struct {
 	int		numSnapshotEntities;
 	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];
@@ -542,7 +964,6 @@ Return the number of msec a given size message is supposed
 to take to clear, based on the current rate
 ====================
 */
-#define	HEADER_RATE_BYTES	48		// include our header, IP header, and some overhead
 static int SV_RateMsec( client_t *client, int messageSize )
 {
 	// individual messages will never be larger than fragment size
@@ -550,23 +971,7 @@ static int SV_RateMsec( client_t *client, int messageSize )
 	if ( messageSize > 1500 )
 		messageSize = 1500;
 
-	int rate = client->rate;
-	if ( sv_maxRate->integer ) {
-		if ( sv_maxRate->integer < 1000 ) {
-			Cvar_Set( "sv_MaxRate", "1000" );
-		}
-		if ( sv_maxRate->integer < rate ) {
-			rate = sv_maxRate->integer;
-		}
-	}
-	if ( sv_minRate->integer ) {
-		if ( sv_minRate->integer < 1000 )
-			Cvar_Set( "sv_minRate", "1000" );
-		if ( sv_minRate->integer > rate )
-			rate = sv_minRate->integer;
-	}
-
-	return (( messageSize + HEADER_RATE_BYTES ) * 1000 / rate);
+	return (( messageSize + HEADER_RATE_BYTES ) * 1000 / SV_ClientRate( client ));
 }
 
 /*
@@ -581,7 +986,7 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
 
 	// record information about the message
 	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg->cursize;
-	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = Sys_Milliseconds();
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = Com_NetworkMilliseconds();
 	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
 	// send the datagram
@@ -592,9 +997,7 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
 	// set nextSnapshotTime based on rate and requested number of updates
 
 	// local clients get snapshots every frame
-	// TTimo - https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=491
-	// added sv_lanForceRate check
-	if ( client->netchan.remoteAddress.type == NA_LOOPBACK || (sv_lanForceRate->integer && Sys_IsLANAddress(client->netchan.remoteAddress)) ) {
+	if ( !SV_IsRateLimited( client ) ) {
 		// we do NOT currently have snapshots every frame because of SV_Frame's NET_Sleep call
 		// but we can avoid piling up snapshots in the same milli-second before sleeping roughly 1000/sv_fps milli-seconds...
 		client->nextSnapshotTime = svs.time + 1;
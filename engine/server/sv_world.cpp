@@ -23,6 +23,110 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "server.h"
 
+/*
+===============================================================================
+
+ENTITY HISTORY
+
+the boxes of the client entities are recorded after every game frame
+so that lag compensated traces can test against their past positions
+without the game having to move and relink them
+
+===============================================================================
+*/
+
+#define MAX_ENTITY_HISTORY	64	// must be a power of 2
+
+typedef struct {
+	int		time;		// svs.time
+	vec3_t	origin;
+	vec3_t	mins, maxs;
+} entityRecord_t;
+
+typedef struct {
+	entityRecord_t	records[MAX_ENTITY_HISTORY];
+	int				count;		// total number of records written since the last reset
+} entityHistory_t;
+
+static entityHistory_t sv_entityHistory[MAX_CLIENTS];
+static int sv_traceTime;	// 0 when SV_Trace uses the current positions
+static int sv_traceSkipNum = ENTITYNUM_NONE;	// not time shifted by SV_Trace
+
+
+void SV_RecordEntityHistory()
+{
+	for ( int i = 0; i < sv_maxclients->integer; ++i ) {
+		const sharedEntity_t* ent = SV_GentityNum( i );
+		entityHistory_t* const history = &sv_entityHistory[i];
+		entityRecord_t* const record = &history->records[history->count & (MAX_ENTITY_HISTORY - 1)];
+		record->time = svs.time;
+		VectorCopy( ent->r.currentOrigin, record->origin );
+		VectorCopy( ent->r.mins, record->mins );
+		VectorCopy( ent->r.maxs, record->maxs );
+		history->count++;
+	}
+}
+
+
+void SV_ResetEntityHistory( int entityNum )
+{
+	if ( entityNum >= 0 && entityNum < MAX_CLIENTS )
+		sv_entityHistory[entityNum].count = 0;
+}
+
+
+void SV_SetTraceTime( int time, int skipEntityNum )
+{
+	sv_traceTime = time;
+	sv_traceSkipNum = skipEntityNum;
+}
+
+
+static void SV_LerpVector( float frac, const vec3_t start, const vec3_t end, vec3_t result )
+{
+	result[0] = start[0] + frac * ( end[0] - start[0] );
+	result[1] = start[1] + frac * ( end[1] - start[1] );
+	result[2] = start[2] + frac * ( end[2] - start[2] );
+}
+
+
+// returns qfalse if the entity should be tested at its current position
+
+static qbool SV_EntityBoxAtTime( int entityNum, int time, vec3_t origin, vec3_t mins, vec3_t maxs )
+{
+	const entityHistory_t* const history = &sv_entityHistory[entityNum];
+	const int count = min( history->count, MAX_ENTITY_HISTORY );
+	if ( count <= 0 )
+		return qfalse;
+
+	// the latest record is the current position
+	const entityRecord_t* newer = &history->records[(history->count - 1) & (MAX_ENTITY_HISTORY - 1)];
+	if ( newer->time <= time )
+		return qfalse;
+
+	// find the 2 records whose times sandwich the requested time
+	for ( int i = 2; i <= count; ++i ) {
+		const entityRecord_t* const older = &history->records[(history->count - i) & (MAX_ENTITY_HISTORY - 1)];
+		if ( older->time <= time ) {
+			const float frac = older->time < newer->time ?
+				(float)(time - older->time) / (float)(newer->time - older->time) : 0.0f;
+			SV_LerpVector( frac, older->origin, newer->origin, origin );
+			SV_LerpVector( frac, older->mins, newer->mins, mins );
+			SV_LerpVector( frac, older->maxs, newer->maxs, maxs );
+			return qtrue;
+		}
+		newer = older;
+	}
+
+	// older than anything we have, use the oldest record
+	VectorCopy( newer->origin, origin );
+	VectorCopy( newer->mins, mins );
+	VectorCopy( newer->maxs, maxs );
+
+	return qtrue;
+}
+
+
 /*
 ================
 SV_ClipHandleForEntity
@@ -145,6 +249,9 @@ void SV_ClearWorld()
 	Com_Memset( sv_worldSectors, 0, sizeof(sv_worldSectors) );
 	sv_numworldSectors = 0;
 
+	Com_Memset( sv_entityHistory, 0, sizeof(sv_entityHistory) );
+	SV_SetTraceTime( 0, ENTITYNUM_NONE );
+
 	// get world map bounds
 	vec3_t mins, maxs;
 	clipHandle_t h = CM_InlineModel( 0 );
@@ -435,6 +542,8 @@ typedef struct {
 #if defined( QC )
 	int			traceEntityNum; // the entity which is the subject of tracing
 #endif // QC
+	int			time;			// when non-zero, the client entities are tested at that time
+	int			timeSkipNum;	// the client entity that isn't time shifted
 } moveclip_t;
 
 
@@ -478,13 +587,120 @@ void SV_ClipToEntity( trace_t *trace, const vec3_t start, const vec3_t mins, con
 }
 
 
+// returns qtrue if the move shouldn't be clipped against the entity
+
+static qbool SV_IgnoreEntity( const moveclip_t* clip, const sharedEntity_t* touch, int passOwnerNum )
+{
+	// see if we should ignore this entity
+	if ( clip->passEntityNum != ENTITYNUM_NONE ) {
+		if ( touch->s.number == clip->passEntityNum ) {
+			return qtrue;	// don't clip against the pass entity
+		}
+		if ( touch->r.ownerNum == clip->passEntityNum ) {
+			return qtrue;	// don't clip against own missiles
+		}
+		if ( touch->r.ownerNum == passOwnerNum ) {
+			return qtrue;	// don't clip against other missiles from our owner
+		}
+	}
+
+#if defined( QC )
+	// filter out entities we should skip (i.e. friendly totems)
+	if ( clip->contentmask & CONTENTS_SKIP ) {
+		if ( SV_SkipEntityTrace( clip->traceEntityNum, touch->s.number ) ) {
+			return qtrue;
+		}
+	}
+#endif // QC
+
+	// if it doesn't have any brushes of a type we
+	// are looking for, ignore it
+	if ( ! ( clip->contentmask & touch->r.contents ) ) {
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
+
+static void SV_ClipMoveToEntity( moveclip_t* clip, const sharedEntity_t* touch, clipHandle_t clipHandle, const float* origin, const float* angles )
+{
+	trace_t trace;
+
+	CM_TransformedBoxTrace( &trace, clip->start, clip->end,
+		clip->mins, clip->maxs, clipHandle, clip->contentmask,
+		origin, angles, clip->capsule );
+
+	if ( trace.allsolid ) {
+		clip->trace.allsolid = qtrue;
+		trace.entityNum = touch->s.number;
+	} else if ( trace.startsolid ) {
+		clip->trace.startsolid = qtrue;
+		trace.entityNum = touch->s.number;
+	}
+
+	if ( trace.fraction < clip->trace.fraction ) {
+		qbool	oldStart;
+
+		// make sure we keep a startsolid from a previous trace
+		oldStart = clip->trace.startsolid;
+
+		trace.entityNum = touch->s.number;
+		clip->trace = trace;
+		clip->trace.startsolid |= oldStart;
+	}
+}
+
+
+// the client entities are tested at their recorded boxes instead of
+// the ones they are currently linked with, so they can't come from SV_AreaEntities
+
+static void SV_ClipMoveToEntityHistory( moveclip_t* clip, int passOwnerNum )
+{
+	for ( int i = 0; i < sv_maxclients->integer; ++i ) {
+		if ( clip->trace.allsolid ) {
+			return;
+		}
+
+		if ( i == clip->timeSkipNum ) {
+			continue;	// tested by SV_ClipMoveToEntities
+		}
+
+		const sharedEntity_t* const touch = SV_GentityNum( i );
+		if ( !touch->r.linked || touch->r.bmodel || SV_IgnoreEntity( clip, touch, passOwnerNum ) ) {
+			continue;
+		}
+
+		vec3_t origin, mins, maxs;
+		if ( !SV_EntityBoxAtTime( i, clip->time, origin, mins, maxs ) ) {
+			VectorCopy( touch->r.currentOrigin, origin );
+			VectorCopy( touch->r.mins, mins );
+			VectorCopy( touch->r.maxs, maxs );
+		}
+
+		// same test as SV_AreaEntities, with the epsilon SV_LinkEntity adds
+		int j;
+		for ( j = 0; j < 3; ++j ) {
+			if ( origin[j] + mins[j] - 1 > clip->boxmaxs[j] || origin[j] + maxs[j] + 1 < clip->boxmins[j] ) {
+				break;
+			}
+		}
+		if ( j < 3 ) {
+			continue;
+		}
+
+		const clipHandle_t clipHandle = CM_TempBoxModel( mins, maxs, ( touch->r.svFlags & SVF_CAPSULE ) != 0 );
+		SV_ClipMoveToEntity( clip, touch, clipHandle, origin, vec3_origin );
+	}
+}
+
+
 static void SV_ClipMoveToEntities( moveclip_t *clip )
 {
 	int			i, num;
 	int			touchlist[MAX_GENTITIES];
 	sharedEntity_t *touch;
 	int			passOwnerNum;
-	trace_t		trace;
 	clipHandle_t	clipHandle;
 	const float		*origin, *angles;
 
@@ -505,31 +721,12 @@ static void SV_ClipMoveToEntities( moveclip_t *clip )
 		}
 		touch = SV_GentityNum( touchlist[i] );
 
-		// see if we should ignore this entity
-		if ( clip->passEntityNum != ENTITYNUM_NONE ) {
-			if ( touchlist[i] == clip->passEntityNum ) {
-				continue;	// don't clip against the pass entity
-			}
-			if ( touch->r.ownerNum == clip->passEntityNum ) {
-				continue;	// don't clip against own missiles
-			}
-			if ( touch->r.ownerNum == passOwnerNum ) {
-				continue;	// don't clip against other missiles from our owner
-			}
-		}
-
-#if defined( QC )
-		// filter out entities we should skip (i.e. friendly totems)
-		if ( clip->contentmask & CONTENTS_SKIP ) {
-			if ( SV_SkipEntityTrace( clip->traceEntityNum, touch->s.number ) ) {
-				continue;
-			}
+		// time shifted clients are handled below
+		if ( clip->time && touchlist[i] < sv_maxclients->integer && !touch->r.bmodel && touchlist[i] != clip->timeSkipNum ) {
+			continue;
 		}
-#endif // QC
 
-		// if it doesn't have any brushes of a type we
-		// are looking for, ignore it
-		if ( ! ( clip->contentmask & touch->r.contents ) ) {
+		if ( SV_IgnoreEntity( clip, touch, passOwnerNum ) ) {
 			continue;
 		}
 
@@ -543,28 +740,11 @@ static void SV_ClipMoveToEntities( moveclip_t *clip )
 			angles = vec3_origin;	// boxes don't rotate
 		}
 
-		CM_TransformedBoxTrace( &trace, clip->start, clip->end,
-			clip->mins, clip->maxs, clipHandle, clip->contentmask,
-			origin, angles, clip->capsule );
-
-		if ( trace.allsolid ) {
-			clip->trace.allsolid = qtrue;
-			trace.entityNum = touch->s.number;
-		} else if ( trace.startsolid ) {
-			clip->trace.startsolid = qtrue;
-			trace.entityNum = touch->s.number;
-		}
-
-		if ( trace.fraction < clip->trace.fraction ) {
-			qbool	oldStart;
-
-			// make sure we keep a startsolid from a previous trace
-			oldStart = clip->trace.startsolid;
+		SV_ClipMoveToEntity( clip, touch, clipHandle, origin, angles );
+	}
 
-			trace.entityNum = touch->s.number;
-			clip->trace = trace;
-			clip->trace.startsolid |= oldStart;
-		}
+	if ( clip->time ) {
+		SV_ClipMoveToEntityHistory( clip, passOwnerNum );
 	}
 }
 
@@ -577,7 +757,24 @@ Moves the given mins/maxs volume through the world from start to end.
 passEntityNum and entities owned by passEntityNum are explicitly not checked.
 ==================
 */
+static void SV_TraceAtTimeSkip( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int time, int timeSkipNum );
+
 void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule ) {
+	SV_TraceAtTimeSkip( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, sv_traceTime, sv_traceSkipNum );
+}
+
+
+void SV_TraceAtTime( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int time ) {
+	SV_TraceAtTimeSkip( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, time, ENTITYNUM_NONE );
+}
+
+
+/*
+==================
+SV_TraceAtTimeSkip
+==================
+*/
+static void SV_TraceAtTimeSkip( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int time, int timeSkipNum ) {
 	moveclip_t	clip;
 	int			i;
 #if defined( QC )
@@ -616,6 +813,8 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 	clip.maxs = maxs;
 	clip.passEntityNum = passEntityNum;
 	clip.capsule = capsule;
+	clip.time = time;
+	clip.timeSkipNum = timeSkipNum;
 #if defined( QC )
 	clip.traceEntityNum = traceEntityNum;
 #endif // QC
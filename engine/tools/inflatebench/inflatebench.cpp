@@ -0,0 +1,219 @@
+// compares the single-shot inflate of unzip.cpp with the embedded zlib decoder
+// on every deflated entry of the pk3 files given on the command line
+
+#include "../../qcommon/q_shared.h"
+#include "../../qcommon/qcommon.h"
+#include "../../qcommon/unzip.h"
+#include <stdlib.h>
+#include <time.h>
+#if defined( _WIN32 )
+#include <windows.h>
+#endif
+
+
+// the few engine functions unzip.cpp needs
+
+void* Z_Malloc( int size )
+{
+	return calloc( size, 1 );
+}
+
+void Z_Free( void* ptr )
+{
+	free( ptr );
+}
+
+int Hunk_MemoryRemaining()
+{
+	return 0;
+}
+
+void* Hunk_AllocateTempMemory( int size )
+{
+	return malloc( size );
+}
+
+void Hunk_FreeTempMemory( void* buf )
+{
+	free( buf );
+}
+
+
+static double Bench_Seconds()
+{
+#if defined( _WIN32 )
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency( &freq );
+	QueryPerformanceCounter( &now );
+	return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+#endif
+}
+
+
+static unsigned int Bench_Short( const byte* p )
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+
+static unsigned int Bench_Long( const byte* p )
+{
+	return Bench_Short( p ) | (Bench_Short( p + 2 ) << 16);
+}
+
+
+static byte* Bench_LoadFile( const char* path, int* size )
+{
+	FILE* const file = fopen( path, "rb" );
+	if ( file == NULL )
+		return NULL;
+
+	fseek( file, 0, SEEK_END );
+	*size = (int)ftell( file );
+	fseek( file, 0, SEEK_SET );
+
+	byte* const data = (byte*)malloc( *size );
+	if ( data == NULL || fread( data, *size, 1, file ) != 1 ) {
+		free( data );
+		fclose( file );
+		return NULL;
+	}
+	fclose( file );
+
+	return data;
+}
+
+
+typedef struct {
+	int		entries;
+	double	compressedBytes;
+	double	bytes;
+	double	zlibSeconds;
+	double	fastSeconds;
+	int		failures;
+} benchStats_t;
+
+
+static void Bench_Pak( const char* path, int iterations, benchStats_t* stats )
+{
+	int size;
+	byte* const data = Bench_LoadFile( path, &size );
+	if ( data == NULL ) {
+		printf( "%s: can't read the file\n", path );
+		stats->failures++;
+		return;
+	}
+
+	// the end of central directory record is 22 bytes plus the comment
+	int eocd = -1;
+	for ( int i = size - 22; i >= 0 && i >= size - 22 - 0xFFFF; --i ) {
+		if ( Bench_Long( data + i ) == 0x06054b50 ) {
+			eocd = i;
+			break;
+		}
+	}
+	if ( eocd < 0 ) {
+		printf( "%s: not a zip file\n", path );
+		free( data );
+		stats->failures++;
+		return;
+	}
+
+	const int numEntries = (int)Bench_Short( data + eocd + 10 );
+	const unsigned int centralSize = Bench_Long( data + eocd + 12 );
+	const unsigned int centralOffset = Bench_Long( data + eocd + 16 );
+	const unsigned int byteBefore = (unsigned int)eocd - (centralOffset + centralSize);
+
+	unsigned int offset = centralOffset + byteBefore;
+	for ( int e = 0; e < numEntries; ++e ) {
+		if ( offset + 46 > (unsigned int)size || Bench_Long( data + offset ) != 0x02014b50 ) {
+			printf( "%s: broken central directory\n", path );
+			stats->failures++;
+			break;
+		}
+
+		const byte* const header = data + offset;
+		const unsigned int method = Bench_Short( header + 10 );
+		const unsigned int compressedSize = Bench_Long( header + 20 );
+		const unsigned int uncompressedSize = Bench_Long( header + 24 );
+		const unsigned int nameLength = Bench_Short( header + 28 );
+		const unsigned int local = Bench_Long( header + 42 ) + byteBefore;
+		offset += 46 + nameLength + Bench_Short( header + 30 ) + Bench_Short( header + 32 );
+
+		if ( method != 8 || uncompressedSize == 0 || local + 30 > (unsigned int)size )
+			continue;
+
+		const unsigned int start = local + 30 + Bench_Short( data + local + 26 ) + Bench_Short( data + local + 28 );
+		if ( start + compressedSize > (unsigned int)size )
+			continue;
+
+		byte* const zlibOut = (byte*)malloc( uncompressedSize );
+		byte* const fastOut = (byte*)malloc( uncompressedSize );
+		qbool ok = qtrue;
+
+		double t0 = Bench_Seconds();
+		for ( int i = 0; i < iterations; ++i )
+			ok &= unzInflateMemoryZlib( data + start, compressedSize, zlibOut, uncompressedSize ) == UNZ_OK;
+		double t1 = Bench_Seconds();
+		for ( int i = 0; i < iterations; ++i )
+			ok &= unzInflateMemory( data + start, compressedSize, fastOut, uncompressedSize ) == UNZ_OK;
+		double t2 = Bench_Seconds();
+
+		if ( !ok || memcmp( zlibOut, fastOut, uncompressedSize ) != 0 ) {
+			printf( "%s: mismatch on %.*s\n", path, (int)nameLength, (const char*)header + 46 );
+			stats->failures++;
+		}
+
+		stats->entries++;
+		stats->compressedBytes += (double)compressedSize * iterations;
+		stats->bytes += (double)uncompressedSize * iterations;
+		stats->zlibSeconds += t1 - t0;
+		stats->fastSeconds += t2 - t1;
+
+		free( zlibOut );
+		free( fastOut );
+	}
+
+	free( data );
+}
+
+
+int main( int argc, char** argv )
+{
+	int iterations = 3;
+	int firstPak = 1;
+
+	if ( argc > 2 && !strcmp( argv[1], "-n" ) ) {
+		iterations = atoi( argv[2] );
+		if ( iterations < 1 )
+			iterations = 1;
+		firstPak = 3;
+	}
+
+	if ( firstPak >= argc ) {
+		printf( "usage: %s [-n iterations] file.pk3 ...\n", argv[0] );
+		return 1;
+	}
+
+	benchStats_t stats;
+	memset( &stats, 0, sizeof( stats ) );
+	for ( int i = firstPak; i < argc; ++i )
+		Bench_Pak( argv[i], iterations, &stats );
+
+	const double mb = stats.bytes / ( 1024.0 * 1024.0 );
+	printf( "%d deflated entries, %d iterations, %.1f MB in, %.1f MB out\n",
+		stats.entries, iterations, stats.compressedBytes / ( 1024.0 * 1024.0 ), mb );
+	if ( stats.zlibSeconds > 0.0 && stats.fastSeconds > 0.0 ) {
+		printf( "zlib:    %8.3f s  %8.1f MB/s\n", stats.zlibSeconds, mb / stats.zlibSeconds );
+		printf( "fast:    %8.3f s  %8.1f MB/s\n", stats.fastSeconds, mb / stats.fastSeconds );
+		printf( "speedup: %8.2fx\n", stats.zlibSeconds / stats.fastSeconds );
+	}
+	if ( stats.failures )
+		printf( "%d failure(s)\n", stats.failures );
+
+	return stats.failures ? 1 : 0;
+}
@@ -0,0 +1,1184 @@
+// synthetic client load for a dedicated server: opens a number of UDP clients,
+// runs the challenge/connect/gamestate handshake for each of them, sends
+// randomized or scripted usercmd streams and reports what the server sends back
+//
+// usage: loadgen [options] address[:port]
+//
+// the server has to run with sv_pure 0 (the clients never send pak checksums)
+// and it has to see the clients as LAN addresses (no authorize server round-trip)
+
+#include "../../qcommon/q_shared.h"
+#include "../../qcommon/qcommon.h"
+#include <stdlib.h>
+#include <math.h>
+#include <setjmp.h>
+#include <time.h>
+#if defined( _WIN32 )
+#include <winsock2.h>
+#include <windows.h>
+typedef SOCKET lgSocket_t;
+typedef int socklen_t;
+#define LG_BAD_SOCKET INVALID_SOCKET
+#define LG_CloseSocket closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+typedef int lgSocket_t;
+#define LG_BAD_SOCKET -1
+#define LG_CloseSocket close
+#endif
+
+
+// same sizes as the real client
+#define LG_CMD_BACKUP			64
+#define LG_CMD_MASK				(LG_CMD_BACKUP - 1)
+#define LG_MAX_PARSE_ENTITIES	2048
+
+#define LG_RESEND_TIME			1000	// ms between challenge/connect retries
+#define LG_MAX_LATENCY			1000	// latency histogram size, in ms
+#define LG_MAX_SCRIPT_STEPS		1024
+
+
+typedef enum {
+	LGS_CHALLENGING,
+	LGS_CONNECTING,
+	LGS_CONNECTED,	// netchan is up, waiting for the gamestate
+	LGS_ACTIVE,
+	LGS_DROPPED
+} lgState_t;
+
+typedef struct {
+	qbool			valid;
+	int				messageNum;
+	int				serverTime;
+	playerState_t	ps;
+	int				parseEntitiesNum;
+	int				numEntities;
+} lgSnapshot_t;
+
+typedef struct {
+	int				realtime;
+	int				serverTime;
+	int				cmdNumber;
+} lgOutPacket_t;
+
+typedef struct {
+	int				msec;
+	int				forwardmove, rightmove, upmove;
+	int				buttons;
+	float			yawSpeed;	// degrees per second
+} lgScriptStep_t;
+
+typedef struct {
+	int				index;
+	lgSocket_t		socket;
+	lgState_t		state;
+	int				qport;
+	int				challenge;
+	int				lastResendTime;
+	netchan_t		netchan;
+
+	int				serverId;
+	int				clientNum;
+	int				checksumFeed;
+	int				serverMessageSequence;
+	int				serverCommandSequence;
+	int				reliableSequence;
+	int				reliableAcknowledge;
+	char			reliableCommands[MAX_RELIABLE_COMMANDS][MAX_STRING_CHARS];
+	char			serverCommands[MAX_RELIABLE_COMMANDS][MAX_STRING_CHARS];
+
+	entityState_t	entityBaselines[MAX_GENTITIES];
+	lgSnapshot_t	snap;
+	lgSnapshot_t	snapshots[PACKET_BACKUP];
+	entityState_t	parseEntities[LG_MAX_PARSE_ENTITIES];
+	int				parseEntitiesNum;
+	int				snapRealtime;	// when snap arrived, to extrapolate the server time
+
+	usercmd_t		cmds[LG_CMD_BACKUP];
+	int				cmdNumber;
+	lgOutPacket_t	outPackets[PACKET_BACKUP];
+	int				lastPacketSentTime;
+	int				nextPacketTime;
+
+	// movement
+	unsigned int	seed;
+	int				moveEndTime;
+	int				scriptStep;
+	lgScriptStep_t	move;
+	float			yaw;
+
+	// stats
+	qbool			wasActive;
+	int				activeTime;
+	int				snapshotCount;
+	int				fullSnapshots;
+	int				fullBytes;
+	int				maxFullBytes;
+	int				deltaSnapshots;
+	int				deltaBytes;
+	int				maxDeltaBytes;
+	int				badDeltas;
+	int				droppedPackets;
+} lgClient_t;
+
+
+static struct {
+	netadr_t		server;
+	int				numClients;
+	int				packetRate;		// client packets per second
+	int				snaps;
+	int				rate;
+	int				duration;		// seconds
+	qbool			verbose;
+	lgScriptStep_t	script[LG_MAX_SCRIPT_STEPS];
+	int				scriptSteps;
+} lg;
+
+static lgClient_t*	clients;
+static lgClient_t*	currentClient;	// the client Sys_SendPacket sends from
+
+static int			latencies[LG_MAX_LATENCY];
+static int			latencySamples;
+
+static jmp_buf		abortPacket;
+static qbool		abortPacketValid;
+
+
+// the few engine functions net_chan.cpp and msg.cpp need
+
+static cvar_t		nullCvar;
+cvar_t*				cl_shownet = &nullCvar;
+cvar_t*				cl_packetdelay = &nullCvar;
+cvar_t*				sv_packetdelay = &nullCvar;
+cvar_t*				com_timescale = &nullCvar;
+extern cvar_t*		qport;	// net_chan.cpp
+
+cvar_t* Cvar_Get( const char* var_name, const char* value, int flags )
+{
+	cvar_t* const var = (cvar_t*)calloc( 1, sizeof(cvar_t) );
+	var->name = CopyString( var_name );
+	var->string = CopyString( value );
+	var->value = atof( value );
+	var->integer = atoi( value );
+	var->flags = flags;
+	return var;
+}
+
+void Cvar_SetHelp( const char* var_name, const char* help )
+{
+}
+
+void Cvar_SetRange( const char* var_name, cvarType_t type, const char* min, const char* max )
+{
+}
+
+char* CopyString( const char* in )
+{
+	char* const out = (char*)malloc( strlen( in ) + 1 );
+	strcpy( out, in );
+	return out;
+}
+
+void* S_Malloc( int size )
+{
+	return malloc( size );
+}
+
+void Z_Free( void* ptr )
+{
+	free( ptr );
+}
+
+void QDECL Com_Printf( const char* fmt, ... )
+{
+	va_list argptr;
+	va_start( argptr, fmt );
+	vprintf( fmt, argptr );
+	va_end( argptr );
+}
+
+void QDECL Com_DPrintf( const char* fmt, ... )
+{
+}
+
+void QDECL Com_Error( int level, const char* fmt, ... )
+{
+	char msg[MAXPRINTMSG];
+	va_list argptr;
+	va_start( argptr, fmt );
+	Q_vsnprintf( msg, sizeof(msg), fmt, argptr );
+	va_end( argptr );
+
+	if ( abortPacketValid && level != ERR_FATAL ) {
+		printf( "client %d: %s\n", currentClient->index, msg );
+		longjmp( abortPacket, 1 );
+	}
+
+	printf( "ERROR: %s\n", msg );
+	exit( 1 );
+}
+
+qbool Com_JournalPacket( netsrc_t sock, int length, const void* data )
+{
+	return qtrue;
+}
+
+int Sys_Milliseconds()
+{
+	static qbool initialized = qfalse;
+#if defined( _WIN32 )
+	static LARGE_INTEGER freq, start;
+	LARGE_INTEGER now;
+	if ( !initialized ) {
+		QueryPerformanceFrequency( &freq );
+		QueryPerformanceCounter( &start );
+		initialized = qtrue;
+	}
+	QueryPerformanceCounter( &now );
+	return (int)( (now.QuadPart - start.QuadPart) * 1000 / freq.QuadPart );
+#else
+	static struct timespec start;
+	struct timespec now;
+	if ( !initialized ) {
+		clock_gettime( CLOCK_MONOTONIC, &start );
+		initialized = qtrue;
+	}
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (int)( (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 );
+#endif
+}
+
+void Sys_SendPacket( int length, const void* data, netadr_t to )
+{
+	struct sockaddr_in addr;
+	memset( &addr, 0, sizeof(addr) );
+	addr.sin_family = AF_INET;
+	addr.sin_port = to.port;
+	memcpy( &addr.sin_addr, to.ip, 4 );
+
+	sendto( currentClient->socket, (const char*)data, length, 0, (const struct sockaddr*)&addr, sizeof(addr) );
+}
+
+qbool Sys_StringToAdr( const char* s, netadr_t* a )
+{
+	const struct hostent* const h = gethostbyname( s );
+	if ( h == NULL || h->h_addrtype != AF_INET )
+		return qfalse;
+
+	Com_Memset( a, 0, sizeof(*a) );
+	a->type = NA_IP;
+	memcpy( a->ip, h->h_addr_list[0], 4 );
+	return qtrue;
+}
+
+
+// copied from common.cpp, it keys the usercmd deltas
+
+static int LG_HashKey( const char* string, int maxlen )
+{
+	int hash = 0;
+	for (int i = 0; i < maxlen && string[i] != '\0'; i++) {
+		hash += string[i] * (119 + i);
+	}
+	return (hash ^ (hash >> 10) ^ (hash >> 20));
+}
+
+
+static unsigned int LG_Random( lgClient_t* cl )
+{
+	// xorshift32, each client has its own sequence
+	cl->seed ^= cl->seed << 13;
+	cl->seed ^= cl->seed >> 17;
+	cl->seed ^= cl->seed << 5;
+	return cl->seed;
+}
+
+
+static void LG_Drop( lgClient_t* cl, const char* reason )
+{
+	if ( cl->state == LGS_DROPPED )
+		return;
+
+	printf( "client %d: dropped (%s)\n", cl->index, reason );
+	cl->state = LGS_DROPPED;
+}
+
+
+/*
+=========================================================================
+
+NETCHAN ENCODING
+
+mirrors cl_net_chan.cpp
+
+=========================================================================
+*/
+
+
+static void LG_XorMessage( msg_t* msg, int start, byte key, const char* string )
+{
+	int index = 0;
+	for (int i = start; i < msg->cursize; i++) {
+		if (!string[index])
+			index = 0;
+		if ((byte)string[index] > 127 || string[index] == '%') {
+			key ^= '.' << (i & 1);
+		} else {
+			key ^= string[index] << (i & 1);
+		}
+		index++;
+		msg->data[i] ^= key;
+	}
+}
+
+
+static void LG_Netchan_Encode( lgClient_t* cl, msg_t* msg )
+{
+	if ( msg->cursize <= CL_ENCODE_START )
+		return;
+
+	// serverId, messageAcknowledge, reliableAcknowledge
+	const int serverId = LittleLong( ((const int*)msg->data)[0] );
+	const int messageAcknowledge = LittleLong( ((const int*)msg->data)[1] );
+	const int reliableAcknowledge = LittleLong( ((const int*)msg->data)[2] );
+	const char* const string = cl->serverCommands[ reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ];
+
+	LG_XorMessage( msg, CL_ENCODE_START, (byte)(cl->challenge ^ serverId ^ messageAcknowledge), string );
+}
+
+
+static void LG_Netchan_Decode( lgClient_t* cl, msg_t* msg )
+{
+	const int reliableAcknowledge = LittleLong( *(const int*)(msg->data + msg->readcount) );
+	const char* const string = cl->reliableCommands[ reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ];
+
+	LG_XorMessage( msg, msg->readcount + CL_DECODE_START, (byte)(cl->challenge ^ LittleLong( *(const int*)msg->data )), string );
+}
+
+
+/*
+=========================================================================
+
+MESSAGE PARSING
+
+mirrors cl_parse.cpp, minus everything the cgame would need
+
+=========================================================================
+*/
+
+
+static void LG_DeltaEntity( lgClient_t* cl, msg_t* msg, lgSnapshot_t* frame, int newnum, const entityState_t* old, qbool unchanged )
+{
+	entityState_t* const state = &cl->parseEntities[cl->parseEntitiesNum & (LG_MAX_PARSE_ENTITIES-1)];
+
+	if ( unchanged ) {
+		*state = *old;
+	} else {
+		MSG_ReadDeltaEntity( msg, old, state, newnum );
+	}
+
+	if ( state->number == (MAX_GENTITIES-1) )
+		return;	// entity was delta removed
+
+	cl->parseEntitiesNum++;
+	frame->numEntities++;
+}
+
+
+static const entityState_t* LG_OldEntity( lgClient_t* cl, const lgSnapshot_t* oldframe, int oldindex, int* oldnum )
+{
+	if ( !oldframe || oldindex >= oldframe->numEntities ) {
+		*oldnum = 99999;
+		return NULL;
+	}
+
+	const entityState_t* const oldstate = &cl->parseEntities[(oldframe->parseEntitiesNum + oldindex) & (LG_MAX_PARSE_ENTITIES-1)];
+	*oldnum = oldstate->number;
+	return oldstate;
+}
+
+
+static void LG_ParsePacketEntities( lgClient_t* cl, msg_t* msg, const lgSnapshot_t* oldframe, lgSnapshot_t* newframe )
+{
+	newframe->parseEntitiesNum = cl->parseEntitiesNum;
+	newframe->numEntities = 0;
+
+	int oldindex = 0;
+	int oldnum;
+	const entityState_t* oldstate = LG_OldEntity( cl, oldframe, oldindex, &oldnum );
+
+	for (;;) {
+		const int newnum = MSG_ReadBits( msg, GENTITYNUM_BITS );
+		if ( newnum == (MAX_GENTITIES-1) )
+			break;
+
+		if ( msg->readcount > msg->cursize )
+			Com_Error( ERR_DROP, "LG_ParsePacketEntities: end of message" );
+
+		while ( oldnum < newnum ) {
+			LG_DeltaEntity( cl, msg, newframe, oldnum, oldstate, qtrue );
+			oldstate = LG_OldEntity( cl, oldframe, ++oldindex, &oldnum );
+		}
+
+		if ( oldnum == newnum ) {
+			LG_DeltaEntity( cl, msg, newframe, newnum, oldstate, qfalse );
+			oldstate = LG_OldEntity( cl, oldframe, ++oldindex, &oldnum );
+		} else {
+			LG_DeltaEntity( cl, msg, newframe, newnum, &cl->entityBaselines[newnum], qfalse );
+		}
+	}
+
+	while ( oldnum != 99999 ) {
+		LG_DeltaEntity( cl, msg, newframe, oldnum, oldstate, qtrue );
+		oldstate = LG_OldEntity( cl, oldframe, ++oldindex, &oldnum );
+	}
+}
+
+
+static void LG_ParseSnapshot( lgClient_t* cl, msg_t* msg, int now )
+{
+	lgSnapshot_t newSnap;
+	Com_Memset( &newSnap, 0, sizeof(newSnap) );
+	newSnap.serverTime = MSG_ReadLong( msg );
+	newSnap.messageNum = cl->serverMessageSequence;
+
+	const int deltaNum = MSG_ReadByte( msg );
+	const int deltaMessage = deltaNum ? newSnap.messageNum - deltaNum : -1;
+	MSG_ReadByte( msg ); // snapFlags
+
+	const lgSnapshot_t* old = NULL;
+	if ( deltaMessage <= 0 ) {
+		newSnap.valid = qtrue;
+	} else {
+		old = &cl->snapshots[deltaMessage & PACKET_MASK];
+		if ( old->valid && old->messageNum == deltaMessage &&
+			 cl->parseEntitiesNum - old->parseEntitiesNum <= LG_MAX_PARSE_ENTITIES-128 ) {
+			newSnap.valid = qtrue;
+		}
+	}
+
+	const int len = MSG_ReadByte( msg );
+	if ( len > MAX_MAP_AREA_BYTES )
+		Com_Error( ERR_DROP, "LG_ParseSnapshot: invalid size %d for areamask", len );
+	byte areamask[MAX_MAP_AREA_BYTES];
+	MSG_ReadData( msg, areamask, len );
+
+	MSG_ReadDeltaPlayerstate( msg, old ? &old->ps : NULL, &newSnap.ps );
+	LG_ParsePacketEntities( cl, msg, old, &newSnap );
+
+	if ( !newSnap.valid ) {
+		cl->badDeltas++;
+		return;
+	}
+
+	// invalidate anything between the last snapshot and this one
+	int oldMessageNum = cl->snap.messageNum + 1;
+	if ( newSnap.messageNum - oldMessageNum >= PACKET_BACKUP )
+		oldMessageNum = newSnap.messageNum - (PACKET_BACKUP - 1);
+	for ( ; oldMessageNum < newSnap.messageNum; oldMessageNum++ )
+		cl->snapshots[oldMessageNum & PACKET_MASK].valid = qfalse;
+
+	cl->snap = newSnap;
+	cl->snapshots[newSnap.messageNum & PACKET_MASK] = newSnap;
+	cl->snapRealtime = now;
+
+	// same ping estimate as the real client: the newest packet whose last
+	// usercmd has been run by the server
+	for (int i = 0; i < PACKET_BACKUP; i++) {
+		const lgOutPacket_t* const packet = &cl->outPackets[(cl->netchan.outgoingSequence - 1 - i) & PACKET_MASK];
+		if ( packet->cmdNumber > 0 && newSnap.ps.commandTime >= packet->serverTime ) {
+			const int latency = min( now - packet->realtime, LG_MAX_LATENCY - 1 );
+			latencies[latency]++;
+			latencySamples++;
+			break;
+		}
+	}
+
+	// the snapshot is always the last thing in a server message
+	cl->snapshotCount++;
+	if ( old ) {
+		cl->deltaSnapshots++;
+		cl->deltaBytes += msg->cursize;
+		cl->maxDeltaBytes = max( cl->maxDeltaBytes, msg->cursize );
+	} else {
+		cl->fullSnapshots++;
+		cl->fullBytes += msg->cursize;
+		cl->maxFullBytes = max( cl->maxFullBytes, msg->cursize );
+	}
+}
+
+
+static void LG_SystemInfoChanged( lgClient_t* cl, const char* systemInfo )
+{
+	cl->serverId = atoi( Info_ValueForKey( systemInfo, "sv_serverid" ) );
+}
+
+
+static void LG_ParseGamestate( lgClient_t* cl, msg_t* msg, int now )
+{
+	cl->serverCommandSequence = MSG_ReadLong( msg );
+
+	for (;;) {
+		const int cmd = MSG_ReadByte( msg );
+		if ( cmd == svc_EOF )
+			break;
+
+		if ( cmd == svc_configstring ) {
+			const int i = MSG_ReadShort( msg );
+			if ( i < 0 || i >= MAX_CONFIGSTRINGS )
+				Com_Error( ERR_DROP, "configstring > MAX_CONFIGSTRINGS" );
+			const char* const s = MSG_ReadBigString( msg );
+			if ( i == CS_SYSTEMINFO )
+				LG_SystemInfoChanged( cl, s );
+		} else if ( cmd == svc_baseline ) {
+			const int newnum = MSG_ReadBits( msg, GENTITYNUM_BITS );
+			if ( newnum < 0 || newnum >= MAX_GENTITIES )
+				Com_Error( ERR_DROP, "Baseline number out of range: %i", newnum );
+			entityState_t nullstate;
+			Com_Memset( &nullstate, 0, sizeof(nullstate) );
+			MSG_ReadDeltaEntity( msg, &nullstate, &cl->entityBaselines[newnum], newnum );
+		} else {
+			Com_Error( ERR_DROP, "LG_ParseGamestate: bad command byte" );
+		}
+	}
+
+	cl->clientNum = MSG_ReadLong( msg );
+	cl->checksumFeed = MSG_ReadLong( msg );
+
+	Com_Memset( &cl->snap, 0, sizeof(cl->snap) );
+	Com_Memset( cl->snapshots, 0, sizeof(cl->snapshots) );
+	cl->parseEntitiesNum = 0;
+	cl->snapRealtime = now;
+
+	if ( cl->state != LGS_ACTIVE ) {
+		cl->state = LGS_ACTIVE;
+		cl->wasActive = qtrue;
+		cl->activeTime = now;
+		cl->nextPacketTime = now;
+		if ( lg.verbose )
+			printf( "client %d: active as client number %d\n", cl->index, cl->clientNum );
+	}
+}
+
+
+static void LG_ParseCommandString( lgClient_t* cl, msg_t* msg )
+{
+	const int seq = MSG_ReadLong( msg );
+	const char* const s = MSG_ReadString( msg );
+
+	if ( cl->serverCommandSequence >= seq )
+		return;
+
+	cl->serverCommandSequence = seq;
+	Q_strncpyz( cl->serverCommands[seq & (MAX_RELIABLE_COMMANDS-1)], s, MAX_STRING_CHARS );
+
+	// the only commands the load generator cares about
+	if ( !strncmp( s, "disconnect", 10 ) ) {
+		LG_Drop( cl, s );
+	} else if ( !strncmp( s, "cs ", 3 ) && atoi( s + 3 ) == CS_SYSTEMINFO ) {
+		// cs <index> "<info string>"
+		char info[MAX_STRING_CHARS];
+		const char* const start = strchr( s, '"' );
+		if ( start != NULL ) {
+			Q_strncpyz( info, start + 1, sizeof(info) );
+			char* const end = strrchr( info, '"' );
+			if ( end != NULL )
+				*end = '\0';
+			LG_SystemInfoChanged( cl, info );
+		}
+	}
+}
+
+
+static void LG_ParseServerMessage( lgClient_t* cl, msg_t* msg, int now )
+{
+	MSG_Bitstream( msg );
+
+	cl->reliableAcknowledge = MSG_ReadLong( msg );
+	if ( cl->reliableAcknowledge < cl->reliableSequence - MAX_RELIABLE_COMMANDS )
+		cl->reliableAcknowledge = cl->reliableSequence;
+
+	for (;;) {
+		if ( msg->readcount > msg->cursize )
+			Com_Error( ERR_DROP, "LG_ParseServerMessage: read past end of server message" );
+
+		const int cmd = MSG_ReadByte( msg );
+		if ( cmd == svc_EOF )
+			break;
+
+		switch ( cmd ) {
+		case svc_nop:
+			break;
+		case svc_serverCommand:
+			LG_ParseCommandString( cl, msg );
+			break;
+		case svc_gamestate:
+			LG_ParseGamestate( cl, msg, now );
+			break;
+		case svc_snapshot:
+			LG_ParseSnapshot( cl, msg, now );
+			break;
+		default:
+			// svc_download included: we never ask for one
+			Com_Error( ERR_DROP, "LG_ParseServerMessage: illegible server message %d", cmd );
+			break;
+		}
+	}
+}
+
+
+/*
+=========================================================================
+
+CONNECTION
+
+=========================================================================
+*/
+
+
+static void LG_SendConnect( lgClient_t* cl, int now )
+{
+	char info[MAX_INFO_STRING];
+	info[0] = '\0';
+	Info_SetValueForKey( info, "name", va( "loadgen%02d", cl->index ) );
+	Info_SetValueForKey( info, "rate", va( "%d", lg.rate ) );
+	Info_SetValueForKey( info, "snaps", va( "%d", lg.snaps ) );
+	Info_SetValueForKey( info, "protocol", va( "%i", PROTOCOL_VERSION ) );
+	Info_SetValueForKey( info, "qport", va( "%i", cl->qport ) );
+	Info_SetValueForKey( info, "challenge", va( "%i", cl->challenge ) );
+
+	char data[MAX_INFO_STRING + 16];
+	Com_sprintf( data, sizeof(data), "connect \"%s\"", info );
+	const int len = strlen( data );
+
+	currentClient = cl;
+	NET_OutOfBandData( NS_CLIENT, lg.server, (const byte*)data, len + 1 );
+	cl->lastResendTime = now;
+}
+
+
+static void LG_ConnectionlessPacket( lgClient_t* cl, const char* s, int now )
+{
+	if ( !strncmp( s, "challengeResponse", 17 ) ) {
+		if ( cl->state != LGS_CHALLENGING )
+			return;
+		cl->challenge = atoi( s + 17 );
+		cl->state = LGS_CONNECTING;
+		LG_SendConnect( cl, now );
+	} else if ( !strncmp( s, "connectResponse", 15 ) ) {
+		if ( cl->state != LGS_CONNECTING )
+			return;
+		Netchan_Setup( NS_CLIENT, &cl->netchan, lg.server, cl->qport );
+		cl->state = LGS_CONNECTED;
+		cl->lastPacketSentTime = now - LG_RESEND_TIME;
+	} else if ( !strncmp( s, "print\n", 6 ) ) {
+		char reason[MAX_STRING_CHARS];
+		Q_strncpyz( reason, s + 6, sizeof(reason) );
+		const int len = strlen( reason );
+		if ( len > 0 && reason[len - 1] == '\n' )
+			reason[len - 1] = '\0';
+		if ( cl->state < LGS_CONNECTED )
+			LG_Drop( cl, reason );
+	} else if ( !strncmp( s, "disconnect", 10 ) ) {
+		LG_Drop( cl, "disconnected by the server" );
+	}
+}
+
+
+static void LG_PacketEvent( lgClient_t* cl, msg_t* msg, int now )
+{
+	if ( msg->cursize >= 4 && *(const int*)msg->data == -1 ) {
+		msg->data[msg->cursize] = '\0';
+		LG_ConnectionlessPacket( cl, (const char*)msg->data + 4, now );
+		return;
+	}
+
+	if ( cl->state < LGS_CONNECTED || cl->state == LGS_DROPPED || msg->cursize < 4 )
+		return;
+
+	if ( !Netchan_Process( &cl->netchan, msg ) )
+		return;
+
+	cl->droppedPackets += max( cl->netchan.dropped, 0 );
+	LG_Netchan_Decode( cl, msg );
+	cl->serverMessageSequence = LittleLong( *(const int*)msg->data );
+
+	currentClient = cl;
+	abortPacketValid = qtrue;
+	if ( setjmp( abortPacket ) ) {
+		abortPacketValid = qfalse;
+		LG_Drop( cl, "bad server message" );
+		return;
+	}
+	LG_ParseServerMessage( cl, msg, now );
+	abortPacketValid = qfalse;
+}
+
+
+/*
+=========================================================================
+
+USERCMD GENERATION
+
+=========================================================================
+*/
+
+
+static void LG_NextMove( lgClient_t* cl, int now )
+{
+	if ( lg.scriptSteps > 0 ) {
+		cl->move = lg.script[cl->scriptStep];
+		cl->scriptStep = (cl->scriptStep + 1) % lg.scriptSteps;
+	} else {
+		static const int speeds[3] = { -127, 0, 127 };
+		cl->move.msec = 250 + (int)(LG_Random( cl ) % 750);
+		cl->move.forwardmove = speeds[LG_Random( cl ) % 3];
+		cl->move.rightmove = speeds[LG_Random( cl ) % 3];
+		cl->move.upmove = (LG_Random( cl ) % 10 == 0) ? 127 : 0;
+		cl->move.buttons = (LG_Random( cl ) % 5 == 0) ? BUTTON_ATTACK : 0;
+		cl->move.yawSpeed = (float)((int)(LG_Random( cl ) % 361) - 180);
+	}
+
+	cl->moveEndTime = now + cl->move.msec;
+}
+
+
+static void LG_CreateCmd( lgClient_t* cl, int now )
+{
+	if ( now >= cl->moveEndTime )
+		LG_NextMove( cl, now );
+
+	const usercmd_t* const oldcmd = &cl->cmds[cl->cmdNumber & LG_CMD_MASK];
+	cl->cmdNumber++;
+	usercmd_t* const cmd = &cl->cmds[cl->cmdNumber & LG_CMD_MASK];
+	Com_Memset( cmd, 0, sizeof(*cmd) );
+
+	// extrapolate the server time from the last snapshot and keep it increasing,
+	// the server drops commands that don't move forward
+	cmd->serverTime = max( cl->snap.serverTime + (now - cl->snapRealtime), oldcmd->serverTime + 1 );
+
+	cl->yaw += cl->move.yawSpeed * (float)(now - cl->lastPacketSentTime) * 0.001f;
+	cl->yaw = AngleMod( cl->yaw );
+	cmd->angles[YAW] = ANGLE2SHORT( cl->yaw );
+	cmd->forwardmove = (signed char)cl->move.forwardmove;
+	cmd->rightmove = (signed char)cl->move.rightmove;
+	cmd->upmove = (signed char)cl->move.upmove;
+	cmd->buttons = cl->move.buttons;
+}
+
+
+static void LG_WritePacket( lgClient_t* cl, int now )
+{
+	msg_t buf;
+	byte data[MAX_MSGLEN];
+	MSG_Init( &buf, data, sizeof(data) );
+	MSG_Bitstream( &buf );
+
+	MSG_WriteLong( &buf, cl->serverId );
+	MSG_WriteLong( &buf, cl->serverMessageSequence );
+	MSG_WriteLong( &buf, cl->serverCommandSequence );
+
+	for (int i = cl->reliableAcknowledge + 1; i <= cl->reliableSequence; i++) {
+		MSG_WriteByte( &buf, clc_clientCommand );
+		MSG_WriteLong( &buf, i );
+		MSG_WriteString( &buf, cl->reliableCommands[i & (MAX_RELIABLE_COMMANDS-1)] );
+	}
+
+	// resend the commands of the previous packet too, like cl_packetdup 1
+	const int oldPacketNum = (cl->netchan.outgoingSequence - 2) & PACKET_MASK;
+	const int count = min( cl->cmdNumber - cl->outPackets[oldPacketNum].cmdNumber, MAX_PACKET_USERCMDS );
+	const usercmd_t nullcmd = { 0 };
+	const usercmd_t* oldcmd = &nullcmd;
+
+	if ( count >= 1 ) {
+		const qbool delta = cl->snap.valid && cl->serverMessageSequence == cl->snap.messageNum;
+		MSG_WriteByte( &buf, delta ? clc_move : clc_moveNoDelta );
+		MSG_WriteByte( &buf, count );
+
+		int key = cl->checksumFeed;
+		key ^= cl->serverMessageSequence;
+		key ^= LG_HashKey( cl->serverCommands[cl->serverCommandSequence & (MAX_RELIABLE_COMMANDS-1)], 32 );
+
+		for (int i = 0; i < count; i++) {
+			usercmd_t* const cmd = &cl->cmds[(cl->cmdNumber - count + i + 1) & LG_CMD_MASK];
+			MSG_WriteDeltaUsercmdKey( &buf, key, oldcmd, cmd );
+			oldcmd = cmd;
+		}
+	}
+
+	lgOutPacket_t* const packet = &cl->outPackets[cl->netchan.outgoingSequence & PACKET_MASK];
+	packet->realtime = now;
+	packet->serverTime = oldcmd->serverTime;
+	packet->cmdNumber = cl->cmdNumber;
+	cl->lastPacketSentTime = now;
+
+	MSG_WriteByte( &buf, clc_EOF );
+	LG_Netchan_Encode( cl, &buf );
+
+	// net_qport is what Netchan_Transmit writes into the header
+	currentClient = cl;
+	qport->integer = cl->qport;
+	Netchan_Transmit( &cl->netchan, buf.cursize, buf.data );
+	while ( cl->netchan.unsentFragments )
+		Netchan_TransmitNextFragment( &cl->netchan );
+}
+
+
+static void LG_ClientFrame( lgClient_t* cl, int now )
+{
+	switch ( cl->state ) {
+	case LGS_CHALLENGING:
+		if ( now - cl->lastResendTime >= LG_RESEND_TIME ) {
+			currentClient = cl;
+			NET_OutOfBandPrint( NS_CLIENT, lg.server, "getchallenge" );
+			cl->lastResendTime = now;
+		}
+		break;
+
+	case LGS_CONNECTING:
+		if ( now - cl->lastResendTime >= LG_RESEND_TIME )
+			LG_SendConnect( cl, now );
+		break;
+
+	case LGS_CONNECTED:
+		// same as the real client: one packet a second until the gamestate arrives
+		if ( now - cl->lastPacketSentTime >= LG_RESEND_TIME )
+			LG_WritePacket( cl, now );
+		break;
+
+	case LGS_ACTIVE:
+		if ( now >= cl->nextPacketTime ) {
+			LG_CreateCmd( cl, now );
+			LG_WritePacket( cl, now );
+			cl->nextPacketTime += 1000 / lg.packetRate;
+			if ( cl->nextPacketTime < now )
+				cl->nextPacketTime = now + 1000 / lg.packetRate;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+static void LG_Disconnect( lgClient_t* cl, int now )
+{
+	if ( cl->state != LGS_CONNECTED && cl->state != LGS_ACTIVE )
+		return;
+
+	// the real client sends it 3 times in case some get dropped
+	cl->reliableSequence++;
+	Q_strncpyz( cl->reliableCommands[cl->reliableSequence & (MAX_RELIABLE_COMMANDS-1)], "disconnect", MAX_STRING_CHARS );
+	for (int i = 0; i < 3; i++)
+		LG_WritePacket( cl, now );
+}
+
+
+/*
+=========================================================================
+
+SETUP AND REPORT
+
+=========================================================================
+*/
+
+
+static lgSocket_t LG_OpenSocket()
+{
+	const lgSocket_t s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( s == LG_BAD_SOCKET )
+		return LG_BAD_SOCKET;
+
+	struct sockaddr_in addr;
+	memset( &addr, 0, sizeof(addr) );
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = INADDR_ANY;
+	addr.sin_port = 0;
+	if ( bind( s, (const struct sockaddr*)&addr, sizeof(addr) ) != 0 ) {
+		LG_CloseSocket( s );
+		return LG_BAD_SOCKET;
+	}
+
+#if defined( _WIN32 )
+	u_long nonBlocking = 1;
+	ioctlsocket( s, FIONBIO, &nonBlocking );
+#else
+	fcntl( s, F_SETFL, fcntl( s, F_GETFL, 0 ) | O_NONBLOCK );
+#endif
+
+	return s;
+}
+
+
+static void LG_ReadPackets( int timeoutMS, int now )
+{
+	fd_set fds;
+	FD_ZERO( &fds );
+	int maxSocket = 0;
+	for (int i = 0; i < lg.numClients; i++) {
+		FD_SET( clients[i].socket, &fds );
+		maxSocket = max( maxSocket, (int)clients[i].socket );
+	}
+
+	struct timeval tv;
+	tv.tv_sec = 0;
+	tv.tv_usec = timeoutMS * 1000;
+	if ( select( maxSocket + 1, &fds, NULL, NULL, &tv ) <= 0 )
+		return;
+
+	// +1 for the terminator of connectionless packets
+	static byte data[MAX_MSGLEN + 1];
+	for (int i = 0; i < lg.numClients; i++) {
+		lgClient_t* const cl = &clients[i];
+		if ( !FD_ISSET( cl->socket, &fds ) )
+			continue;
+
+		for (;;) {
+			struct sockaddr_in from;
+			socklen_t fromLen = sizeof(from);
+			const int length = recvfrom( cl->socket, (char*)data, MAX_MSGLEN, 0, (struct sockaddr*)&from, &fromLen );
+			if ( length <= 0 )
+				break;
+			if ( memcmp( &from.sin_addr, lg.server.ip, 4 ) || from.sin_port != lg.server.port )
+				continue;
+
+			msg_t msg;
+			MSG_Init( &msg, data, MAX_MSGLEN );
+			msg.cursize = length;
+			LG_PacketEvent( cl, &msg, now );
+		}
+	}
+}
+
+
+static qbool LG_LoadScript( const char* path )
+{
+	FILE* const file = fopen( path, "r" );
+	if ( file == NULL )
+		return qfalse;
+
+	char line[256];
+	while ( lg.scriptSteps < LG_MAX_SCRIPT_STEPS && fgets( line, sizeof(line), file ) ) {
+		lgScriptStep_t* const step = &lg.script[lg.scriptSteps];
+		if ( line[0] == '#' || line[0] == '/' )
+			continue;
+		if ( sscanf( line, "%d %d %d %d %d %f", &step->msec, &step->forwardmove, &step->rightmove,
+					 &step->upmove, &step->buttons, &step->yawSpeed ) != 6 )
+			continue;
+		if ( step->msec <= 0 )
+			continue;
+		step->forwardmove = Com_Clamp( -127, 127, step->forwardmove );
+		step->rightmove = Com_Clamp( -127, 127, step->rightmove );
+		step->upmove = Com_Clamp( -127, 127, step->upmove );
+		lg.scriptSteps++;
+	}
+
+	fclose( file );
+	return lg.scriptSteps > 0;
+}
+
+
+static int LG_Percentile( float fraction )
+{
+	const int target = (int)ceilf( (float)latencySamples * fraction );
+	int count = 0;
+	for (int i = 0; i < LG_MAX_LATENCY; i++) {
+		count += latencies[i];
+		if ( count >= target )
+			return i;
+	}
+	return LG_MAX_LATENCY - 1;
+}
+
+
+static void LG_Report( int now )
+{
+	int active = 0, dropped = 0;
+	int snapshots = 0, fullSnapshots = 0, deltaSnapshots = 0;
+	double fullBytes = 0.0, deltaBytes = 0.0, activeSeconds = 0.0;
+	int maxFullBytes = 0, maxDeltaBytes = 0, badDeltas = 0, droppedPackets = 0;
+	float minRate = 0.0f, maxRate = 0.0f;
+
+	for (int i = 0; i < lg.numClients; i++) {
+		const lgClient_t* const cl = &clients[i];
+		if ( cl->state == LGS_DROPPED )
+			dropped++;
+		if ( !cl->wasActive )
+			continue;
+
+		const float seconds = (float)max( now - cl->activeTime, 1 ) / 1000.0f;
+		const float snapRate = (float)cl->snapshotCount / seconds;
+		if ( active == 0 || snapRate < minRate )
+			minRate = snapRate;
+		if ( active == 0 || snapRate > maxRate )
+			maxRate = snapRate;
+		active++;
+
+		activeSeconds += seconds;
+		snapshots += cl->snapshotCount;
+		fullSnapshots += cl->fullSnapshots;
+		fullBytes += cl->fullBytes;
+		maxFullBytes = max( maxFullBytes, cl->maxFullBytes );
+		deltaSnapshots += cl->deltaSnapshots;
+		deltaBytes += cl->deltaBytes;
+		maxDeltaBytes = max( maxDeltaBytes, cl->maxDeltaBytes );
+		badDeltas += cl->badDeltas;
+		droppedPackets += cl->droppedPackets;
+
+		if ( lg.verbose ) {
+			printf( "client %2d: %6d snapshots %6.1f/s  %5d full  %6d delta  %d bad deltas  %d dropped packets\n",
+					cl->index, cl->snapshotCount, snapRate, cl->fullSnapshots, cl->deltaSnapshots, cl->badDeltas, cl->droppedPackets );
+		}
+	}
+
+	printf( "\n%d/%d clients got in, %d dropped\n", active, lg.numClients, dropped );
+	if ( active == 0 )
+		return;
+
+	printf( "snapshots        %d, %.1f/s per client (min %.1f max %.1f)\n",
+			snapshots, (double)snapshots / activeSeconds, minRate, maxRate );
+	printf( "delta snapshots  %d, avg %.0f bytes, max %d bytes\n",
+			deltaSnapshots, deltaSnapshots ? deltaBytes / deltaSnapshots : 0.0, maxDeltaBytes );
+	printf( "full snapshots   %d, avg %.0f bytes, max %d bytes\n",
+			fullSnapshots, fullSnapshots ? fullBytes / fullSnapshots : 0.0, maxFullBytes );
+	printf( "bad deltas       %d\n", badDeltas );
+	printf( "dropped packets  %d\n", droppedPackets );
+	if ( latencySamples > 0 ) {
+		printf( "latency (ms)     p50 %d  p90 %d  p99 %d  max %d  (%d samples)\n",
+				LG_Percentile( 0.5f ), LG_Percentile( 0.9f ), LG_Percentile( 0.99f ),
+				LG_Percentile( 1.0f ), latencySamples );
+	}
+}
+
+
+static void LG_PrintUsage()
+{
+	printf( "usage: loadgen [options] address[:port]\n" );
+	printf( "  -c <count>    number of clients (default 8, max %d)\n", MAX_CLIENTS );
+	printf( "  -p <rate>     client packets per second (default 60)\n" );
+	printf( "  -s <snaps>    requested snapshots per second (default 40)\n" );
+	printf( "  -r <rate>     requested bytes per second (default 25000)\n" );
+	printf( "  -t <seconds>  test duration (default 30)\n" );
+	printf( "  -f <script>   usercmd script instead of random movement, one step per line:\n" );
+	printf( "                <msec> <forward> <right> <up> <buttons> <yaw degrees/s>\n" );
+	printf( "  -v            per-client report\n" );
+}
+
+
+int main( int argc, char** argv )
+{
+	lg.numClients = 8;
+	lg.packetRate = 60;
+	lg.snaps = 40;
+	lg.rate = 25000;
+	lg.duration = 30;
+
+	const char* address = NULL;
+	for (int i = 1; i < argc; i++) {
+		const char* const arg = argv[i];
+		if ( arg[0] != '-' ) {
+			address = arg;
+			continue;
+		}
+		if ( !strcmp( arg, "-v" ) ) {
+			lg.verbose = qtrue;
+			continue;
+		}
+		if ( i + 1 >= argc ) {
+			LG_PrintUsage();
+			return 1;
+		}
+		const char* const value = argv[++i];
+		if ( !strcmp( arg, "-c" ) ) {
+			lg.numClients = Com_Clamp( 1, MAX_CLIENTS, atoi( value ) );
+		} else if ( !strcmp( arg, "-p" ) ) {
+			lg.packetRate = Com_Clamp( 1, 1000, atoi( value ) );
+		} else if ( !strcmp( arg, "-s" ) ) {
+			lg.snaps = Com_Clamp( 1, 1000, atoi( value ) );
+		} else if ( !strcmp( arg, "-r" ) ) {
+			lg.rate = Com_Clamp( 1000, 1000000, atoi( value ) );
+		} else if ( !strcmp( arg, "-t" ) ) {
+			lg.duration = Com_Clamp( 1, 3600, atoi( value ) );
+		} else if ( !strcmp( arg, "-f" ) ) {
+			if ( !LG_LoadScript( value ) ) {
+				printf( "ERROR: couldn't load a usercmd script from %s\n", value );
+				return 1;
+			}
+		} else {
+			LG_PrintUsage();
+			return 1;
+		}
+	}
+
+	if ( address == NULL ) {
+		LG_PrintUsage();
+		return 1;
+	}
+
+#if defined( _WIN32 )
+	WSADATA wsaData;
+	WSAStartup( MAKEWORD( 2, 2 ), &wsaData );
+#endif
+
+	// "localhost" would be turned into the loopback pseudo-address
+	if ( !NET_StringToAdr( Q_stricmp( address, "localhost" ) ? address : "127.0.0.1", &lg.server ) ) {
+		printf( "ERROR: couldn't resolve %s\n", address );
+		return 1;
+	}
+
+	Netchan_Init( 0 );
+
+	clients = (lgClient_t*)calloc( lg.numClients, sizeof(lgClient_t) );
+	if ( clients == NULL ) {
+		printf( "ERROR: not enough memory for %d clients\n", lg.numClients );
+		return 1;
+	}
+
+	const int start = Sys_Milliseconds();
+	for (int i = 0; i < lg.numClients; i++) {
+		lgClient_t* const cl = &clients[i];
+		cl->index = i;
+		cl->socket = LG_OpenSocket();
+		if ( cl->socket == LG_BAD_SOCKET ) {
+			printf( "ERROR: couldn't open a UDP socket for client %d\n", i );
+			return 1;
+		}
+		cl->qport = ( (start + i * 1021) & 0x7fff ) | 1;
+		cl->seed = 0x9E3779B9u * (unsigned int)(i + 1);
+		// spread the connects a little
+		cl->lastResendTime = start - LG_RESEND_TIME + i * 20;
+		cl->state = LGS_CHALLENGING;
+	}
+
+	printf( "%d clients -> %s for %d seconds, %d packets/s, snaps %d, rate %d, %s usercmds\n",
+			lg.numClients, NET_AdrToString( lg.server ), lg.duration, lg.packetRate, lg.snaps, lg.rate,
+			lg.scriptSteps ? "scripted" : "random" );
+
+	const int end = start + lg.duration * 1000;
+	int now = start;
+	while ( now < end ) {
+		for (int i = 0; i < lg.numClients; i++)
+			LG_ClientFrame( &clients[i], now );
+		LG_ReadPackets( 1, Sys_Milliseconds() );
+		now = Sys_Milliseconds();
+	}
+
+	for (int i = 0; i < lg.numClients; i++)
+		LG_Disconnect( &clients[i], now );
+
+	LG_Report( now );
+
+	for (int i = 0; i < lg.numClients; i++)
+		LG_CloseSocket( clients[i].socket );
+	free( clients );
+
+	return 0;
+}
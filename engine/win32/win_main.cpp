@@ -141,6 +141,276 @@ void Sys_Mkdir( const char* path )
 }
 
 
+const void* Sys_MapFileRead( const char* path, int* size )
+{
+	*size = 0;
+
+	const HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart <= 0 || fileSize.QuadPart > 0x7FFFFFFF ) {
+		CloseHandle( file );
+		return NULL;
+	}
+
+	// the view keeps its own references to the file and the mapping object
+	const HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	CloseHandle( file );
+	if ( mapping == NULL )
+		return NULL;
+
+	const void* const data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+	if ( data == NULL )
+		return NULL;
+
+	*size = (int)fileSize.QuadPart;
+
+	return data;
+}
+
+
+void Sys_UnmapFile( const void* data, int size )
+{
+	if ( data != NULL )
+		UnmapViewOfFile( data );
+}
+
+
+#define MAX_PARALLEL_THREADS	16
+
+typedef struct {
+	void		(*func)( void* data, int index );
+	void*		data;
+	int			count;
+	volatile LONG next;
+} parallelJob_t;
+
+
+static DWORD WINAPI Sys_ParallelWorker( LPVOID arg )
+{
+	parallelJob_t* const job = (parallelJob_t*)arg;
+
+	for (;;) {
+		const int index = (int)InterlockedIncrement( &job->next ) - 1;
+		if ( index >= job->count )
+			break;
+		job->func( job->data, index );
+	}
+
+	return 0;
+}
+
+
+void Sys_ParallelFor( int count, int maxThreads, void (*func)( void* data, int index ), void* data )
+{
+	if ( maxThreads <= 0 ) {
+		SYSTEM_INFO info;
+		GetSystemInfo( &info );
+		maxThreads = (int)info.dwNumberOfProcessors;
+	}
+	maxThreads = min( maxThreads, min( count, MAX_PARALLEL_THREADS ) );
+
+	parallelJob_t job;
+	job.func = func;
+	job.data = data;
+	job.count = count;
+	job.next = 0;
+
+	// the calling thread is a worker too, so failing to start threads only costs speed
+	HANDLE threads[MAX_PARALLEL_THREADS];
+	int numThreads = 0;
+	for ( int i = 1; i < maxThreads; ++i ) {
+		threads[numThreads] = CreateThread( NULL, 0, Sys_ParallelWorker, &job, 0, NULL );
+		if ( threads[numThreads] == NULL )
+			break;
+		numThreads++;
+	}
+
+	Sys_ParallelWorker( &job );
+
+	if ( numThreads > 0 )
+		WaitForMultipleObjects( (DWORD)numThreads, threads, TRUE, INFINITE );
+	for ( int i = 0; i < numThreads; ++i ) {
+		CloseHandle( threads[i] );
+	}
+}
+
+
+typedef struct {
+	HANDLE		handle;
+	void		(*func)( void* data );
+	void*		data;
+} sysThread_t;
+
+
+static DWORD WINAPI Sys_ThreadMain( LPVOID arg )
+{
+	sysThread_t* const thread = (sysThread_t*)arg;
+
+	thread->func( thread->data );
+
+	return 0;
+}
+
+
+void* Sys_StartThread( void (*func)( void* data ), void* data )
+{
+	sysThread_t* const thread = Z_New<sysThread_t>();
+	thread->func = func;
+	thread->data = data;
+
+	thread->handle = CreateThread( NULL, 0, Sys_ThreadMain, thread, 0, NULL );
+	if ( thread->handle == NULL ) {
+		Z_Free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+
+void Sys_JoinThread( void* thread )
+{
+	WaitForSingleObject( ((sysThread_t*)thread)->handle, INFINITE );
+	CloseHandle( ((sysThread_t*)thread)->handle );
+	Z_Free( thread );
+}
+
+
+void* Sys_CreateEvent()
+{
+	return CreateEventA( NULL, FALSE, FALSE, NULL );
+}
+
+
+void Sys_DestroyEvent( void* event )
+{
+	CloseHandle( (HANDLE)event );
+}
+
+
+void Sys_SignalEvent( void* event )
+{
+	SetEvent( (HANDLE)event );
+}
+
+
+void Sys_WaitEvent( void* event )
+{
+	WaitForSingleObject( (HANDLE)event, INFINITE );
+}
+
+
+void* Sys_AllocLargeMemory( int size, int hugePages, const char** description )
+{
+	// large pages require SeLockMemoryPrivilege, which users don't normally have
+	*description = "regular pages";
+
+	return calloc( size, 1 );
+}
+
+
+// named mappings live as long as a view or a handle references them,
+// so they go away on their own once the last process is done with them
+
+void* Sys_CreateSharedMemory( const char* name, int size )
+{
+	const HANDLE mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, va( "Local\\%s", name + 1 ) );
+	if ( mapping == NULL )
+		return NULL;
+
+	if ( GetLastError() == ERROR_ALREADY_EXISTS ) {
+		CloseHandle( mapping );
+		return NULL;
+	}
+
+	void* const data = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size );
+	CloseHandle( mapping );
+
+	return data;
+}
+
+
+const void* Sys_OpenSharedMemory( const char* name, int size )
+{
+	const HANDLE mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, va( "Local\\%s", name + 1 ) );
+	if ( mapping == NULL )
+		return NULL;
+
+	const void* const data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+	if ( data == NULL )
+		return NULL;
+
+	MEMORY_BASIC_INFORMATION info;
+	if ( VirtualQuery( data, &info, sizeof(info) ) == 0 || info.RegionSize < (SIZE_T)size ) {
+		UnmapViewOfFile( data );
+		return NULL;
+	}
+
+	return data;
+}
+
+
+void Sys_SealSharedMemory( void* data, int size )
+{
+	DWORD oldProtect;
+	VirtualProtect( data, (SIZE_T)size, PAGE_READONLY, &oldProtect );
+}
+
+
+void Sys_CloseSharedMemory( const void* data, int size )
+{
+	UnmapViewOfFile( data );
+}
+
+
+void Sys_RemoveSharedMemory( const char* name )
+{
+}
+
+
+int Sys_SharedMemoryAge( const char* name )
+{
+	return -1;
+}
+
+
+int Sys_RemoveAllSharedMemory( const char* prefix )
+{
+	return 0;
+}
+
+
+void Sys_MemoryBarrier()
+{
+	MemoryBarrier();
+}
+
+
+int Sys_GetProcessID()
+{
+	return (int)GetCurrentProcessId();
+}
+
+
+qbool Sys_IsProcessAlive( int pid )
+{
+	const HANDLE process = OpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid );
+	if ( process == NULL )
+		return GetLastError() == ERROR_ACCESS_DENIED;
+
+	DWORD exitCode;
+	const BOOL result = GetExitCodeProcess( process, &exitCode );
+	CloseHandle( process );
+
+	return !result || exitCode == STILL_ACTIVE;
+}
+
+
 const char* Sys_Cwd()
 {
 	static char cwd[MAX_OSPATH];
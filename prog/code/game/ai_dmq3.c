@@ -5280,19 +5280,22 @@ void BotDeathmatchAI(bot_state_t *bs, float thinktime) {
 		//check for air
 		BotCheckAir(bs);
 	}
-	//check the console messages
-	BotCheckConsoleMessages(bs);
-	//if not in the intermission and not in observer mode
-	if (!BotIntermission(bs) && !BotIsObserver(bs)) {
-		//do team AI
-		BotTeamAI(bs);
+	//chat and team orders wait when the bot think budget is exhausted
+	if (!bs->deferlowpriority) {
+		//check the console messages
+		BotCheckConsoleMessages(bs);
+		//if not in the intermission and not in observer mode
+		if (!BotIntermission(bs) && !BotIsObserver(bs)) {
+			//do team AI
+			BotTeamAI(bs);
+		}
 	}
 	//if the bot has no ai node
 	if (!bs->ainode) {
 		AIEnter_Seek_LTG(bs, "BotDeathmatchAI: no ai node");
 	}
 	//if the bot entered the game less than 8 seconds ago
-	if (!bs->entergamechat && bs->entergame_time > FloatTime() - 8) {
+	if (!bs->deferlowpriority && !bs->entergamechat && bs->entergame_time > FloatTime() - 8) {
 		if (BotChat_EnterGame(bs)) {
 			bs->stand_time = FloatTime() + BotChatTime(bs);
 			AIEnter_Stand(bs, "BotDeathmatchAI: chat enter game");
@@ -69,6 +69,10 @@ int bot_interbreed;
 int bot_interbreedmatchcount;
 //
 vmCvar_t bot_thinktime;
+vmCvar_t bot_thinkbudget;
+#if defined( QC )
+static qboolean bot_microseconds;	//the engine has trap_Microseconds
+#endif
 vmCvar_t bot_memorydump;
 vmCvar_t bot_saveroutingcache;
 vmCvar_t bot_pause;
@@ -1402,19 +1406,39 @@ int BotAILoadMap( int restart ) {
 void ProximityMine_Trigger( gentity_t *trigger, gentity_t *other, trace_t *trace );
 #endif
 
+/*
+==================
+BotThinkClock
+
+microseconds for the think budget, most thinks take well under a millisecond
+so without the engine extension the costs are very rough
+==================
+*/
+static int BotThinkClock( void ) {
+#if defined( QC )
+	if ( bot_microseconds ) {
+		return trap_Microseconds();
+	}
+#endif
+	return trap_Milliseconds() * 1000;
+}
+
 /*
 ==================
 BotAIStartFrame
 ==================
 */
 int BotAIStartFrame(int time) {
-	int i;
+	int i, n, first;
 	gentity_t	*ent;
 	bot_entitystate_t state;
 	int elapsed_time, thinktime;
+	int budget, starttime, thinkstart, used, cost;
+	bot_state_t *bs;
 	static int local_time;
 	static int botlib_residual;
 	static int lastbotthink_time;
+	static int botthink_first;
 
 	G_CheckBotSpawn();
 
@@ -1424,6 +1448,7 @@ int BotAIStartFrame(int time) {
 	trap_Cvar_Update(&bot_nochat);
 	trap_Cvar_Update(&bot_testrchat);
 	trap_Cvar_Update(&bot_thinktime);
+	trap_Cvar_Update(&bot_thinkbudget);
 	trap_Cvar_Update(&bot_memorydump);
 	trap_Cvar_Update(&bot_saveroutingcache);
 	trap_Cvar_Update(&bot_pause);
@@ -1560,23 +1585,52 @@ int BotAIStartFrame(int time) {
 	floattime = trap_AAS_Time();
 
 	// execute scheduled bot AI
-	for( i = 0; i < MAX_CLIENTS; i++ ) {
-		if( !botstates[i] || !botstates[i]->inuse ) {
+	// with bot_thinkbudget set a bot whose expected think cost does not fit
+	// in what is left of the budget is postponed to the next frame, a bot
+	// that already waited a full think interval thinks anyway but skips
+	// chat and team AI. Postponed bots are the first to think next frame.
+	budget = bot_thinkbudget.integer * 1000;
+	starttime = BotThinkClock();
+	first = -1;
+	for( n = 0; n < MAX_CLIENTS; n++ ) {
+		i = (botthink_first + n) % MAX_CLIENTS;
+		bs = botstates[i];
+		if( !bs || !bs->inuse ) {
 			continue;
 		}
 		//
-		botstates[i]->botthink_residual += elapsed_time;
+		bs->botthink_residual += elapsed_time;
 		//
-		if ( botstates[i]->botthink_residual >= thinktime ) {
-			botstates[i]->botthink_residual -= thinktime;
+		if ( bs->botthink_residual >= thinktime ) {
+			bs->deferlowpriority = qfalse;
+			if ( budget > 0 ) {
+				used = (int)((unsigned)BotThinkClock() - (unsigned)starttime);
+				if ( used + bs->thinkcost > budget ) {
+					if ( bs->botthink_residual < 2 * thinktime ) {
+						if ( first < 0 ) first = i;
+						continue;
+					}
+					bs->deferlowpriority = qtrue;
+				}
+			}
+			bs->botthink_residual -= thinktime;
 
 			if (!trap_AAS_Initialized()) return qfalse;
 
 			if (g_entities[i].client->pers.connected == CON_CONNECTED) {
+				thinkstart = BotThinkClock();
 				BotAI(i, (float) thinktime / 1000);
+				//the bot may have been removed during its think
+				if ( botstates[i] && botstates[i]->inuse ) {
+					cost = (int)((unsigned)BotThinkClock() - (unsigned)thinkstart);
+					bs->thinkcost = bs->thinkcost * 0.9f + cost * 0.1f;
+				}
 			}
 		}
 	}
+	if ( first >= 0 ) {
+		botthink_first = first;
+	}
 
 
 	// execute bot user commands every frame
@@ -1676,6 +1730,19 @@ int BotAISetup( int restart ) {
 	int			errnum;
 
 	trap_Cvar_Register(&bot_thinktime, "bot_thinktime", "100", CVAR_CHEAT);
+	trap_Cvar_Register(&bot_thinkbudget, "bot_thinkbudget", "0", 0);
+#if defined( QC )
+	{
+		char value[16];
+		bot_microseconds = trap_GetValue( value, sizeof( value ), "trap_Microseconds" );
+	}
+#endif
+#if defined( QC )
+	{
+		char value[16];
+		bot_microseconds = trap_GetValue( value, sizeof( value ), "trap_Microseconds" );
+	}
+#endif
 	trap_Cvar_Register(&bot_memorydump, "bot_memorydump", "0", CVAR_CHEAT);
 	trap_Cvar_Register(&bot_saveroutingcache, "bot_saveroutingcache", "0", CVAR_CHEAT);
 	trap_Cvar_Register(&bot_pause, "bot_pause", "0", CVAR_CHEAT);
@@ -123,6 +123,8 @@ typedef struct bot_state_s
 {
 	int inuse;										//true if this state is used by a bot client
 	int botthink_residual;							//residual for the bot thinks
+	float thinkcost;								//average microseconds spent in a think
+	int deferlowpriority;							//true if chat and team AI are skipped this think
 	int client;										//client number of the bot
 	int entitynum;									//entity number of the bot
 	playerState_t cur_ps;							//current player state
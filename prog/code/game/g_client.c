@@ -1517,6 +1517,7 @@ void ClientSpawn(gentity_t *ent) {
 	ent->takedamage = qtrue;
 	ent->inuse = qtrue;
 	ent->classname = "player";
+	G_UpdateEntityIndex( ent );
 	ent->r.contents = CONTENTS_BODY;
 	ent->clipmask = MASK_PLAYERSOLID;
 	ent->die = player_die;
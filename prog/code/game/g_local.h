@@ -93,6 +93,8 @@ struct gentity_s {
 	char		*model;
 	char		*model2;
 	int			freetime;			// level.time when the object was freed
+	gentity_t	*prevFree;			// free list links, oldest freetime first
+	gentity_t	*nextFree;
 	
 	int			eventTime;			// events will be cleared EVENT_VALID_MSEC after set
 	qboolean	freeAfterEvent;
@@ -515,9 +517,20 @@ typedef struct {
 #ifdef MISSIONPACK
 	int			portalSequence;
 #endif
+	gentity_t	*freeHead;				// freed entities ordered by freetime,
+	gentity_t	*freeTail;				// G_Spawn takes from the head
+	int			numFreeEntities;
+	int			entitySpawns;			// churn statistics for "entitystats"
+	int			entityFrees;
+	int			entityForcedReuses;		// slots reused before 1000 ms
+
 #if defined( UNLAGGED ) //unlagged - backward reconciliation #4
 	// actual time this server frame started
 	int			frameStartTime;
+#if defined( QC )
+	// the engine keeps its own client history and can trace against it
+	qboolean	engineRewind;
+#endif // QC
 #endif
 } level_locals_t;
 
@@ -575,6 +588,9 @@ int G_ModelIndex( char *name );
 int		G_SoundIndex( char *name );
 void	G_TeamCommand( team_t team, char *cmd );
 void	G_KillBox (gentity_t *ent);
+void	G_InitEntityIndex( void );
+void	G_UpdateEntityIndex( gentity_t *ent );
+void	G_FlushEntityIndex( void );
 gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match);
 gentity_t *G_PickTarget (char *targetname);
 void	G_UseTargets (gentity_t *ent, gentity_t *activator);
@@ -586,6 +602,7 @@ gentity_t *G_TempEntity( vec3_t origin, int event );
 void	G_Sound( gentity_t *ent, int channel, int soundIndex );
 void	G_FreeEntity( gentity_t *e );
 qboolean	G_EntitiesFree( void );
+void	Svcmd_EntityStats_f( void );
 
 void	G_TouchTriggers (gentity_t *ent);
 
@@ -1193,3 +1210,14 @@ int		trap_GeneticParentsAndChildSelection(int numranks, float *ranks, int *paren
 void	trap_SnapVector( float *v );
 #endif // QC
 
+#if defined( QC )
+// engine extensions, only call them after trap_GetValue found them
+qboolean trap_GetValue( char *value, int valueSize, const char *key );
+// makes every trap_Trace test the clients where they were at the given server time, 0 to disable
+void	trap_SetTraceTime( int time, int skipEntityNum );
+void	trap_TraceAtTime( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int time );
+void	trap_ResetEntityHistory( int entityNum );
+// wraps around, only use differences
+int		trap_Microseconds( void );
+#endif // QC
+
@@ -391,6 +391,8 @@ void G_FindTeams( void ) {
 				if ( e2->targetname ) {
 					e->targetname = e2->targetname;
 					e2->targetname = NULL;
+					G_UpdateEntityIndex( e );
+					G_UpdateEntityIndex( e2 );
 				}
 			}
 		}
@@ -512,6 +514,12 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 	memset( &level, 0, sizeof( level ) );
 	level.time = levelTime;
 	level.startTime = levelTime;
+#if defined( UNLAGGED ) && defined( QC )
+	{
+		char value[16];
+		level.engineRewind = trap_GetValue( value, sizeof( value ), "trap_SetTraceTime" );
+	}
+#endif
 
 	level.snd_fry = G_SoundIndex("sound/player/fry.wav");	// FIXME standing in lava / slime
 
@@ -540,6 +548,7 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 	// initialize all entities for this game
 	memset( g_entities, 0, MAX_GENTITIES * sizeof(g_entities[0]) );
 	level.gentities = g_entities;
+	G_InitEntityIndex();
 
 	// initialize all clients for this game
 	level.maxclients = g_maxclients.integer;
@@ -1962,6 +1971,9 @@ void G_RunFrame( int levelTime ) {
 	level.previousTime = level.time;
 	level.time = levelTime;
 
+	// hash the entities spawned during the last frame
+	G_FlushEntityIndex();
+
 	// get any cvar changes
 	G_UpdateCvars();
 
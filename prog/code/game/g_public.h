@@ -410,8 +410,20 @@ typedef enum {
 	BOTLIB_PC_LOAD_SOURCE,
 	BOTLIB_PC_FREE_SOURCE,
 	BOTLIB_PC_READ_TOKEN,
-	BOTLIB_PC_SOURCE_FILE_AND_LINE
-
+	BOTLIB_PC_SOURCE_FILE_AND_LINE,
+
+#if defined( QC ) // CNQ3 extensions
+	G_EXT_GETVALUE = 700,
+	G_EXT_LOCATEINTEROPDATA,
+	G_EXT_CVAR_SETRANGE,
+	G_EXT_CVAR_SETHELP,
+	G_EXT_CMD_SETHELP,
+	G_EXT_ERROR2,
+	G_EXT_SETTRACETIME,
+	G_EXT_TRACEATTIME,
+	G_EXT_RESETENTITYHISTORY,
+	G_EXT_MICROSECONDS,
+#endif // QC
 } gameImport_t;
 
 
@@ -468,6 +468,11 @@ qboolean	ConsoleCommand( void ) {
 		return qtrue;
 	}
 
+	if (Q_stricmp (cmd, "entitystats") == 0) {
+		Svcmd_EntityStats_f();
+		return qtrue;
+	}
+
 	if (Q_stricmp (cmd, "addbot") == 0) {
 		Svcmd_AddBot_f();
 		return qtrue;
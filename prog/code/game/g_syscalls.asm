@@ -223,4 +223,9 @@ equ trap_BotLibLoadSource				-579
 equ trap_BotLibFreeSource				-580
 equ trap_BotLibReadToken				-581
 equ trap_BotLibSourceFileAndLine		-582
- 
+
+equ trap_GetValue						-701
+equ trap_SetTraceTime					-707
+equ trap_TraceAtTime					-708
+equ trap_ResetEntityHistory				-709
+equ trap_Microseconds					-710
@@ -807,3 +807,27 @@ int trap_PC_ReadToken( int handle, pc_token_t *pc_token ) {
 int trap_PC_SourceFileAndLine( int handle, char *filename, int *line ) {
 	return syscall( BOTLIB_PC_SOURCE_FILE_AND_LINE, handle, filename, line );
 }
+
+#if defined( QC )
+
+qboolean trap_GetValue( char *value, int valueSize, const char *key ) {
+	return (qboolean)syscall( G_EXT_GETVALUE, value, valueSize, key );
+}
+
+void trap_SetTraceTime( int time, int skipEntityNum ) {
+	syscall( G_EXT_SETTRACETIME, time, skipEntityNum );
+}
+
+void trap_TraceAtTime( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int time ) {
+	syscall( G_EXT_TRACEATTIME, results, start, mins, maxs, end, passEntityNum, contentmask, time );
+}
+
+void trap_ResetEntityHistory( int entityNum ) {
+	syscall( G_EXT_RESETENTITYHISTORY, entityNum );
+}
+
+int trap_Microseconds( void ) {
+	return syscall( G_EXT_MICROSECONDS );
+}
+
+#endif // QC
@@ -23,6 +23,12 @@ void G_ResetHistory( gentity_t *ent ) {
 		VectorCopy( ent->r.currentOrigin, ent->client->history[i].currentOrigin );
 		ent->client->history[i].leveltime = time;
 	}
+
+#if defined( QC )
+	if ( level.engineRewind ) {
+		trap_ResetEntityHistory( ent->s.number );
+	}
+#endif // QC
 }
 
 
@@ -238,6 +244,16 @@ void G_TimeShiftAllClients( int time, gentity_t *skip ) {
 	qboolean debug = ( skip != NULL && skip->client && 
 			skip->client->pers.debugDelag && skip->s.weapon == WP_RAILGUN );
 
+#if defined( QC )
+	// let the engine trace against its own history instead of relinking everyone
+	// only for hitscan shots: the missile pass also needs G_RadiusDamage's
+	// trap_EntitiesInBox and absmin/absmax to see the shifted positions
+	if ( level.engineRewind && skip != NULL && !debug ) {
+		trap_SetTraceTime( time, skip->s.number );
+		return;
+	}
+#endif // QC
+
 	// for every client
 	ent = &g_entities[0];
 	for ( i = 0; i < MAX_CLIENTS; i++, ent++ ) {
@@ -321,6 +337,13 @@ void G_UnTimeShiftAllClients( gentity_t *skip ) {
 	int			i;
 	gentity_t	*ent;
 
+#if defined( QC )
+	if ( level.engineRewind ) {
+		trap_SetTraceTime( 0, ENTITYNUM_NONE );
+	}
+#endif // QC
+
+	// clients that weren't shifted are left alone by G_UnTimeShiftClient
 	ent = &g_entities[0];
 	for ( i = 0; i < MAX_CLIENTS; i++, ent++) {
 		if ( ent->client && ent->inuse && ent->client->sess.sessionTeam < TEAM_SPECTATOR && ent != skip ) {
@@ -144,6 +144,210 @@ void G_TeamCommand( team_t team, char *cmd ) {
 }
 
 
+/*
+=============================================================================
+
+ENTITY INDEX
+
+classname and targetname are hashed so G_Find doesn't need to compare the
+strings of every entity. The fields are assigned all over the place after
+G_Spawn returns, so entities spawned during the current frame are kept on
+a pending list that G_Find checks directly, and they are only hashed when
+the next frame starts. Candidates are always compared against the current
+field value, so a stale hash can't produce a wrong match.
+
+=============================================================================
+*/
+
+#define	ENTITY_HASH_SIZE	1024	// must be a power of two
+#define	ENTITY_INDEX_FIELDS	2		// classname, targetname
+
+static int		entityHashHead[ENTITY_INDEX_FIELDS][ENTITY_HASH_SIZE];
+static int		entityHashNext[ENTITY_INDEX_FIELDS][MAX_GENTITIES];	// sorted by entity number
+static unsigned	entityHashKey[ENTITY_INDEX_FIELDS][MAX_GENTITIES];
+static qboolean	entityHashed[ENTITY_INDEX_FIELDS][MAX_GENTITIES];
+
+static int		pendingEntities[MAX_GENTITIES];
+static int		numPendingEntities;
+static qboolean	entityPending[MAX_GENTITIES];
+
+
+static int G_IndexedField( int fieldofs ) {
+	if ( fieldofs == FOFS(classname) ) {
+		return 0;
+	}
+	if ( fieldofs == FOFS(targetname) ) {
+		return 1;
+	}
+	return -1;
+}
+
+static const char *G_IndexedFieldValue( const gentity_t *ent, int field ) {
+	return field == 0 ? ent->classname : ent->targetname;
+}
+
+// case-insensitive to match the Q_stricmp in G_Find
+static unsigned G_EntityHashKey( const char *s ) {
+	unsigned	key;
+	int			c;
+
+	key = 0;
+	while ( *s ) {
+		c = *s++;
+		if ( c >= 'A' && c <= 'Z' ) {
+			c += 'a' - 'A';
+		}
+		key = key * 31 + c;
+	}
+
+	return key;
+}
+
+static void G_HashEntity( int num ) {
+	int			field, *link;
+	const char	*s;
+	unsigned	key;
+
+	for ( field = 0; field < ENTITY_INDEX_FIELDS; field++ ) {
+		s = G_IndexedFieldValue( &g_entities[num], field );
+		if ( !s ) {
+			continue;
+		}
+
+		key = G_EntityHashKey( s );
+		link = &entityHashHead[field][key & ( ENTITY_HASH_SIZE - 1 )];
+		while ( *link >= 0 && *link < num ) {
+			link = &entityHashNext[field][*link];
+		}
+		entityHashNext[field][num] = *link;
+		*link = num;
+		entityHashKey[field][num] = key;
+		entityHashed[field][num] = qtrue;
+	}
+}
+
+static void G_UnhashEntity( int num ) {
+	int		field, *link;
+
+	for ( field = 0; field < ENTITY_INDEX_FIELDS; field++ ) {
+		if ( !entityHashed[field][num] ) {
+			continue;
+		}
+
+		link = &entityHashHead[field][entityHashKey[field][num] & ( ENTITY_HASH_SIZE - 1 )];
+		while ( *link != num ) {
+			link = &entityHashNext[field][*link];
+		}
+		*link = entityHashNext[field][num];
+		entityHashed[field][num] = qfalse;
+	}
+}
+
+/*
+=============
+G_InitEntityIndex
+=============
+*/
+void G_InitEntityIndex( void ) {
+	memset( entityHashHead, -1, sizeof( entityHashHead ) );
+	memset( entityHashed, 0, sizeof( entityHashed ) );
+	memset( entityPending, 0, sizeof( entityPending ) );
+	numPendingEntities = 0;
+}
+
+/*
+=============
+G_UpdateEntityIndex
+
+Must be called when the classname or targetname of an entity
+spawned during an earlier frame changes
+=============
+*/
+void G_UpdateEntityIndex( gentity_t *ent ) {
+	int		num;
+
+	num = ent - g_entities;
+	G_UnhashEntity( num );
+	if ( !entityPending[num] ) {
+		entityPending[num] = qtrue;
+		pendingEntities[numPendingEntities++] = num;
+	}
+}
+
+/*
+=============
+G_FlushEntityIndex
+
+Hashes the entities spawned or changed since the last flush
+=============
+*/
+void G_FlushEntityIndex( void ) {
+	int		i, num;
+
+	for ( i = 0; i < numPendingEntities; i++ ) {
+		num = pendingEntities[i];
+		entityPending[num] = qfalse;
+		if ( g_entities[num].inuse ) {
+			G_HashEntity( num );
+		}
+	}
+	numPendingEntities = 0;
+}
+
+/*
+=============
+G_FindIndexed
+=============
+*/
+static gentity_t *G_FindIndexed( int fromNum, int field, const char *match ) {
+	int			i, num, best;
+	unsigned	key;
+	const char	*s;
+
+	key = G_EntityHashKey( match );
+
+	// the chains are sorted, so the first match after fromNum is the one
+	if ( fromNum >= 0 && entityHashed[field][fromNum] &&
+		( ( entityHashKey[field][fromNum] ^ key ) & ( ENTITY_HASH_SIZE - 1 ) ) == 0 ) {
+		num = entityHashNext[field][fromNum];
+	} else {
+		num = entityHashHead[field][key & ( ENTITY_HASH_SIZE - 1 )];
+		while ( num >= 0 && num <= fromNum ) {
+			num = entityHashNext[field][num];
+		}
+	}
+
+	best = MAX_GENTITIES;
+	for ( ; num >= 0; num = entityHashNext[field][num] ) {
+		if ( entityHashKey[field][num] != key || !g_entities[num].inuse ) {
+			continue;
+		}
+		s = G_IndexedFieldValue( &g_entities[num], field );
+		if ( s && !Q_stricmp( s, match ) ) {
+			best = num;
+			break;
+		}
+	}
+
+	// entities spawned this frame aren't hashed yet
+	for ( i = 0; i < numPendingEntities; i++ ) {
+		num = pendingEntities[i];
+		if ( num <= fromNum || num >= best || !g_entities[num].inuse ) {
+			continue;
+		}
+		s = G_IndexedFieldValue( &g_entities[num], field );
+		if ( s && !Q_stricmp( s, match ) ) {
+			best = num;
+		}
+	}
+
+	if ( best >= level.num_entities ) {
+		return NULL;
+	}
+
+	return &g_entities[best];
+}
+
 /*
 =============
 G_Find
@@ -159,6 +363,12 @@ NULL will be returned if the end of the list is reached.
 gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match)
 {
 	char	*s;
+	int		field;
+
+	field = G_IndexedField( fieldofs );
+	if ( field >= 0 ) {
+		return G_FindIndexed( from ? from - g_entities : -1, field, match );
+	}
 
 	if (!from)
 		from = g_entities;
@@ -364,11 +574,58 @@ float vectoyaw( const vec3_t vec ) {
 }
 
 
+/*
+=================
+G_LinkFreeEntity
+
+Appends the entity to the free list, which stays sorted by freetime
+because level.time never goes backwards
+=================
+*/
+static void G_LinkFreeEntity( gentity_t *e ) {
+	e->prevFree = level.freeTail;
+	e->nextFree = NULL;
+	if ( level.freeTail ) {
+		level.freeTail->nextFree = e;
+	} else {
+		level.freeHead = e;
+	}
+	level.freeTail = e;
+	level.numFreeEntities++;
+}
+
+/*
+=================
+G_UnlinkFreeEntity
+=================
+*/
+static void G_UnlinkFreeEntity( gentity_t *e ) {
+	if ( e->prevFree == NULL && level.freeHead != e ) {
+		return;		// not in the list
+	}
+
+	if ( e->prevFree ) {
+		e->prevFree->nextFree = e->nextFree;
+	} else {
+		level.freeHead = e->nextFree;
+	}
+	if ( e->nextFree ) {
+		e->nextFree->prevFree = e->prevFree;
+	} else {
+		level.freeTail = e->prevFree;
+	}
+	e->prevFree = NULL;
+	e->nextFree = NULL;
+	level.numFreeEntities--;
+}
+
 void G_InitGentity( gentity_t *e ) {
+	G_UnlinkFreeEntity( e );
 	e->inuse = qtrue;
 	e->classname = "noclass";
 	e->s.number = e - g_entities;
 	e->r.ownerNum = ENTITYNUM_NONE;
+	G_UpdateEntityIndex( e );
 }
 
 /*
@@ -387,33 +644,31 @@ angles and bad trails.
 =================
 */
 gentity_t *G_Spawn( void ) {
-	int			i, force;
+	int			i;
 	gentity_t	*e;
 
-	e = NULL;	// shut up warning
-	for ( force = 0 ; force < 2 ; force++ ) {
-		// if we go through all entities and can't find one to free,
-		// override the normal minimum times before use
-		e = &g_entities[MAX_CLIENTS];
-		for ( i = MAX_CLIENTS ; i<level.num_entities ; i++, e++) {
-			if ( e->inuse ) {
-				continue;
-			}
-
-			// the first couple seconds of server time can involve a lot of
-			// freeing and allocating, so relax the replacement policy
-			if ( !force && e->freetime > level.startTime + 2000 && level.time - e->freetime < 1000 ) {
-				continue;
-			}
-
+	// the free list is sorted by freetime, so only the head needs checking
+	e = level.freeHead;
+	if ( e ) {
+		// the first couple seconds of server time can involve a lot of
+		// freeing and allocating, so relax the replacement policy
+		if ( e->freetime <= level.startTime + 2000 || level.time - e->freetime >= 1000 ) {
 			// reuse this slot
 			G_InitGentity( e );
+			level.entitySpawns++;
 			return e;
 		}
-		if ( level.num_entities < ENTITYNUM_MAX_NORMAL ) {
-			break;
+
+		// if we can't open a new slot,
+		// override the normal minimum times before use
+		if ( level.num_entities == ENTITYNUM_MAX_NORMAL ) {
+			G_InitGentity( e );
+			level.entitySpawns++;
+			level.entityForcedReuses++;
+			return e;
 		}
 	}
+
 	if ( level.num_entities == ENTITYNUM_MAX_NORMAL ) {
 		for (i = 0; i < MAX_GENTITIES; i++) {
 			G_Printf("%4i: %s\n", i, g_entities[i].classname);
@@ -422,6 +677,7 @@ gentity_t *G_Spawn( void ) {
 	}
 	
 	// open up a new slot
+	e = &g_entities[level.num_entities];
 	level.num_entities++;
 
 	// let the server system know that there are more entities
@@ -429,6 +685,7 @@ gentity_t *G_Spawn( void ) {
 		&level.clients[0].ps, sizeof( level.clients[0] ) );
 
 	G_InitGentity( e );
+	level.entitySpawns++;
 	return e;
 }
 
@@ -438,23 +695,34 @@ G_EntitiesFree
 =================
 */
 qboolean G_EntitiesFree( void ) {
-	int			i;
-	gentity_t	*e;
-
 	if ( level.num_entities < ENTITYNUM_MAX_NORMAL ) {
 		// can open a new slot if needed
 		return qtrue;
 	}
 
-	e = &g_entities[MAX_CLIENTS];
-	for ( i = MAX_CLIENTS; i < level.num_entities; i++, e++) {
-		if ( e->inuse ) {
-			continue;
-		}
-		// slot available
-		return qtrue;
+	// slot available
+	return level.freeHead != NULL;
+}
+
+/*
+=================
+Svcmd_EntityStats_f
+=================
+*/
+void Svcmd_EntityStats_f( void ) {
+	float	seconds;
+
+	seconds = ( level.time - level.startTime ) * 0.001f;
+	if ( seconds < 1.0f ) {
+		seconds = 1.0f;
 	}
-	return qfalse;
+
+	G_Printf( "%i entity slots opened, %i free, %i max\n",
+		level.num_entities - MAX_CLIENTS, level.numFreeEntities, ENTITYNUM_MAX_NORMAL - MAX_CLIENTS );
+	G_Printf( "%i spawned (%.1f/s), %i freed (%.1f/s), %i reused early\n",
+		level.entitySpawns, level.entitySpawns / seconds,
+		level.entityFrees, level.entityFrees / seconds,
+		level.entityForcedReuses );
 }
 
 
@@ -472,10 +740,21 @@ void G_FreeEntity( gentity_t *ed ) {
 		return;
 	}
 
+	G_UnhashEntity( ed - g_entities );
+
+	// freeing an entity twice moves it to the back of the list
+	G_UnlinkFreeEntity( ed );
+
 	memset (ed, 0, sizeof(*ed));
 	ed->classname = "freed";
 	ed->freetime = level.time;
 	ed->inuse = qfalse;
+
+	// client slots are never handed out by G_Spawn
+	if ( ed - g_entities >= MAX_CLIENTS ) {
+		G_LinkFreeEntity( ed );
+	}
+	level.entityFrees++;
 }
 
 /*